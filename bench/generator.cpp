@@ -0,0 +1,254 @@
+// generator.cpp - Deterministic synthetic .sch/.sym generator for benchmarks
+
+#include "generator.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace xschem_bench {
+
+namespace {
+
+// splitmix64: fixed sequence on every platform (std distributions are not)
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : m_state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    double uniform() { return (next() >> 11) * 0x1.0p-53; }
+    size_t below(size_t n) { return n ? next() % n : 0; }
+    bool chance(double p) { return uniform() < p; }
+
+private:
+    uint64_t m_state;
+};
+
+struct PinDef {
+    const char* name;
+    const char* dir;
+    double x, y;
+};
+
+// Primitive used for most instances
+const PinDef mos_pins[] = {
+    {"D", "inout", 20, -30}, {"G", "in", -20, 0}, {"S", "inout", 20, 30}, {"B", "in", 20, 0}
+};
+
+// Hierarchy cells
+const PinDef cell_pins[] = {{"A", "in", -40, 0}, {"Y", "out", 40, 0}};
+
+// Same transform as the resolver (xschem ROTATION)
+void rotate(int rot, int flip, double x0, double y0, double x, double y,
+            double& rx, double& ry) {
+    double xxtmp = flip ? 2 * x0 - x : x;
+    if (rot == 0)      { rx = xxtmp;  ry = y; }
+    else if (rot == 1) { rx = x0 - y + y0; ry = y0 + xxtmp - x0; }
+    else if (rot == 2) { rx = 2 * x0 - xxtmp; ry = 2 * y0 - y; }
+    else               { rx = x0 + y - y0; ry = y0 - xxtmp + x0; }
+}
+
+void write_pins(std::ofstream& out, const PinDef* pins, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const auto& p = pins[i];
+        out << "B 5 " << p.x - 2.5 << " " << p.y - 2.5 << " " << p.x + 2.5 << " " << p.y + 2.5
+            << " {name=" << p.name << " dir=" << p.dir << "}\n";
+    }
+}
+
+bool write_primitive_symbols(const std::filesystem::path& dir) {
+    std::ofstream mos(dir / "gen_nfet.sym");
+    mos << "v {xschem version=3.4.6RC file_version=1.2}\n"
+        << "K {type=nmos\n"
+        << "format=\"@spiceprefix@name @pinlist @model W=@W L=@L m=@mult\"\n"
+        << "template=\"name=M1 model=nfet_01v8 W=1 L=0.15 mult=1 spiceprefix=X\"\n}\n"
+        << "L 4 7.5 -30 7.5 30 {}\n"
+        << "L 4 -20 0 -5 0 {}\n"
+        << "L 4 7.5 -22.5 20 -22.5 {}\n"
+        << "L 4 7.5 22.5 20 22.5 {}\n";
+    write_pins(mos, mos_pins, 4);
+    mos << "T {@name} 25 -17 0 0 0.2 0.2 {}\n";
+
+    std::ofstream lab(dir / "lab_pin.sym");
+    lab << "v {xschem version=3.4.6RC file_version=1.2}\n"
+        << "K {type=label\nformat=\"*.alias @lab\"\ntemplate=\"name=l1 lab=xxx\"\n}\n"
+        << "L 4 0 0 20 0 {}\n"
+        << "B 5 -1.25 -1.25 1.25 1.25 {name=p dir=inout}\n"
+        << "T {@lab} 22 -4 0 0 0.33 0.33 {}\n";
+
+    std::ofstream ipin(dir / "ipin.sym");
+    ipin << "v {xschem version=3.4.6RC file_version=1.2}\n"
+         << "K {type=ipin\nformat=\"*.ipin @lab\"\ntemplate=\"name=p1 lab=xxx\"\n}\n"
+         << "L 7 -20 0 0 0 {}\n"
+         << "B 5 -2.5 -2.5 2.5 2.5 {name=p dir=in}\n";
+
+    std::ofstream opin(dir / "opin.sym");
+    opin << "v {xschem version=3.4.6RC file_version=1.2}\n"
+         << "K {type=opin\nformat=\"*.opin @lab\"\ntemplate=\"name=p1 lab=xxx\"\n}\n"
+         << "L 7 0 0 20 0 {}\n"
+         << "B 5 -2.5 -2.5 2.5 2.5 {name=p dir=out}\n";
+
+    return mos.good() && lab.good() && ipin.good() && opin.good();
+}
+
+bool write_cell_symbol(const std::filesystem::path& dir, int level) {
+    std::ofstream sym(dir / ("cell_L" + std::to_string(level) + ".sym"));
+    sym << "v {xschem version=3.4.6RC file_version=1.2}\n"
+        << "K {type=subcircuit\nformat=\"@name @pinlist @symname\"\ntemplate=\"name=x1\"\n}\n"
+        << "B 4 -40 -40 40 40 {}\n";
+    write_pins(sym, cell_pins, 2);
+    sym << "T {@symname} -30 -6 0 0 0.3 0.3 {}\n";
+    return sym.good();
+}
+
+// One schematic level. Every `cell_every`-th instance is a cell of the next
+// level (0: primitives only).
+bool write_schematic(const std::filesystem::path& file, size_t n, const GeneratorOptions& opts,
+                     Rng& rng, const std::string& cell_symbol, size_t cell_every,
+                     GeneratorResult& result) {
+    std::ofstream out(file);
+    out.precision(12);
+    out << "v {xschem version=3.4.6RC file_version=1.2}\nG {}\nK {}\nV {}\nS {}\nE {}\n";
+
+    const size_t cols = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::sqrt(double(n)))));
+    const size_t label_pool = std::max<size_t>(1, n / 10);
+
+    struct Placed { double x, y; int rot, flip; bool cell; };
+    std::vector<Placed> placed;
+    placed.reserve(n);
+
+    auto pin_point = [&](const Placed& p, size_t pin, double& px, double& py) {
+        const PinDef& def = p.cell ? cell_pins[pin % 2] : mos_pins[pin % 4];
+        rotate(p.rot, p.flip, p.x, p.y, p.x + def.x, p.y + def.y, px, py);
+    };
+    auto pin_count = [](const Placed& p) { return p.cell ? size_t(2) : size_t(4); };
+
+    size_t wire_id = 0;
+    auto write_wire = [&](double x1, double y1, double x2, double y2) {
+        out << "N " << x1 << " " << y1 << " " << x2 << " " << y2 << " {}\n";
+        wire_id++;
+    };
+
+    for (size_t i = 0; i < n; i++) {
+        Placed p;
+        p.x = double(i % cols) * 200;
+        p.y = double(i / cols) * 200;
+        p.rot = 0;
+        p.flip = 0;
+        if (rng.chance(opts.rotation_mix)) {
+            p.rot = static_cast<int>(rng.below(4));
+            p.flip = static_cast<int>(rng.below(2));
+        }
+        p.cell = cell_every && (i % cell_every == cell_every - 1);
+        placed.push_back(p);
+
+        if (p.cell) {
+            out << "C {" << cell_symbol << "} " << p.x << " " << p.y << " " << p.rot << " " << p.flip
+                << " {name=x" << i << "}\n";
+        } else {
+            out << "C {gen_nfet.sym} " << p.x << " " << p.y << " " << p.rot << " " << p.flip
+                << " {name=M" << i << "\nW=" << 1 + rng.below(8) * 0.5 << "\nL=0.15\n}\n";
+        }
+        result.instances++;
+
+        // Drawing annotations around the instance (no random draws, so the
+        // rest of the design does not depend on this option)
+        size_t drawings = static_cast<size_t>(opts.graphics * double(i + 1)) -
+                          static_cast<size_t>(opts.graphics * double(i));
+        for (size_t g = 0; g < drawings; g++) {
+            double gx = p.x + 60 + double(g % 8) * 5, gy = p.y - 60 + double(g / 8) * 5;
+            switch (g % 5) {
+                case 0: out << "L 4 " << gx << " " << gy << " " << gx + 20 << " " << gy << " {}\n"; break;
+                case 1: out << "B 4 " << gx << " " << gy << " " << gx + 10 << " " << gy + 10
+                            << " {dash=3 fill=false}\n"; break;
+                case 2: out << "A 4 " << gx << " " << gy << " 5 0 360 {}\n"; break;
+                case 3: out << "P 4 4 " << gx << " " << gy << " " << gx + 10 << " " << gy << " "
+                            << gx + 10 << " " << gy + 10 << " " << gx << " " << gy << " {fill=true}\n"; break;
+                default: out << "T {note " << i << "." << g << "\nsecond line} " << gx << " " << gy
+                             << " 0 0 0.2 0.2 {layer=4 font=Monospace}\n"; break;
+            }
+        }
+
+        // Wires: L-shaped connection from a pin of this instance to a pin of a
+        // recent instance, two segments sharing the corner point
+        double want = opts.wire_density;
+        size_t count = static_cast<size_t>(want);
+        if (rng.chance(want - double(count))) count++;
+        for (size_t w = 0; w < count && i > 0; w++) {
+            const Placed& other = placed[i - 1 - rng.below(std::min<size_t>(i, 8))];
+            double x1, y1, x2, y2;
+            pin_point(p, rng.below(pin_count(p)), x1, y1);
+            pin_point(other, rng.below(pin_count(other)), x2, y2);
+            write_wire(x1, y1, x2, y1);
+            write_wire(x2, y1, x2, y2);
+        }
+
+        // Label on one pin, names drawn from a pool so labels merge nets
+        if (rng.chance(opts.label_ratio)) {
+            double lx, ly;
+            pin_point(p, rng.below(pin_count(p)), lx, ly);
+            out << "C {lab_pin.sym} " << lx << " " << ly << " 0 0 {name=l" << i
+                << " lab=n" << rng.below(label_pool) << "}\n";
+            result.instances++;
+        }
+    }
+
+    // Ports on the first and last instance, so cells have A/Y connections
+    if (!placed.empty()) {
+        double ax, ay, yx, yy;
+        pin_point(placed[0], 1, ax, ay);
+        pin_point(placed[n - 1], 0, yx, yy);
+        out << "C {ipin.sym} " << ax << " " << ay << " 0 0 {name=p1 lab=A}\n";
+        out << "C {opin.sym} " << yx << " " << yy << " 0 0 {name=p2 lab=Y}\n";
+        result.instances += 2;
+    }
+
+    result.wires += wire_id;
+    return out.good();
+}
+
+} // namespace
+
+size_t instances_for_objects(size_t objects, const GeneratorOptions& opts) {
+    double per_instance = 1.0 + 2.0 * opts.wire_density + opts.label_ratio;
+    return std::max<size_t>(1, static_cast<size_t>(double(objects) / per_instance));
+}
+
+bool generate_design(const std::string& out_dir, const GeneratorOptions& opts,
+                     GeneratorResult& result) {
+    namespace fs = std::filesystem;
+    fs::path dir(out_dir);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    result = GeneratorResult();
+    if (!write_primitive_symbols(dir)) return false;
+
+    Rng rng(opts.seed);
+    const int depth = std::max(1, opts.hierarchy_depth);
+
+    // Lowest level first; each level instantiates the one below it
+    for (int level = depth - 1; level >= 1; level--) {
+        std::string child = (level + 1 < depth) ? "cell_L" + std::to_string(level + 1) + ".sym" : "";
+        fs::path sch = dir / ("cell_L" + std::to_string(level) + ".sch");
+        if (!write_schematic(sch, opts.cell_instances, opts, rng, child, child.empty() ? 0 : 8, result) ||
+            !write_cell_symbol(dir, level)) {
+            return false;
+        }
+    }
+
+    fs::path top = dir / "top.sch";
+    std::string child = depth > 1 ? "cell_L1.sym" : "";
+    if (!write_schematic(top, opts.instances, opts, rng, child, child.empty() ? 0 : 16, result)) {
+        return false;
+    }
+    result.top_schematic = top.string();
+    return true;
+}
+
+} // namespace xschem_bench
@@ -0,0 +1,42 @@
+// generator.h - Deterministic synthetic .sch/.sym generator for benchmarks
+// Produces a grid of 4-pin MOS-like instances connected by L-shaped wire
+// pairs, lab_pin labels and an optional hierarchy of subcircuit cells.
+// The same options and seed always produce byte-identical files.
+
+#ifndef XSCHEM_BENCH_GENERATOR_H
+#define XSCHEM_BENCH_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+
+namespace xschem_bench {
+
+struct GeneratorOptions {
+    size_t instances = 1000;      // Primitive/cell instances in the top schematic
+    double wire_density = 1.0;    // Wire connections per instance (each is 2 segments)
+    double label_ratio = 0.3;     // Fraction of instances with a lab_pin label
+    double rotation_mix = 0.5;    // Fraction of instances with random rot/flip
+    int hierarchy_depth = 1;      // Levels of schematics (1: flat)
+    size_t cell_instances = 32;   // Instances in each lower hierarchy level
+    double graphics = 0;          // L/B/A/P/T drawing records per instance
+    uint64_t seed = 1;
+};
+
+struct GeneratorResult {
+    std::string top_schematic;    // Path of the top-level .sch
+    size_t instances = 0;         // Instances written (all levels, labels included)
+    size_t wires = 0;             // Wire segments written (all levels)
+    size_t objects() const { return instances + wires; }
+};
+
+// Write <out_dir>/top.sch, the cell_L<n>.sch/.sym levels and the primitive
+// symbols used by them. Returns false if a file cannot be written.
+bool generate_design(const std::string& out_dir, const GeneratorOptions& opts,
+                     GeneratorResult& result);
+
+// Instance count giving roughly `objects` instances + wires in the top level
+size_t instances_for_objects(size_t objects, const GeneratorOptions& opts);
+
+} // namespace xschem_bench
+
+#endif // XSCHEM_BENCH_GENERATOR_H
@@ -0,0 +1,2084 @@
+// xschem_bench.cpp - Benchmarks for the xschem_lite library
+// Each command times one part of the library and checks its results
+// against a reference where one exists.
+
+#include "../xschem_lite.h"
+#include "../xschem_lvs.h"
+#include "../xschem_snapshot.h"
+#include "../xschem_c.h"
+#include "../xschem_emit.h"
+#include "../xschem_flatten.h"
+#include "../xschem_spatial.h"
+#include "../xschem_stats.h"
+#include "generator.h"
+#include <iostream>
+#include <iomanip>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <set>
+#include <thread>
+#include <sys/resource.h>
+
+namespace legacy {
+
+using xschem::trim;
+
+// Previous std::regex based xschemrc parser, kept as the reference for the
+// "rc" benchmark. Regexes are rebuilt per line and per call, as they were.
+static std::string expand_env_vars(const std::string& input) {
+    std::string result = input;
+
+    // Expand $env(VAR) syntax (Tcl style)
+    std::regex env_tcl_regex(R"(\$env\(([^)]+)\))");
+    std::smatch match;
+    while (std::regex_search(result, match, env_tcl_regex)) {
+        std::string var_name = match[1].str();
+        const char* env_val = std::getenv(var_name.c_str());
+        std::string replacement = env_val ? env_val : "";
+        result = match.prefix().str() + replacement + match.suffix().str();
+    }
+
+    // Expand ${VAR} syntax
+    std::regex env_brace_regex(R"(\$\{([^}]+)\})");
+    while (std::regex_search(result, match, env_brace_regex)) {
+        std::string var_name = match[1].str();
+        const char* env_val = std::getenv(var_name.c_str());
+        std::string replacement = env_val ? env_val : "";
+        result = match.prefix().str() + replacement + match.suffix().str();
+    }
+
+    // Expand $VAR syntax (simple)
+    std::regex env_simple_regex(R"(\$([A-Za-z_][A-Za-z0-9_]*))");
+    while (std::regex_search(result, match, env_simple_regex)) {
+        std::string var_name = match[1].str();
+        const char* env_val = std::getenv(var_name.c_str());
+        std::string replacement = env_val ? env_val : "";
+        result = match.prefix().str() + replacement + match.suffix().str();
+    }
+
+    return result;
+}
+
+std::vector<std::string> parse_xschemrc_regex(const std::string& xschemrc_path) {
+    std::vector<std::string> paths;
+
+    std::ifstream file(xschemrc_path);
+    if (!file.is_open()) {
+        std::cerr << "Warning: Cannot open xschemrc: " << xschemrc_path << std::endl;
+        return paths;
+    }
+
+    // Get directory containing xschemrc for relative path resolution
+    std::filesystem::path rc_dir = std::filesystem::path(xschemrc_path).parent_path();
+
+    // Variables we track (simplified Tcl variable handling)
+    std::unordered_map<std::string, std::string> tcl_vars;
+
+    // Initialize with common defaults
+    const char* home = std::getenv("HOME");
+    if (home) tcl_vars["env(HOME)"] = home;
+
+    const char* pdk_root = std::getenv("PDK_ROOT");
+    if (pdk_root) {
+        tcl_vars["PDK_ROOT"] = pdk_root;
+        tcl_vars["env(PDK_ROOT)"] = pdk_root;
+    }
+
+    const char* pdk = std::getenv("PDK");
+    tcl_vars["PDK"] = pdk ? pdk : "sky130A";
+
+    // XSCHEM_SHAREDIR - try to find it
+    const char* xschem_share = std::getenv("XSCHEM_SHAREDIR");
+    if (xschem_share) {
+        tcl_vars["XSCHEM_SHAREDIR"] = xschem_share;
+    } else {
+        // Common locations
+        std::vector<std::string> share_candidates = {
+            "/usr/share/xschem",
+            "/usr/local/share/xschem",
+            home ? std::string(home) + "/share/xschem" : ""
+        };
+        for (const auto& candidate : share_candidates) {
+            if (!candidate.empty() && std::filesystem::exists(candidate)) {
+                tcl_vars["XSCHEM_SHAREDIR"] = candidate;
+                break;
+            }
+        }
+    }
+
+    std::string line;
+    std::string xschem_library_path;
+
+    while (std::getline(file, line)) {
+        // Skip comments and empty lines
+        std::string trimmed = trim(line);
+        if (trimmed.empty() || trimmed[0] == '#') continue;
+
+        // Look for: set XSCHEM_LIBRARY_PATH ...
+        // and: append XSCHEM_LIBRARY_PATH :...
+
+        std::regex set_regex(R"(^\s*set\s+XSCHEM_LIBRARY_PATH\s+\{\s*\}\s*$)");
+        std::regex append_regex(R"(^\s*append\s+XSCHEM_LIBRARY_PATH\s+:(.+)$)");
+        std::regex set_var_regex(R"(^\s*set\s+(\w+)\s+(.+)$)");
+
+        std::smatch match;
+
+        if (std::regex_match(trimmed, set_regex)) {
+            // Reset path
+            xschem_library_path.clear();
+        } else if (std::regex_search(trimmed, match, append_regex)) {
+            // Append to path
+            std::string path_part = match[1].str();
+
+            // Handle [file dirname [info script]] - means directory of xschemrc
+            if (path_part.find("[file dirname [info script]]") != std::string::npos) {
+                path_part = rc_dir.string();
+            }
+
+            // Substitute Tcl variables
+            for (const auto& [var, val] : tcl_vars) {
+                std::string var_pattern = "${" + var + "}";
+                size_t pos;
+                while ((pos = path_part.find(var_pattern)) != std::string::npos) {
+                    path_part.replace(pos, var_pattern.length(), val);
+                }
+                // Also try $VAR format
+                var_pattern = "$" + var;
+                while ((pos = path_part.find(var_pattern)) != std::string::npos) {
+                    // Make sure it's not part of a longer variable name
+                    size_t end_pos = pos + var_pattern.length();
+                    if (end_pos >= path_part.length() ||
+                        (!std::isalnum(path_part[end_pos]) && path_part[end_pos] != '_')) {
+                        path_part.replace(pos, var_pattern.length(), val);
+                    } else {
+                        break;
+                    }
+                }
+            }
+
+            // Expand any remaining environment variables
+            path_part = expand_env_vars(path_part);
+
+            if (!xschem_library_path.empty()) {
+                xschem_library_path += ":";
+            }
+            xschem_library_path += path_part;
+        } else if (std::regex_search(trimmed, match, set_var_regex)) {
+            // Track variable assignments
+            std::string var_name = match[1].str();
+            std::string var_value = match[2].str();
+
+            // Remove braces if present
+            if (!var_value.empty() && var_value.front() == '{' && var_value.back() == '}') {
+                var_value = var_value.substr(1, var_value.length() - 2);
+            }
+
+            // Substitute existing variables
+            for (const auto& [var, val] : tcl_vars) {
+                std::string var_pattern = "${" + var + "}";
+                size_t pos;
+                while ((pos = var_value.find(var_pattern)) != std::string::npos) {
+                    var_value.replace(pos, var_pattern.length(), val);
+                }
+                var_pattern = "$" + var;
+                while ((pos = var_value.find(var_pattern)) != std::string::npos) {
+                    size_t end_pos = pos + var_pattern.length();
+                    if (end_pos >= var_value.length() ||
+                        (!std::isalnum(var_value[end_pos]) && var_value[end_pos] != '_')) {
+                        var_value.replace(pos, var_pattern.length(), val);
+                    } else {
+                        break;
+                    }
+                }
+            }
+
+            var_value = expand_env_vars(var_value);
+            tcl_vars[var_name] = var_value;
+        }
+    }
+
+    // Split the path by colons and add valid directories
+    std::stringstream ss(xschem_library_path);
+    std::string path_entry;
+    while (std::getline(ss, path_entry, ':')) {
+        path_entry = trim(path_entry);
+        if (!path_entry.empty()) {
+            // Resolve to absolute path
+            std::filesystem::path abs_path;
+            if (std::filesystem::path(path_entry).is_relative()) {
+                abs_path = rc_dir / path_entry;
+            } else {
+                abs_path = path_entry;
+            }
+
+            // Check if directory exists
+            if (std::filesystem::exists(abs_path) && std::filesystem::is_directory(abs_path)) {
+                paths.push_back(std::filesystem::canonical(abs_path).string());
+            } else if (std::filesystem::exists(abs_path)) {
+                paths.push_back(abs_path.string());
+            }
+            // Silently skip non-existent paths
+        }
+    }
+
+    return paths;
+}
+
+
+} // namespace legacy
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsed_ms(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// File provider that adds a fixed latency to every lookup and read, standing
+// in for a network-mounted PDK install
+class LatencyFileProvider : public xschem::FileProvider {
+public:
+    explicit LatencyFileProvider(double latency_ms) : m_latency(latency_ms) {}
+
+    bool exists(const std::string& path) const override {
+        std::this_thread::sleep_for(m_latency);
+        return FileProvider::exists(path);
+    }
+    bool read(const std::string& path, std::string& content) const override {
+        std::this_thread::sleep_for(m_latency);
+        return FileProvider::read(path, content);
+    }
+
+private:
+    std::chrono::duration<double, std::milli> m_latency;
+};
+
+static void print_usage(const char* prog_name) {
+    std::cerr << "Usage: " << prog_name << " <command> [args]\n\n";
+    std::cerr << "Commands:\n";
+    std::cerr << "  rc <xschemrc> [iterations]   Time parse_xschemrc (evaluated and from the\n"
+                 "                               config snapshot) against the regex parser\n";
+    std::cerr << "  prefetch <input.sch> [-I <path>]... [--latency <ms>] [--threads <n>]\n"
+                 "                               Time schematic loading with and without\n"
+                 "                               concurrent symbol prefetch\n";
+    std::cerr << "  snapshot <input.sch> [-I <path>]... [--iterations <n>]\n"
+                 "                               Time parse + resolve against snapshot loading\n";
+    std::cerr << "  load [<input.sch>] [-I <path>]... [--iterations <n>] [generator options]\n"
+                 "                               Time and allocations of the full, info and\n"
+                 "                               netlist-only load profiles (default: a\n"
+                 "                               generated design with --graphics 20)\n";
+    std::cerr << "  scan [<input.sch>...] [generator options]\n"
+                 "                               Collect symbols and lab= names with the\n"
+                 "                               streaming parser against full loads\n";
+    std::cerr << "  gen <out_dir> [generator options]\n"
+                 "                               Write a synthetic design (top.sch + symbols)\n";
+    std::cerr << "  scale [generator options] [--sizes n,n,...] [--budget <s>]\n"
+                 "        [--json <file>] [--csv <file>]\n"
+                 "                               Per-stage timings over growing synthetic designs\n"
+                 "                               (default sizes 1k..10M objects)\n";
+    std::cerr << "  index [<input.sch>] [-I <path>]... [--queries <n>] [generator options]\n"
+                 "                               Pins-on-net and name-pattern queries through\n"
+                 "                               NetIndex against scans of the schematic\n";
+    std::cerr << "  spatial [<input.sch>] [-I <path>]... [--queries <n>] [generator options]\n"
+                 "                               Window and nearest-pin queries through\n"
+                 "                               SpatialIndex against linear scans\n";
+    std::cerr << "  capi <input.sch>... [-I <path>]... [--threads <n>] [--repeat <n>]\n"
+                 "       [--netlister <xschem_lite>]\n"
+                 "                               Netlist cells concurrently in process through\n"
+                 "                               the C interface (and one process per cell)\n";
+    std::cerr << "  embed [<input.sch>] [-I <path>]... [generator options]\n"
+                 "                               Netlist a copy with every symbol embedded and\n"
+                 "                               check it reads no symbol file\n";
+    std::cerr << "  merge [<input.sch>] [-I <path>]... [--pieces <n>] [generator options]\n"
+                 "                               Split every wire into pieces plus overlapping\n"
+                 "                               copies, then resolve with and without\n"
+                 "                               normalize_wires\n";
+    std::cerr << "  flatten [<input.sch>] [-I <path>]... [generator options]\n"
+                 "                               Load a hierarchy as shared cells, walk its\n"
+                 "                               flat devices and write the flat netlist on\n"
+                 "                               one thread and on all cores\n";
+    std::cerr << "  stable [<input.sch>...] [-I <path>]... [--runs <n>] [--netlister <xschem_lite>]\n"
+                 "       [generator options]\n"
+                 "                               Check every output is byte-identical across\n"
+                 "                               runs, thread counts and a moved copy of the\n"
+                 "                               design (different hash order)\n";
+    std::cerr << "  stdout <input.sch>... --netlister <xschem_lite> [-I <path>]...\n"
+                 "                               Check --json -, --verilog - and --stats-json -\n"
+                 "                               put only the document on stdout, and that the\n"
+                 "                               JSON parses\n";
+    std::cerr << "  devices\n"
+                 "                               Check a code block reaches only the SPICE\n"
+                 "                               netlist, and an instance array every format\n";
+    std::cerr << "  lvs [--devices <n>] [--seed <n>]\n"
+                 "                               Compare a synthetic netlist with a shuffled,\n"
+                 "                               renamed copy, and with a one-pin change\n\n";
+    std::cerr << "Generator options:\n";
+    std::cerr << "  --instances <n>  --wire-density <f>  --label-ratio <f>  --rotation-mix <f>\n";
+    std::cerr << "  --depth <n>  --cell-instances <n>  --seed <n>  --graphics <f>\n";
+}
+
+// A config snapshot must be reused unchanged without probing any directory,
+// and dropped when the xschemrc is edited
+static bool rc_snapshot_checks() {
+    const auto dir = std::filesystem::temp_directory_path() / "xschem_bench_rc_stale";
+    const std::string cache_dir = (dir / "cache").string();
+    const std::string rc = (dir / "xschemrc").string();
+    const std::string lib = (dir / "lib").string();
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    {
+        std::ofstream out(rc);
+        out << "append XSCHEM_LIBRARY_PATH :[file dirname [info script]]/lib\n";
+    }
+
+    int failures = 0;
+    auto expect = [&](const char* what, const std::vector<std::string>& want, bool reused) {
+        xschem::Stats stats;
+        xschem::XschemrcConfig config;
+        {
+            xschem::StatsScope scope(&stats);
+            if (!xschem::load_xschemrc(rc, config, cache_dir) || config.library_paths != want) {
+                std::cerr << "FAIL: config snapshot " << what << "\n";
+                failures++;
+            }
+        }
+        xschem::StatsReport io = stats.report();
+        if (reused && io.exists_probes != 0) {
+            std::cerr << "FAIL: config snapshot " << what << " probed " << io.exists_probes << " paths\n";
+            failures++;
+        }
+    };
+    std::filesystem::create_directory(lib);
+    const std::string lib_path = std::filesystem::canonical(lib).string();
+    expect("first load", {lib_path}, false);
+    if (std::filesystem::is_empty(cache_dir)) {
+        std::cerr << "FAIL: config snapshot not written\n";
+        failures++;
+    }
+    expect("reuse", {lib_path}, true);
+    {
+        std::ofstream out(rc, std::ios::app);
+        out << "append XSCHEM_LIBRARY_PATH :[file dirname [info script]]/cache\n";
+    }
+    const std::vector<std::string> edited = {lib_path, std::filesystem::canonical(cache_dir).string()};
+    expect("after the xschemrc was edited", edited, false);
+    expect("reuse after the edit", edited, true);
+
+    std::filesystem::remove_all(dir);
+    if (failures == 0) std::cout << "Config snapshot reused without probing and invalidated by edits\n";
+    return failures == 0;
+}
+
+// Time parse_xschemrc and check it resolves the same paths as the regex parser
+static int bench_rc(const std::string& rc_path, int iterations) {
+    std::vector<std::string> expected = legacy::parse_xschemrc_regex(rc_path);
+    std::vector<std::string> actual = xschem::parse_xschemrc(rc_path, false);
+
+    if (actual != expected) {
+        std::cerr << "FAIL: resolved paths differ\n  regex parser:\n";
+        for (const auto& p : expected) std::cerr << "    " << p << "\n";
+        std::cerr << "  parse_xschemrc:\n";
+        for (const auto& p : actual) std::cerr << "    " << p << "\n";
+        return 1;
+    }
+    std::cout << "Resolved " << actual.size() << " identical paths\n";
+
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) legacy::parse_xschemrc_regex(rc_path);
+    double regex_ms = elapsed_ms(start) / iterations;
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) xschem::parse_xschemrc(rc_path, false);
+    double eval_ms = elapsed_ms(start) / iterations;
+
+    // Config snapshot in a private cache directory: first call writes it
+    std::string cache_dir = (std::filesystem::temp_directory_path() /
+                             "xschem_bench_rc_cache").string();
+    std::filesystem::remove_all(cache_dir);
+    xschem::XschemrcConfig config;
+    xschem::load_xschemrc(rc_path, config, cache_dir);
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) xschem::load_xschemrc(rc_path, config, cache_dir);
+    double cached_ms = elapsed_ms(start) / iterations;
+    std::filesystem::remove_all(cache_dir);
+    if (config.library_paths != expected) {
+        std::cerr << "FAIL: config snapshot paths differ\n";
+        return 1;
+    }
+    if (!rc_snapshot_checks()) return 1;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "regex parser:    " << regex_ms << " ms/parse\n";
+    std::cout << "parse_xschemrc:  " << eval_ms << " ms/parse"
+              << " (" << std::setprecision(1) << regex_ms / eval_ms << "x)\n";
+    std::cout << std::setprecision(3);
+    std::cout << "config snapshot: " << cached_ms << " ms/load"
+              << " (" << std::setprecision(1) << regex_ms / cached_ms << "x)\n";
+    return 0;
+}
+
+static bool load_with(const std::string& sch_path, const std::vector<std::string>& paths,
+                      std::shared_ptr<const xschem::FileProvider> files, unsigned threads,
+                      xschem::Schematic& sch, double& ms) {
+    auto start = Clock::now();
+    xschem::SchematicParser parser;
+    parser.set_file_provider(std::move(files));
+    parser.set_prefetch_threads(threads);
+    for (const auto& p : paths) parser.add_symbol_path(p);
+    if (!parser.load(sch_path)) return false;
+    ms = elapsed_ms(start);
+    sch = std::move(parser.schematic());
+    return true;
+}
+
+// Time loading with symbols read one by one and with the prefetch pool,
+// under injected per-file latency, and check both give the same netlist
+static int bench_prefetch(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    double latency_ms = 2.0;
+    unsigned threads = 8;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--latency" && i + 1 < argc) latency_ms = std::atof(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::atoi(argv[++i]);
+        else sch_path = arg;
+    }
+
+    auto files = std::make_shared<LatencyFileProvider>(latency_ms);
+    xschem::Schematic serial, parallel;
+    double serial_ms = 0, parallel_ms = 0;
+    if (!load_with(sch_path, paths, files, 0, serial, serial_ms) ||
+        !load_with(sch_path, paths, files, threads, parallel, parallel_ms)) {
+        return 1;
+    }
+
+    std::ostringstream a, b;
+    xschem::generate_spice_netlist(serial, a);
+    xschem::generate_spice_netlist(parallel, b);
+    if (a.str() != b.str() || serial.dependencies != parallel.dependencies) {
+        std::cerr << "FAIL: prefetch changed the loaded design\n";
+        return 1;
+    }
+
+    std::cout << "Loaded " << parallel.symbols.size() << " symbols, "
+              << latency_ms << " ms latency per file access\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "sequential:          " << serial_ms << " ms\n";
+    std::cout << "prefetch (" << threads << " threads): " << parallel_ms << " ms"
+              << " (" << serial_ms / parallel_ms << "x)\n";
+    return 0;
+}
+
+// Compare parsing and resolving the .sch with reloading a binary snapshot
+static int bench_snapshot(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    int iterations = 50;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else sch_path = arg;
+    }
+
+    std::string snap_path = (std::filesystem::temp_directory_path() / "xschem_bench.xsnap").string();
+    xschem::Schematic sch;
+    if (!xschem::load_schematic(sch_path, sch, paths)) return 1;
+    xschem::NetResolver(sch).resolve();
+    if (!xschem::save_snapshot(sch, snap_path)) return 1;
+
+    std::ostringstream expected;
+    xschem::generate_spice_netlist(sch, expected);
+
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        xschem::Schematic s;
+        xschem::load_schematic(sch_path, s, paths);
+        xschem::NetResolver(s).resolve();
+    }
+    double parse_ms = elapsed_ms(start) / iterations;
+
+    start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        xschem::Schematic s;
+        xschem::load_snapshot(snap_path, s);
+    }
+    double load_ms = elapsed_ms(start) / iterations;
+
+    start = Clock::now();
+    size_t nets = 0;
+    for (int i = 0; i < iterations; i++) {
+        xschem::SnapshotView view;
+        view.open(snap_path);
+        for (const auto& inst : view.instances()) nets += inst.net_count;
+    }
+    double view_ms = elapsed_ms(start) / iterations;
+
+    xschem::Schematic reloaded;
+    xschem::load_snapshot(snap_path, reloaded);
+    std::ostringstream actual;
+    xschem::generate_spice_netlist(reloaded, actual);
+    std::filesystem::remove(snap_path);
+    if (actual.str() != expected.str()) {
+        std::cerr << "FAIL: netlist from snapshot differs\n";
+        return 1;
+    }
+
+    std::cout << sch.instances.size() << " instances, " << sch.wires.size() << " wires, "
+              << nets / iterations << " instance pins\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "parse + resolve .sch: " << parse_ms << " ms\n";
+    std::cout << "load_snapshot:        " << load_ms << " ms"
+              << " (" << std::setprecision(1) << parse_ms / load_ms << "x)\n";
+    std::cout << std::setprecision(3);
+    std::cout << "SnapshotView::open:   " << view_ms << " ms"
+              << " (" << std::setprecision(1) << parse_ms / view_ms << "x)\n";
+    return 0;
+}
+
+// Parse a generator option at argv[i], advancing i. False if not one.
+static bool parse_generator_option(int argc, char* argv[], int& i,
+                                   xschem_bench::GeneratorOptions& opts) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) return false;
+    if (arg == "--instances") opts.instances = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--wire-density") opts.wire_density = std::atof(argv[++i]);
+    else if (arg == "--label-ratio") opts.label_ratio = std::atof(argv[++i]);
+    else if (arg == "--rotation-mix") opts.rotation_mix = std::atof(argv[++i]);
+    else if (arg == "--depth") opts.hierarchy_depth = std::atoi(argv[++i]);
+    else if (arg == "--cell-instances") opts.cell_instances = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--seed") opts.seed = std::strtoull(argv[++i], nullptr, 10);
+    else if (arg == "--graphics") opts.graphics = std::atof(argv[++i]);
+    else return false;
+    return true;
+}
+
+static int bench_gen(int argc, char* argv[]) {
+    std::string out_dir;
+    xschem_bench::GeneratorOptions opts;
+    for (int i = 0; i < argc; i++) {
+        if (!parse_generator_option(argc, argv, i, opts)) out_dir = argv[i];
+    }
+    xschem_bench::GeneratorResult result;
+    if (out_dir.empty() || !xschem_bench::generate_design(out_dir, opts, result)) {
+        std::cerr << "Error: Cannot generate design in '" << out_dir << "'\n";
+        return 1;
+    }
+    std::cout << "Wrote " << result.top_schematic << ": " << result.instances << " instances, "
+              << result.wires << " wires\n";
+    return 0;
+}
+
+// Discards everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+static long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Load one schematic with each LoadOptions profile: best time, allocations
+// made by the load and what the result retains
+static int bench_load(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    int iterations = 5;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 5000;
+    opts.graphics = 20;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parse_generator_option(argc, argv, i, opts)) continue;
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--iterations" && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else sch_path = arg;
+    }
+
+    std::string work_dir;
+    if (sch_path.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_load").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        sch_path = gen.top_schematic;
+        paths.push_back(work_dir);
+    }
+
+    struct Profile { const char* name; xschem::LoadOptions options; };
+    const Profile profiles[] = {
+        {"full", xschem::LoadOptions::full()},
+        {"info", xschem::LoadOptions::info()},
+        {"netlist_only", xschem::LoadOptions::netlist_only()},
+    };
+
+    std::string expected;
+    double full_ms = 0;
+    uint64_t full_bytes = 0;
+    std::cout << std::setw(14) << std::left << "profile" << std::right << std::setw(10) << "ms"
+              << std::setw(12) << "allocs" << std::setw(14) << "alloc bytes" << std::setw(10) << "texts"
+              << "\n";
+    for (const auto& profile : profiles) {
+        double best_ms = 0;
+        xschem::StatsReport report;
+        size_t texts = 0;
+        for (int i = 0; i < iterations; i++) {
+            xschem::Stats stats;
+            xschem::Schematic sch;
+            auto start = Clock::now();
+            {
+                xschem::StatsScope scope(&stats);
+                if (!xschem::load_schematic(sch_path, sch, paths, profile.options)) return 1;
+            }
+            double ms = elapsed_ms(start);
+            if (i == 0 || ms < best_ms) best_ms = ms;
+            report = stats.report();
+            texts = sch.texts.size();
+
+            if (i == 0) {
+                std::ostringstream netlist;
+                xschem::generate_spice_netlist(sch, netlist);
+                if (expected.empty()) {
+                    expected = netlist.str();
+                } else if (netlist.str() != expected) {
+                    std::cerr << "FAIL: " << profile.name << " netlist differs from full load\n";
+                    return 1;
+                }
+            }
+        }
+        if (full_ms == 0) {
+            full_ms = best_ms;
+            full_bytes = report.allocated_bytes;
+        }
+        std::cout << std::setw(14) << std::left << profile.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << best_ms << std::setw(12) << report.allocations
+                  << std::setw(14) << report.allocated_bytes << std::setw(10) << texts;
+        if (full_ms > 0 && best_ms != full_ms) {
+            std::cout << "  (" << std::setprecision(1) << 100.0 * (1.0 - best_ms / full_ms) << "% time, "
+                      << 100.0 * (1.0 - double(report.allocated_bytes) / double(std::max<uint64_t>(full_bytes, 1)))
+                      << "% bytes saved)";
+        }
+        std::cout << "\n";
+    }
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+    return 0;
+}
+
+// Collects referenced symbols and lab= names, the kind of repository-wide
+// query the streaming parser is meant for
+class LabelScanner : public xschem::SchematicVisitor {
+public:
+    std::set<std::string> symbols;
+    std::set<std::string> labels;
+
+    void on_instance(const xschem::InstanceRecord& inst) override {
+        symbols.emplace(inst.symbol_name);
+        std::string lab = xschem::get_tok_value(std::string(inst.props), "lab");
+        if (!lab.empty()) labels.insert(std::move(lab));
+    }
+    bool wants_texts() const override { return false; }
+};
+
+// Time scan_schematic with a visitor against building each Schematic
+static int bench_scan(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 5000;
+    opts.graphics = 20;
+    for (int i = 0; i < argc; i++) {
+        if (!parse_generator_option(argc, argv, i, opts)) files.push_back(argv[i]);
+    }
+
+    std::string work_dir;
+    if (files.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_scan").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        files.push_back(gen.top_schematic);
+    }
+
+    LabelScanner scanner;
+    xschem::Stats scan_stats;
+    auto start = Clock::now();
+    {
+        xschem::StatsScope scope(&scan_stats);
+        for (const auto& f : files) {
+            if (!xschem::scan_schematic(f, scanner)) return 1;
+        }
+    }
+    double scan_ms = elapsed_ms(start);
+
+    // Same query from fully loaded schematics (symbols are not looked up)
+    std::set<std::string> load_labels;
+    xschem::Stats load_stats;
+    start = Clock::now();
+    {
+        xschem::StatsScope scope(&load_stats);
+        for (const auto& f : files) {
+            xschem::SchematicParser parser;
+            parser.set_prefetch_threads(0);
+            parser.add_symbol_path(std::filesystem::path(f).parent_path().string());
+            if (!parser.load(f)) return 1;
+            for (const auto& inst : parser.schematic().instances) {
+                auto it = inst.prop_map.find("lab");
+                if (it != inst.prop_map.end() && !it->second.empty()) load_labels.insert(it->second);
+            }
+        }
+    }
+    double load_ms = elapsed_ms(start);
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+
+    if (load_labels != scanner.labels) {
+        std::cerr << "FAIL: scanned labels differ from loaded labels\n";
+        return 1;
+    }
+    auto scan = scan_stats.report();
+    auto load = load_stats.report();
+    std::cout << files.size() << " files, " << scanner.symbols.size() << " symbols, "
+              << scanner.labels.size() << " labels\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "scan_schematic: " << scan_ms << " ms, " << scan.allocations << " allocs, "
+              << scan.allocated_bytes << " bytes\n";
+    std::cout << "load:           " << load_ms << " ms, " << load.allocations << " allocs, "
+              << load.allocated_bytes << " bytes (" << std::setprecision(1) << load_ms / scan_ms << "x)\n";
+    return 0;
+}
+
+struct ScaleRow {
+    size_t target_objects;
+    size_t instances, wires;
+    double generate_ms, parse_ms, resolve_ms, emit_ms;
+    long peak_rss_kb;
+};
+
+// Generate growing designs and time each stage on them. Sizes stop growing
+// once one run takes longer than the budget.
+static int bench_scale(int argc, char* argv[]) {
+    xschem_bench::GeneratorOptions opts;
+    std::vector<size_t> sizes = {1000, 10000, 100000, 1000000, 10000000};
+    double budget_s = 120;
+    std::string json_path, csv_path;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (parse_generator_option(argc, argv, i, opts)) continue;
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            std::stringstream ss(argv[++i]);
+            std::string item;
+            while (std::getline(ss, item, ',')) sizes.push_back(std::strtoull(item.c_str(), nullptr, 10));
+        } else if (arg == "--budget" && i + 1 < argc) {
+            budget_s = std::atof(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::string work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_scale").string();
+    std::vector<ScaleRow> rows;
+    NullBuffer null_buf;
+    std::ostream null_out(&null_buf);
+
+    std::cout << std::setw(10) << "objects" << std::setw(10) << "insts" << std::setw(10) << "wires"
+              << std::setw(12) << "gen ms" << std::setw(12) << "parse ms" << std::setw(12) << "resolve ms"
+              << std::setw(12) << "emit ms" << std::setw(12) << "rss KiB" << "\n";
+
+    for (size_t target : sizes) {
+        ScaleRow row{};
+        row.target_objects = target;
+        opts.instances = xschem_bench::instances_for_objects(target, opts);
+
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        auto start = Clock::now();
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        row.generate_ms = elapsed_ms(start);
+        row.instances = gen.instances;
+        row.wires = gen.wires;
+
+        xschem::Schematic sch;
+        start = Clock::now();
+        if (!xschem::load_schematic(gen.top_schematic, sch, {work_dir})) return 1;
+        row.parse_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        xschem::NetResolver(sch).resolve();
+        row.resolve_ms = elapsed_ms(start);
+
+        start = Clock::now();
+        xschem::generate_spice_netlist(sch, null_out);
+        row.emit_ms = elapsed_ms(start);
+        row.peak_rss_kb = peak_rss_kb();
+        rows.push_back(row);
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << std::setw(10) << row.target_objects << std::setw(10) << row.instances
+                  << std::setw(10) << row.wires << std::setw(12) << row.generate_ms
+                  << std::setw(12) << row.parse_ms << std::setw(12) << row.resolve_ms
+                  << std::setw(12) << row.emit_ms << std::setw(12) << row.peak_rss_kb << std::endl;
+
+        if ((row.parse_ms + row.resolve_ms + row.emit_ms) / 1000.0 > budget_s) {
+            std::cout << "Stopping: run exceeded the " << budget_s << " s budget\n";
+            break;
+        }
+    }
+    std::filesystem::remove_all(work_dir);
+
+    if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        out << std::fixed << std::setprecision(3);
+        out << "{\n  \"benchmark\": \"scale\",\n";
+        out << "  \"options\": {\"wire_density\": " << opts.wire_density
+            << ", \"label_ratio\": " << opts.label_ratio
+            << ", \"rotation_mix\": " << opts.rotation_mix
+            << ", \"hierarchy_depth\": " << opts.hierarchy_depth
+            << ", \"cell_instances\": " << opts.cell_instances
+            << ", \"seed\": " << opts.seed << "},\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < rows.size(); i++) {
+            const auto& r = rows[i];
+            out << "    {\"objects\": " << r.target_objects << ", \"instances\": " << r.instances
+                << ", \"wires\": " << r.wires << ", \"generate_ms\": " << r.generate_ms
+                << ", \"parse_ms\": " << r.parse_ms << ", \"resolve_ms\": " << r.resolve_ms
+                << ", \"emit_ms\": " << r.emit_ms << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}"
+                << (i + 1 < rows.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+    if (!csv_path.empty()) {
+        std::ofstream out(csv_path);
+        out << std::fixed << std::setprecision(3);
+        out << "objects,instances,wires,generate_ms,parse_ms,resolve_ms,emit_ms,peak_rss_kb\n";
+        for (const auto& r : rows) {
+            out << r.target_objects << "," << r.instances << "," << r.wires << ","
+                << r.generate_ms << "," << r.parse_ms << "," << r.resolve_ms << ","
+                << r.emit_ms << "," << r.peak_rss_kb << "\n";
+        }
+    }
+    return 0;
+}
+
+// Answer connectivity queries through the NetIndex built by resolve() and
+// by scanning every instance pin, and check both agree
+static int bench_index(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    size_t queries = 2000;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 2000;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--queries" && i + 1 < argc) queries = std::max(1L, std::atol(argv[++i]));
+        else if (!parse_generator_option(argc, argv, i, opts)) sch_path = arg;
+    }
+
+    std::string work_dir;
+    if (sch_path.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_index").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        sch_path = gen.top_schematic;
+        paths.push_back(work_dir);
+    }
+
+    xschem::Schematic sch;
+    double load_ms;
+    if (!load_with(sch_path, paths, std::make_shared<xschem::FileProvider>(), 0, sch, load_ms)) return 1;
+    auto start = Clock::now();
+    xschem::NetResolver(sch).resolve();
+    double resolve_ms = elapsed_ms(start);
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+
+    const xschem::NetIndex& index = sch.net_index;
+    if (index.net_count() == 0) {
+        std::cerr << "Error: No nets in " << sch_path << "\n";
+        return 1;
+    }
+    std::vector<uint32_t> picks(queries);
+    std::mt19937 rng(1);
+    for (auto& net : picks) net = static_cast<uint32_t>(rng() % index.net_count());
+
+    start = Clock::now();
+    size_t indexed_pins = 0;
+    for (uint32_t net : picks) {
+        uint32_t id = index.find(index.net_name(net));
+        for (const auto& ref : index.pins(id)) indexed_pins += ref.pin + 1;
+    }
+    double index_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    size_t scanned_pins = 0;
+    for (uint32_t net : picks) {
+        const std::string& name = index.net_name(net);
+        for (const auto& inst : sch.instances) {
+            for (size_t p = 0; p < inst.connected_nets.size(); p++) {
+                if (inst.connected_nets[p] == name) scanned_pins += p + 1;
+            }
+        }
+    }
+    double scan_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    size_t matched = index.match("net1*").size();
+    double match_ms = elapsed_ms(start);
+    size_t expected = 0;
+    for (size_t n = 0; n < index.net_count(); n++) {
+        if (index.net_name(static_cast<uint32_t>(n)).starts_with("net1")) expected++;
+    }
+
+    if (indexed_pins != scanned_pins || matched != expected) {
+        std::cerr << "FAIL: index and scan disagree\n";
+        return 1;
+    }
+    std::cout << sch.instances.size() << " instances, " << sch.wires.size() << " wires, "
+              << index.net_count() << " nets, " << queries << " queries\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "resolve (with index): " << resolve_ms << " ms\n";
+    std::cout << "pins via NetIndex:    " << index_ms << " ms\n";
+    std::cout << "pins via scan:        " << scan_ms << " ms"
+              << " (" << std::setprecision(1) << scan_ms / index_ms << "x)\n";
+    std::cout << std::setprecision(3);
+    std::cout << "match(\"net1*\"):       " << match_ms << " ms, " << matched << " nets\n";
+    return 0;
+}
+
+// Build a SpatialIndex over a loaded schematic and answer window and
+// nearest-pin queries through it and by scanning every object
+static int bench_spatial(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    size_t queries = 2000;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 200000;
+    opts.graphics = 2;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--queries" && i + 1 < argc) queries = std::max(1L, std::atol(argv[++i]));
+        else if (!parse_generator_option(argc, argv, i, opts)) sch_path = arg;
+    }
+
+    std::string work_dir;
+    if (sch_path.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_spatial").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        sch_path = gen.top_schematic;
+        paths.push_back(work_dir);
+    }
+
+    xschem::Schematic sch;
+    double load_ms;
+    if (!load_with(sch_path, paths, std::make_shared<xschem::FileProvider>(), 0, sch, load_ms)) return 1;
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+
+    auto start = Clock::now();
+    xschem::SpatialIndex index(sch);
+    double build_ms = elapsed_ms(start);
+    if (index.size() == 0) {
+        std::cerr << "Error: No objects in " << sch_path << "\n";
+        return 1;
+    }
+
+    // Windows of about 20 grid steps around random objects, and points near them
+    using Object = xschem::SpatialIndex::Object;
+    using Kind = xschem::SpatialIndex::Kind;
+    std::vector<xschem::Rect> windows(queries);
+    std::mt19937 rng(1);
+    const size_t wires = sch.wires.size(), instances = sch.instances.size();
+    for (auto& w : windows) {
+        size_t item = rng() % index.size();
+        Object object = item < wires ? Object{Kind::Wire, static_cast<uint32_t>(item)} :
+                        item < wires + instances ? Object{Kind::Instance, static_cast<uint32_t>(item - wires)} :
+                        Object{Kind::Text, static_cast<uint32_t>(item - wires - instances)};
+        const xschem::Rect& b = index.bounds(object);
+        w = {b.x1 - 100, b.y1 - 100, b.x1 + 100, b.y1 + 100};
+    }
+
+    start = Clock::now();
+    size_t found = 0;
+    std::vector<std::vector<Object>> results(queries);
+    for (size_t q = 0; q < queries; q++) {
+        results[q] = index.query(windows[q]);
+        found += results[q].size();
+    }
+    double query_ms = elapsed_ms(start);
+
+    start = Clock::now();
+    double pin_distance = 0;
+    size_t pin_hits = 0;
+    for (const auto& w : windows) {
+        xschem::SpatialIndex::PinHit hit;
+        if (index.nearest_pin(w.x1 + 37, w.y1 + 53, hit)) {
+            pin_distance += hit.distance;
+            pin_hits++;
+        }
+    }
+    double nearest_ms = elapsed_ms(start);
+
+    // Linear scans over a subset of the queries
+    const size_t checked = std::min<size_t>(queries, 50);
+    start = Clock::now();
+    bool agree = true;
+    for (size_t q = 0; q < checked; q++) {
+        std::vector<Object> expected;
+        auto scan = [&](Kind kind, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                Object object{kind, static_cast<uint32_t>(i)};
+                if (windows[q].intersects(index.bounds(object))) expected.push_back(object);
+            }
+        };
+        scan(Kind::Wire, wires);
+        scan(Kind::Instance, instances);
+        scan(Kind::Text, sch.texts.size());
+        if (expected != results[q]) agree = false;
+
+        double best = std::numeric_limits<double>::infinity();
+        for (const auto& inst : sch.instances) {
+            auto sym_it = sch.symbols.find(inst.symbol_name);
+            if (sym_it == sch.symbols.end()) continue;
+            for (const auto& pin : sym_it->second.pins) {
+                xschem::Point at = xschem::instance_point(inst, pin.x, pin.y);
+                best = std::min(best, std::hypot(at.x - windows[q].x1 - 37, at.y - windows[q].y1 - 53));
+            }
+        }
+        xschem::SpatialIndex::PinHit hit;
+        if (index.nearest_pin(windows[q].x1 + 37, windows[q].y1 + 53, hit) ? hit.distance != best :
+                                                                            best != std::numeric_limits<double>::infinity()) {
+            agree = false;
+        }
+    }
+    double scan_ms = elapsed_ms(start) * queries / checked;
+
+    if (!agree) {
+        std::cerr << "FAIL: index and scan disagree\n";
+        return 1;
+    }
+    std::cout << instances << " instances, " << wires << " wires, " << sch.texts.size() << " texts, "
+              << queries << " queries\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "build:                " << build_ms << " ms\n";
+    std::cout << "window queries:       " << query_ms << " ms, " << found << " objects\n";
+    std::cout << "nearest pin:          " << nearest_ms << " ms, " << pin_hits << " hits\n";
+    std::cout << "scan (estimated):     " << scan_ms << " ms"
+              << " (" << std::setprecision(1) << scan_ms / (query_ms + nearest_ms) << "x)\n";
+    return 0;
+}
+
+// Netlist each cell `repeat` times through the C interface on a shared
+// context from several threads, check every result against the C++ API,
+// and optionally time running the netlister binary once per cell instead
+static int bench_capi(int argc, char* argv[]) {
+    std::vector<std::string> cells, paths;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t repeat = 20;
+    std::string netlister;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--netlister" && i + 1 < argc) netlister = argv[++i];
+        else cells.push_back(arg);
+    }
+    if (cells.empty()) {
+        std::cerr << "Error: No input schematics\n";
+        return 1;
+    }
+
+    std::vector<std::string> expected(cells.size());
+    for (size_t c = 0; c < cells.size(); c++) {
+        xschem::Schematic sch;
+        std::ostringstream out;
+        if (!xschem::load_schematic(cells[c], sch, paths, xschem::LoadOptions::netlist_only()) ||
+            !xschem::generate_spice_netlist(sch, out)) {
+            return 1;
+        }
+        expected[c] = out.str();
+    }
+
+    xschem_context* ctx = xschem_context_new();
+    for (const auto& p : paths) xschem_context_add_symbol_path(ctx, p.c_str());
+    // Concurrent loads read their symbols on the context's one pool
+    xschem_context_set_option(ctx, XSCHEM_OPT_PREFETCH_THREADS, 4);
+
+    // Jobs are taken in turn by the threads; each job has its own handle
+    std::atomic<size_t> next{0}, failures{0};
+    const size_t jobs = cells.size() * repeat;
+    auto worker = [&] {
+        for (size_t job; (job = next++) < jobs;) {
+            const size_t c = job % cells.size();
+            xschem_schematic* sch = nullptr;
+            char* data = nullptr;
+            size_t size = 0;
+            if (xschem_load(ctx, cells[c].c_str(), &sch) != XSCHEM_OK ||
+                xschem_netlist_to_buffer(sch, XSCHEM_FORMAT_SPICE, &data, &size) != XSCHEM_OK ||
+                std::string_view(data, size) != expected[c]) {
+                if (failures++ == 0) std::cerr << "FAIL: " << cells[c] << ": " << xschem_last_error() << "\n";
+            }
+            xschem_buffer_free(data);
+            xschem_schematic_free(sch);
+        }
+    };
+    auto start = Clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker);
+    for (auto& t : pool) t.join();
+    double in_process_ms = elapsed_ms(start);
+    xschem_context_free(ctx);
+    if (failures > 0) {
+        std::cerr << "FAIL: " << failures << " of " << jobs << " netlists differ\n";
+        return 1;
+    }
+
+    std::cout << jobs << " netlists of " << cells.size() << " cells on " << threads << " threads\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "in process:           " << in_process_ms << " ms (" << in_process_ms / jobs << " ms/cell)\n";
+    if (!netlister.empty()) {
+        std::string out = (std::filesystem::temp_directory_path() / "xschem_bench_capi.spice").string();
+        std::string include;
+        for (const auto& p : paths) include += " -I '" + p + "'";
+        const size_t runs = std::min<size_t>(jobs, 50);
+        start = Clock::now();
+        for (size_t job = 0; job < runs; job++) {
+            std::string command = "'" + netlister + "'" + include + " '" + cells[job % cells.size()] + "' '" +
+                                  out + "' >/dev/null";
+            if (std::system(command.c_str()) != 0) {
+                std::cerr << "Error: " << command << " failed\n";
+                return 1;
+            }
+        }
+        double process_ms = elapsed_ms(start) / runs;
+        std::filesystem::remove(out);
+        std::cout << "process per cell:     " << process_ms << " ms/cell, one at a time ("
+                  << std::setprecision(1) << process_ms * jobs / in_process_ms << "x)\n";
+    }
+    return 0;
+}
+
+// Write wires and instances of a loaded schematic with each symbol's file
+// embedded after its first instance, as xschem saves with embed=true. With
+// first_only, later placements of a symbol do not carry embed=true.
+static bool write_embedded(const xschem::Schematic& sch, const std::vector<std::string>& paths,
+                           const std::string& out_path, bool first_only = false) {
+    xschem::SchematicParser parser;
+    for (const auto& p : paths) parser.add_symbol_path(p);
+    std::ofstream out(out_path);
+    auto num = [&out](double v) -> std::ostream& {
+        char buf[32];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+        return out.write(buf, end - buf);
+    };
+    out << "v {" << sch.version << "}\nK {" << sch.K_props << "}\n";
+    for (const auto& w : sch.wires) {
+        out << "N ";
+        num(w.x1) << ' ';
+        num(w.y1) << ' ';
+        num(w.x2) << ' ';
+        num(w.y2) << " {" << w.props << "}\n";
+    }
+    std::set<std::string> embedded;
+    for (const auto& inst : sch.instances) {
+        out << "C {" << inst.symbol_name << "} ";
+        num(inst.x) << ' ';
+        bool first = embedded.insert(inst.symbol_name).second;
+        num(inst.y) << ' ' << inst.rot << ' ' << inst.flip << " {" << inst.props
+                    << (first || !first_only ? " embed=true}\n" : "}\n");
+        if (!first) continue;
+        std::string path = parser.find_symbol_file(inst.symbol_name);
+        std::ifstream in(path);
+        if (path.empty() || !in) {
+            std::cerr << "Error: Cannot find symbol " << inst.symbol_name << "\n";
+            return false;
+        }
+        out << "[\n" << in.rdbuf() << "\n]\n";
+    }
+    return static_cast<bool>(out);
+}
+
+// Netlist a design and its self-contained copy, counting file I/O
+static int bench_embed(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 100000;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (!parse_generator_option(argc, argv, i, opts)) sch_path = arg;
+    }
+
+    const std::string work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_embed").string();
+    std::filesystem::remove_all(work_dir);
+    if (sch_path.empty()) {
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir + "/lib", opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        sch_path = gen.top_schematic;
+        paths.push_back(work_dir + "/lib");
+    }
+
+    // Netlist body without the sch_path header, and the run's file I/O
+    struct Run {
+        std::string netlist;
+        double ms = 0;
+        xschem::StatsReport io;
+    };
+    auto netlist = [](const std::string& path, const std::vector<std::string>& symbol_paths, Run& run) {
+        xschem::Stats stats;
+        xschem::StatsScope scope(&stats);
+        auto start = Clock::now();
+        xschem::Schematic sch;
+        if (!xschem::load_schematic(path, sch, symbol_paths, xschem::LoadOptions::netlist_only())) return false;
+        std::ostringstream out;
+        if (!xschem::generate_spice_netlist(sch, out)) return false;
+        run.ms = elapsed_ms(start);
+        run.io = stats.report();
+        run.netlist = out.str();
+        run.netlist.erase(0, run.netlist.find('\n') + 1);
+        return true;
+    };
+
+    Run original, embedded, first_only;
+    xschem::Schematic sch;
+    // Same file name: the subcircuit is named after it
+    const std::string file_name = std::filesystem::path(sch_path).filename().string();
+    const std::string embedded_path = work_dir + "/embedded/" + file_name;
+    const std::string first_only_path = work_dir + "/first_only/" + file_name;
+    std::filesystem::create_directories(work_dir + "/embedded");
+    std::filesystem::create_directories(work_dir + "/first_only");
+    bool ok = netlist(sch_path, paths, original) &&
+              xschem::load_schematic(sch_path, sch, paths) &&
+              write_embedded(sch, paths, embedded_path) &&
+              netlist(embedded_path, {}, embedded) &&
+              write_embedded(sch, paths, first_only_path, true) &&
+              netlist(first_only_path, {}, first_only);
+    std::filesystem::remove_all(work_dir);
+    if (!ok) return 1;
+    // Later placements without embed=true must use the embedded symbol
+    // without looking it up
+    for (const auto& [what, run] : {std::pair<const char*, const Run*>{"embedded copy", &embedded},
+                                    {"copy with embed=true on first placements", &first_only}}) {
+        if (run->netlist != original.netlist) {
+            auto [want, got] = std::mismatch(original.netlist.begin(), original.netlist.end(),
+                                             run->netlist.begin(), run->netlist.end());
+            size_t line = std::count(original.netlist.begin(), want, '\n') + 2;
+            std::cerr << "FAIL: " << what << " netlists differently from line " << line << "\n";
+            return 1;
+        }
+        if (run->io.files_opened != 1 || run->io.exists_probes != 0) {
+            std::cerr << "FAIL: " << what << " opened " << run->io.files_opened << " files, probed "
+                      << run->io.exists_probes << " paths\n";
+            return 1;
+        }
+    }
+
+    std::cout << sch.instances.size() << " instances, " << sch.symbols.size() << " symbols\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "symbol files:         " << original.ms << " ms, " << original.io.files_opened
+              << " files, " << original.io.exists_probes << " probes\n";
+    std::cout << "embedded:             " << embedded.ms << " ms, " << embedded.io.files_opened
+              << " file, " << embedded.io.exists_probes << " probes\n";
+    return 0;
+}
+
+// Cut each horizontal and vertical wire into `pieces` segments, between
+// grid points so that no new point meets a pin, and lay a copy over every
+// fourth wire
+static void split_wires(xschem::Schematic& sch, size_t pieces) {
+    std::vector<xschem::Wire> wires;
+    wires.reserve(sch.wires.size() * (pieces + 1));
+    for (size_t i = 0; i < sch.wires.size(); i++) {
+        const xschem::Wire& w = sch.wires[i];
+        if (w.x1 != w.x2 && w.y1 != w.y2) {
+            wires.push_back(w);
+            continue;
+        }
+        double x = w.x1, y = w.y1;
+        for (size_t k = 1; k <= pieces; k++) {
+            xschem::Wire piece = w;
+            piece.x1 = x;
+            piece.y1 = y;
+            if (k < pieces) {
+                x = w.x1 + (w.x2 - w.x1) * k / pieces + (w.x1 != w.x2 ? 0.37 : 0);
+                y = w.y1 + (w.y2 - w.y1) * k / pieces + (w.y1 != w.y2 ? 0.37 : 0);
+            } else {
+                x = w.x2;
+                y = w.y2;
+            }
+            piece.x2 = x;
+            piece.y2 = y;
+            wires.push_back(std::move(piece));
+        }
+        if (i % 4 == 0) wires.push_back(w);
+    }
+    sch.wires = std::move(wires);
+}
+
+// Resolve a design with split and overlapping wires as loaded and after
+// normalize_wires, and check both connect like the original
+static int bench_merge(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    size_t pieces = 4;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 100000;
+    opts.label_ratio = 0;   // Shorted labels name pins by wire order
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--pieces" && i + 1 < argc) pieces = std::max(1L, std::atol(argv[++i]));
+        else if (!parse_generator_option(argc, argv, i, opts)) sch_path = arg;
+    }
+
+    std::string work_dir;
+    if (sch_path.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_merge").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        sch_path = gen.top_schematic;
+        paths.push_back(work_dir);
+    }
+
+    xschem::Schematic original;
+    double load_ms;
+    if (!load_with(sch_path, paths, std::make_shared<xschem::FileProvider>(), 0, original, load_ms)) return 1;
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+
+    // The original is normalized too: merging joins overlapping wires that
+    // it may already have
+    xschem::Schematic split = original, merged;
+    split_wires(split, pieces);
+    merged = split;
+    xschem::normalize_wires(original);
+
+    auto resolve = [](xschem::Schematic& sch) {
+        auto start = Clock::now();
+        xschem::NetResolver resolver(sch);
+        resolver.resolve();
+        return elapsed_ms(start);
+    };
+    resolve(original);
+    double split_ms = resolve(split);
+    auto start = Clock::now();
+    size_t removed = xschem::normalize_wires(merged);
+    double merge_ms = elapsed_ms(start);
+    double merged_ms = resolve(merged);
+
+    // Instances are the same in both; their pins must group into the same
+    // nets, whatever the nets are called
+    std::unordered_map<std::string, std::string> forward, backward;
+    for (size_t i = 0; i < original.instances.size(); i++) {
+        const auto& want = original.instances[i].connected_nets;
+        const auto& got = merged.instances[i].connected_nets;
+        bool same = want.size() == got.size();
+        for (size_t p = 0; same && p < want.size(); p++) {
+            same = forward.try_emplace(want[p], got[p]).first->second == got[p] &&
+                   backward.try_emplace(got[p], want[p]).first->second == want[p];
+        }
+        if (!same) {
+            std::cerr << "FAIL: merged wires connect " << original.instances[i].inst_name << " differently\n";
+            return 1;
+        }
+    }
+
+    std::cout << split.instances.size() << " instances, " << split.wires.size() << " wires after splitting, "
+              << removed << " removed by merging\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "resolve (split):      " << split_ms << " ms\n";
+    std::cout << "normalize_wires:      " << merge_ms << " ms\n";
+    std::cout << "resolve (merged):     " << merged_ms << " ms"
+              << " (" << std::setprecision(1) << split_ms / (merge_ms + merged_ms) << "x with merging)\n";
+    return 0;
+}
+
+// Load a hierarchical design through FlatDesign, count its flat devices
+// and write the flat netlist on one thread and on all cores
+static int bench_flatten(int argc, char* argv[]) {
+    std::string sch_path;
+    std::vector<std::string> paths;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 2000;
+    opts.hierarchy_depth = 3;
+    opts.cell_instances = 64;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (!parse_generator_option(argc, argv, i, opts)) sch_path = arg;
+    }
+
+    std::string work_dir;
+    if (sch_path.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_flatten").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        sch_path = gen.top_schematic;
+        paths.push_back(work_dir);
+    }
+
+    // The same design loaded for one thread and for all cores
+    xschem::FlattenOptions serial_options;
+    serial_options.threads = 1;
+    xschem::FlatDesign serial, parallel;
+    double serial_load_ms = 0, parallel_load_ms = 0;
+    bool loaded = false;
+    for (auto [design, options, ms] : {std::tuple{&serial, serial_options, &serial_load_ms},
+                                       std::tuple{&parallel, xschem::FlattenOptions(), &parallel_load_ms}}) {
+        auto start = Clock::now();
+        loaded = design->load(sch_path, paths, options);
+        *ms = elapsed_ms(start);
+        if (!loaded) break;
+    }
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+    if (!loaded) {
+        std::cerr << "Error: Failed to load " << sch_path << "\n";
+        return 1;
+    }
+
+    auto start = Clock::now();
+    uint64_t devices = 0, pins = 0;
+    size_t depth = 0;
+    std::string deepest;
+    parallel.for_each_device([&](const xschem::FlatDesign::InstancePath& path,
+                                 const xschem::FlatDesign::Device& device) {
+        devices++;
+        pins += device.nets.size();
+        if (path.size() > depth) {
+            depth = path.size();
+            deepest = parallel.device_name(path, device);
+        }
+    });
+    double walk_ms = elapsed_ms(start);
+    if (devices != parallel.device_count()) {
+        std::cerr << "FAIL: walked " << devices << " devices, expected " << parallel.device_count() << "\n";
+        return 1;
+    }
+
+    std::ostringstream serial_out, parallel_out;
+    start = Clock::now();
+    bool written = serial.write_spice(serial_out);
+    double serial_ms = elapsed_ms(start);
+    start = Clock::now();
+    written = parallel.write_spice(parallel_out) && written;
+    double parallel_ms = elapsed_ms(start);
+    if (!written || serial_out.str() != parallel_out.str()) {
+        std::cerr << "FAIL: parallel and serial netlists differ\n";
+        return 1;
+    }
+
+    std::cout << parallel.cell_count() << " cells, " << devices << " flat devices, "
+              << parallel.net_count() << " flat nets, depth " << depth << "\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "load (1 thread):      " << serial_load_ms << " ms\n";
+    std::cout << "load (all cores):     " << parallel_load_ms << " ms\n";
+    std::cout << "walk:                 " << walk_ms << " ms, " << pins << " pins\n";
+    std::cout << "write (1 thread):     " << serial_ms << " ms, " << serial_out.str().size() << " bytes\n";
+    std::cout << "write (all cores):    " << parallel_ms << " ms"
+              << " (" << std::setprecision(1) << serial_ms / parallel_ms << "x)\n";
+    std::cout << "deepest:              " << deepest << "\n";
+    return 0;
+}
+
+// The outputs of one loaded schematic: SPICE, Verilog and JSON netlists
+// and ERC messages, and the snapshot bytes if `snapshot` is given
+static bool stable_outputs(xschem::Schematic& sch, std::string& text, std::string* snapshot) {
+    xschem::NetResolver resolver(sch);
+    resolver.resolve();
+    xschem::NetTable nets(sch);
+    std::ostringstream out;
+    xschem::SpiceNetlister spice(sch);
+    spice.set_net_table(&nets);
+    if (!spice.generate(out) || !xschem::VerilogNetlister(sch, nets).generate(out) ||
+        !xschem::JsonNetlister(sch, nets).generate(out)) {
+        return false;
+    }
+    for (const auto& v : sch.erc) out << v.message << "\n";
+    text = out.str();
+    if (snapshot) {
+        std::string path = (std::filesystem::temp_directory_path() / "xschem_bench_stable.snap").string();
+        if (!xschem::save_snapshot(sch, path)) return false;
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream bytes;
+        bytes << in.rdbuf();
+        *snapshot = bytes.str();
+        in.close();
+        std::filesystem::remove(path);
+    }
+    return true;
+}
+
+// Check outputs are byte-identical across runs, symbol prefetch and
+// flattening thread counts, and with the design moved by an offset, which
+// changes every point hash and so the order of the resolver's hash maps
+static int bench_stable(int argc, char* argv[]) {
+    std::vector<std::string> cells, paths;
+    size_t runs = 3;
+    std::string netlister;
+    xschem_bench::GeneratorOptions opts;
+    opts.instances = 20000;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--runs" && i + 1 < argc) runs = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--netlister" && i + 1 < argc) netlister = argv[++i];
+        else if (!parse_generator_option(argc, argv, i, opts)) cells.push_back(arg);
+    }
+
+    std::string work_dir;
+    if (cells.empty()) {
+        work_dir = (std::filesystem::temp_directory_path() / "xschem_bench_stable").string();
+        std::filesystem::remove_all(work_dir);
+        xschem_bench::GeneratorResult gen;
+        if (!xschem_bench::generate_design(work_dir, opts, gen)) {
+            std::cerr << "Error: Cannot generate design in " << work_dir << "\n";
+            return 1;
+        }
+        cells.push_back(gen.top_schematic);
+        paths.push_back(work_dir);
+    }
+
+    // Fixed, not the core count: a single-core runner must still compare
+    // one thread with several
+    constexpr unsigned threads = 8;
+    size_t failures = 0, compared = 0;
+    auto check = [&](const std::string& cell, const std::string& what, const std::string& want,
+                     const std::string& got) {
+        compared++;
+        if (want == got) return;
+        if (failures++ < 10) std::cerr << "FAIL: " << cell << ": " << what << " differs\n";
+    };
+
+    auto start = Clock::now();
+    for (const auto& cell : cells) {
+        std::string reference, reference_snapshot;
+        for (size_t run = 0; run < runs; run++) {
+            // Prefetch on one thread, then on several
+            xschem::Schematic sch;
+            double ms;
+            if (!load_with(cell, paths, std::make_shared<xschem::FileProvider>(), run % 2 ? threads : 1, sch, ms)) {
+                std::cerr << "Error: Failed to load " << cell << "\n";
+                return 1;
+            }
+            xschem::Schematic moved = sch;
+            for (auto& w : moved.wires) {
+                w.x1 += 12340; w.x2 += 12340;
+                w.y1 -= 5670; w.y2 -= 5670;
+            }
+            for (auto& inst : moved.instances) {
+                inst.x += 12340;
+                inst.y -= 5670;
+            }
+
+            std::string text, snapshot, text_moved;
+            if (!stable_outputs(sch, text, &snapshot) || !stable_outputs(moved, text_moved, nullptr)) {
+                std::cerr << "Error: Cannot netlist " << cell << "\n";
+                return 1;
+            }
+            if (run == 0) {
+                reference = text;
+                reference_snapshot = snapshot;
+            }
+            const std::string name = "run " + std::to_string(run);
+            check(cell, "netlists of " + name, reference, text);
+            check(cell, "snapshot of " + name, reference_snapshot, snapshot);
+            check(cell, "moved design netlists of " + name, text, text_moved);
+        }
+
+        std::string flat[2];
+        for (int t = 0; t < 2; t++) {
+            xschem::FlattenOptions options;
+            options.threads = t ? threads : 1;
+            xschem::FlatDesign design;
+            std::ostringstream out;
+            if (!design.load(cell, paths, options) || !design.write_spice(out)) {
+                std::cerr << "Error: Cannot flatten " << cell << "\n";
+                return 1;
+            }
+            flat[t] = out.str();
+        }
+        check(cell, "flat netlist on " + std::to_string(threads) + " threads", flat[0], flat[1]);
+
+        // Separate processes: --info lists properties and the netlist
+        // numbers unnamed nets the same every time
+        if (!netlister.empty()) {
+            std::string include;
+            for (const auto& p : paths) include += " -I '" + p + "'";
+            std::string outputs[2];
+            const std::string info = (std::filesystem::temp_directory_path() / "xschem_bench_stable.txt").string();
+            const std::string spice = (std::filesystem::temp_directory_path() / "xschem_bench_stable.spice").string();
+            for (auto& output : outputs) {
+                std::string command = "'" + netlister + "'" + include + " --info '" + cell + "' >'" + info +
+                                      "' && '" + netlister + "'" + include + " '" + cell + "' '" + spice +
+                                      "' >/dev/null";
+                if (std::system(command.c_str()) != 0) {
+                    std::cerr << "Error: " << command << " failed\n";
+                    return 1;
+                }
+                std::ifstream info_in(info), spice_in(spice);
+                std::ostringstream text;
+                text << info_in.rdbuf() << spice_in.rdbuf();
+                output = text.str();
+            }
+            std::filesystem::remove(info);
+            std::filesystem::remove(spice);
+            check(cell, "--info and netlist of two processes", outputs[0], outputs[1]);
+        }
+    }
+    double check_ms = elapsed_ms(start);
+    if (!work_dir.empty()) std::filesystem::remove_all(work_dir);
+    if (failures > 0) {
+        std::cerr << "FAIL: " << failures << " of " << compared << " comparisons differ\n";
+        return 1;
+    }
+
+    std::cout << cells.size() << " cells, " << compared << " outputs byte-identical over " << runs
+              << " runs, 1 and " << threads << " threads and a moved copy\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "check:                " << check_ms << " ms\n";
+    return 0;
+}
+
+// Recursive descent over one JSON value, enough to tell whether a document
+// parses; stops at the first error
+class JsonChecker {
+public:
+    explicit JsonChecker(std::string_view text) : m_text(text) {}
+
+    // Whether the text is exactly one JSON value; `where` is the error offset
+    bool valid(size_t& where) {
+        bool ok = value() && (space(), m_pos == m_text.size());
+        where = m_pos;
+        return ok;
+    }
+
+private:
+    std::string_view m_text;
+    size_t m_pos = 0;
+
+    void space() {
+        while (m_pos < m_text.size() && std::strchr(" \t\r\n", m_text[m_pos])) m_pos++;
+    }
+    bool eat(char c) {
+        space();
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+    bool literal(std::string_view word) {
+        if (m_text.substr(m_pos, word.size()) != word) return false;
+        m_pos += word.size();
+        return true;
+    }
+    bool string() {
+        if (!eat('"')) return false;
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            if (c == '\\') {
+                if (m_pos >= m_text.size()) return false;
+                char e = m_text[m_pos++];
+                if (e == 'u') {
+                    for (int i = 0; i < 4; i++, m_pos++) {
+                        if (m_pos >= m_text.size() || !std::isxdigit(static_cast<unsigned char>(m_text[m_pos]))) return false;
+                    }
+                } else if (!std::strchr("\"\\/bfnrt", e)) {
+                    return false;
+                }
+            }
+        }
+        return false;
+    }
+    bool number() {
+        size_t start = m_pos;
+        if (m_pos < m_text.size() && m_text[m_pos] == '-') m_pos++;
+        auto digits = [this] {
+            size_t from = m_pos;
+            while (m_pos < m_text.size() && std::isdigit(static_cast<unsigned char>(m_text[m_pos]))) m_pos++;
+            return m_pos > from;
+        };
+        if (!digits()) return false;
+        if (m_pos < m_text.size() && m_text[m_pos] == '.' && (m_pos++, !digits())) return false;
+        if (m_pos < m_text.size() && (m_text[m_pos] == 'e' || m_text[m_pos] == 'E')) {
+            m_pos++;
+            if (m_pos < m_text.size() && (m_text[m_pos] == '+' || m_text[m_pos] == '-')) m_pos++;
+            if (!digits()) return false;
+        }
+        return m_pos > start;
+    }
+    bool value() {
+        space();
+        if (m_pos >= m_text.size()) return false;
+        char c = m_text[m_pos];
+        if (c == '{') {
+            m_pos++;
+            if (eat('}')) return true;
+            do {
+                if (!string() || !eat(':') || !value()) return false;
+            } while (eat(','));
+            return eat('}');
+        }
+        if (c == '[') {
+            m_pos++;
+            if (eat(']')) return true;
+            do {
+                if (!value()) return false;
+            } while (eat(','));
+            return eat(']');
+        }
+        if (c == '"') return string();
+        if (c == 't') return literal("true");
+        if (c == 'f') return literal("false");
+        if (c == 'n') return literal("null");
+        return number();
+    }
+};
+
+static bool read_text(const std::string& path, std::string& text) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::ostringstream buf;
+    buf << in.rdbuf();
+    text = buf.str();
+    return true;
+}
+
+// Run the netlister with each document on stdout and check stdout holds
+// exactly what the same option writes to a file, and that JSON parses
+static int bench_stdout(int argc, char* argv[]) {
+    std::vector<std::string> cells, paths;
+    std::string netlister;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-I" && i + 1 < argc) paths.push_back(argv[++i]);
+        else if (arg == "--netlister" && i + 1 < argc) netlister = argv[++i];
+        else cells.push_back(arg);
+    }
+    if (cells.empty() || netlister.empty()) {
+        std::cerr << "Error: stdout needs schematics and --netlister\n";
+        return 1;
+    }
+
+    const auto tmp = std::filesystem::temp_directory_path();
+    const std::string captured = (tmp / "xschem_bench_stdout.txt").string();
+    const std::string document = (tmp / "xschem_bench_stdout.doc").string();
+    const std::string spice = (tmp / "xschem_bench_stdout.spice").string();
+    std::string include;
+    for (const auto& p : paths) include += " -I '" + p + "'";
+
+    size_t failures = 0, checked = 0;
+    for (const auto& cell : cells) {
+        for (const char* option : {"--json", "--verilog"}) {
+            const std::string base = "'" + netlister + "'" + include + " " + option;
+            const std::string to_stdout = base + " - '" + cell + "' '" + spice + "' >'" + captured + "' 2>/dev/null";
+            const std::string to_file = base + " '" + document + "' '" + cell + "' '" + spice + "' >/dev/null 2>&1";
+            for (const auto& command : {to_stdout, to_file}) {
+                if (std::system(command.c_str()) != 0) {
+                    std::cerr << "Error: " << command << " failed\n";
+                    return 1;
+                }
+            }
+            std::string got, want;
+            if (!read_text(captured, got) || !read_text(document, want)) {
+                std::cerr << "Error: Cannot read the outputs for " << cell << "\n";
+                return 1;
+            }
+            checked++;
+            size_t where = 0;
+            if (got != want) {
+                std::cerr << "FAIL: " << cell << ": " << option << " - differs from the file output\n";
+                failures++;
+            } else if (std::string_view(option) == "--json" && !JsonChecker(got).valid(where)) {
+                std::cerr << "FAIL: " << cell << ": --json - does not parse at byte " << where << "\n";
+                failures++;
+            }
+        }
+
+        // Run metrics differ between runs: they only have to parse
+        const std::string stats = "'" + netlister + "'" + include + " --stats-json - '" + cell + "' '" + spice +
+                                  "' >'" + captured + "' 2>/dev/null";
+        std::string got;
+        if (std::system(stats.c_str()) != 0 || !read_text(captured, got)) {
+            std::cerr << "Error: " << stats << " failed\n";
+            return 1;
+        }
+        checked++;
+        size_t where = 0;
+        if (!JsonChecker(got).valid(where)) {
+            std::cerr << "FAIL: " << cell << ": --stats-json - does not parse at byte " << where << "\n";
+            failures++;
+        }
+    }
+    for (const auto& f : {captured, document, spice}) std::filesystem::remove(f);
+    if (failures > 0) {
+        std::cerr << "FAIL: " << failures << " of " << checked << " stdout outputs\n";
+        return 1;
+    }
+    std::cout << cells.size() << " cells, " << checked << " stdout outputs hold only their document\n";
+    return 0;
+}
+
+// A netlist_commands block is written to SPICE only: Verilog and JSON list
+// devices, here the four copies of R[3:0]
+static int bench_devices() {
+    const auto dir = std::filesystem::temp_directory_path() / "xschem_bench_devices";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    {
+        std::ofstream res(dir / "res.sym");
+        res << "v {xschem version=3.4.5 file_version=1.2}\n"
+               "K {type=resistor\nformat=\"@name @pinlist @value m=@m\"\ntemplate=\"name=R1 value=1k m=1\"}\n"
+               "B 5 -2.5 -32.5 2.5 -27.5 {name=P dir=inout}\n"
+               "B 5 -2.5 27.5 2.5 32.5 {name=M dir=inout}\n";
+        std::ofstream code(dir / "code.sym");
+        code << "v {xschem version=3.4.5 file_version=1.2}\n"
+                "K {type=netlist_commands\nformat=\"@value\"\ntemplate=\"name=s1 value=\\\".tran 1n 10n\\\"\"}\n";
+        std::ofstream sch(dir / "top.sch");
+        sch << "v {xschem version=3.4.5 file_version=1.2}\n"
+               "C {res.sym} 0 0 0 0 {name=R[3:0] value=1k m=1}\n"
+               "C {code.sym} 200 0 0 0 {name=s1 value=\".tran 1n 10n\"}\n";
+    }
+
+    xschem::Schematic sch;
+    std::ostringstream spice, verilog, json;
+    bool ok = xschem::load_schematic((dir / "top.sch").string(), sch, {dir.string()});
+    if (ok) {
+        xschem::NetResolver resolver(sch);
+        resolver.resolve();
+        xschem::NetTable nets(sch);
+        xschem::SpiceNetlister netlister(sch);
+        netlister.set_net_table(&nets);
+        ok = netlister.generate(spice) && xschem::VerilogNetlister(sch, nets).generate(verilog) &&
+             xschem::JsonNetlister(sch, nets).generate(json);
+    }
+    std::filesystem::remove_all(dir);
+    if (!ok) {
+        std::cerr << "Error: Cannot netlist the devices test schematic\n";
+        return 1;
+    }
+
+    auto count = [](const std::string& text, std::string_view what) {
+        size_t n = 0;
+        for (size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1)) n++;
+        return n;
+    };
+    size_t where = 0;
+    const std::string json_text = json.str();
+    struct Check {
+        const char* what;
+        bool pass;
+    } checks[] = {
+        {"SPICE has the code block", count(spice.str(), ".tran 1n 10n") == 1},
+        {"SPICE has 4 resistors", count(spice.str(), "\nR") == 4},
+        {"Verilog has no code block instance", count(verilog.str(), "code") == 0},
+        {"Verilog has 4 resistors", count(verilog.str(), "\n  res ") == 4},
+        {"JSON parses", JsonChecker(json_text).valid(where)},
+        {"JSON has no code block instance", count(json_text, "code.sym") == 0},
+        {"JSON has 4 resistors", count(json_text, "\"symbol\": \"res.sym\"") == 4},
+    };
+    size_t failures = 0;
+    for (const auto& check : checks) {
+        if (check.pass) continue;
+        std::cerr << "FAIL: " << check.what << "\n";
+        failures++;
+    }
+    if (failures > 0) return 1;
+    std::cout << "Code block in SPICE only, 4 devices in SPICE, Verilog and JSON\n";
+    return 0;
+}
+
+// Synthetic transistor netlist: MOS devices and resistors on mostly local
+// generated nets, a few named nets and the supplies. `order` and `names`
+// permute the element lines and the generated net names.
+static std::string synthetic_spice(size_t devices, uint32_t seed, const std::vector<size_t>& order,
+                                   const std::vector<size_t>& names, size_t rewire = SIZE_MAX) {
+    std::mt19937 rng(seed);
+    const size_t nets = devices / 2 + 1;
+    std::vector<std::string> lines(devices);
+    auto net = [&](size_t i) {
+        size_t n = std::min(nets - 1, i / 2 + rng() % 4);
+        if (n % 97 == 0) return "sig" + std::to_string(n);
+        return "net" + std::to_string(names[n]);
+    };
+    for (size_t i = 0; i < devices; i++) {
+        std::string d = net(i), g = net(i), s = net(i);
+        if (i == rewire) g = "sig0";
+        if (i % 5 == 4) {
+            lines[i] = "R" + std::to_string(i) + " " + d + " " + s + " " + std::to_string(1 + rng() % 9) + "k\n";
+        } else if (rng() % 2) {
+            lines[i] = "XM" + std::to_string(i) + " " + d + " " + g + " " + s +
+                       " VNB nfet_01v8 L=0.15 W=" + std::to_string(1 + rng() % 4) + "\n";
+        } else {
+            lines[i] = "XM" + std::to_string(i) + " " + d + " " + g + " " + s +
+                       " VPB pfet_01v8 L=0.15 W=" + std::to_string(1 + rng() % 4) + "\n";
+        }
+    }
+    std::string text = ".subckt top VNB VPB\n";
+    for (size_t i : order) text += lines[i];
+    return text + ".ends\n";
+}
+
+// Time the structural comparison on a large netlist and check it sees
+// through element order and net names, and still finds one changed pin
+static int bench_lvs(int argc, char* argv[]) {
+    size_t devices = 200000;
+    uint32_t seed = 1;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--devices" && i + 1 < argc) devices = std::max(1L, std::atol(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc) seed = static_cast<uint32_t>(std::atol(argv[++i]));
+    }
+
+    std::vector<size_t> order(devices), names(devices / 2 + 1);
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    for (size_t i = 0; i < names.size(); i++) names[i] = i;
+    const std::string reference = synthetic_spice(devices, seed, order, names);
+
+    std::mt19937 rng(seed + 1);
+    std::shuffle(order.begin(), order.end(), rng);
+    std::shuffle(names.begin(), names.end(), rng);
+    const std::string shuffled = synthetic_spice(devices, seed, order, names);
+    const std::string changed = synthetic_spice(devices, seed, order, names, devices / 3);
+
+    auto start = Clock::now();
+    xschem::SpiceNetlist ref, gen, bad;
+    xschem::parse_spice_netlist(reference, ref);
+    xschem::parse_spice_netlist(shuffled, gen);
+    xschem::parse_spice_netlist(changed, bad);
+    double parse_ms = elapsed_ms(start) / 3;
+
+    start = Clock::now();
+    xschem::LvsReport same = xschem::compare_spice_netlists(ref, gen);
+    double compare_ms = elapsed_ms(start);
+    start = Clock::now();
+    xschem::LvsReport diff = xschem::compare_spice_netlists(ref, bad);
+    double diff_ms = elapsed_ms(start);
+
+    std::cout << devices << " devices, " << same.nets << " nets matched\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "parse:                " << parse_ms << " ms\n";
+    std::cout << "compare (equivalent): " << compare_ms << " ms\n";
+    std::cout << "compare (one change): " << diff_ms << " ms, " << diff.mismatches.size() << " mismatches\n";
+    if (!same.equivalent()) {
+        std::cerr << "FAIL: shuffled netlist reported as different:\n";
+        for (size_t i = 0; i < same.mismatches.size() && i < 10; i++) {
+            std::cerr << "  " << same.mismatches[i] << "\n";
+        }
+        return 1;
+    }
+    if (diff.equivalent()) {
+        std::cerr << "FAIL: changed pin not detected\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::string command = argv[1];
+    if (command == "rc" && argc >= 3) {
+        int iterations = argc >= 4 ? std::atoi(argv[3]) : 200;
+        return bench_rc(argv[2], std::max(iterations, 1));
+    }
+    if (command == "prefetch" && argc >= 3) {
+        return bench_prefetch(argc - 2, argv + 2);
+    }
+    if (command == "snapshot" && argc >= 3) {
+        return bench_snapshot(argc - 2, argv + 2);
+    }
+    if (command == "scan") {
+        return bench_scan(argc - 2, argv + 2);
+    }
+    if (command == "load") {
+        return bench_load(argc - 2, argv + 2);
+    }
+    if (command == "gen" && argc >= 3) {
+        return bench_gen(argc - 2, argv + 2);
+    }
+    if (command == "scale") {
+        return bench_scale(argc - 2, argv + 2);
+    }
+    if (command == "index") {
+        return bench_index(argc - 2, argv + 2);
+    }
+    if (command == "capi") {
+        return bench_capi(argc - 2, argv + 2);
+    }
+    if (command == "embed") {
+        return bench_embed(argc - 2, argv + 2);
+    }
+    if (command == "merge") {
+        return bench_merge(argc - 2, argv + 2);
+    }
+    if (command == "flatten") {
+        return bench_flatten(argc - 2, argv + 2);
+    }
+    if (command == "spatial") {
+        return bench_spatial(argc - 2, argv + 2);
+    }
+    if (command == "stable") {
+        return bench_stable(argc - 2, argv + 2);
+    }
+    if (command == "devices") {
+        return bench_devices();
+    }
+    if (command == "stdout") {
+        return bench_stdout(argc - 2, argv + 2);
+    }
+    if (command == "lvs") {
+        return bench_lvs(argc - 2, argv + 2);
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
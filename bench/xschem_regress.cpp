@@ -0,0 +1,276 @@
+// xschem_regress.cpp - Golden-output and performance regression runner
+// Netlists each schematic of a corpus with the xschem_lite executable,
+// compares the result with the reference netlist of the same name (written
+// by the xschem flow in nonlibraryflow/) and checks wall time and peak RSS
+// against a stored baseline. Netlists are compared structurally (see
+// xschem_lvs.h): element order and generated net names do not matter.
+// Exit status is 0 only if every case passes.
+
+#include "../xschem_lvs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static void print_usage(const char* prog_name) {
+    std::cerr << "Usage: " << prog_name << " [options] <input.sch>...\n\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  --netlister <exe>        xschem_lite executable (default: ./xschem_lite)\n";
+    std::cerr << "  --references <dir>       Reference netlists, <dir>/<name>.spice\n"
+                 "                           (default: nonlibraryflow/netlists)\n";
+    std::cerr << "  --out-dir <dir>          Where generated netlists are written\n";
+    std::cerr << "  --baseline <file>        Stored runtime/memory baseline\n";
+    std::cerr << "  --update-baseline        Write the measured values to the baseline file\n";
+    std::cerr << "  --repeat <n>             Runs per case, the fastest is kept (default: 3)\n";
+    std::cerr << "  --time-threshold <f>     Allowed runtime ratio to baseline (default: 1.25)\n";
+    std::cerr << "  --mem-threshold <f>      Allowed peak RSS ratio to baseline (default: 1.25)\n";
+    std::cerr << "  --min-time-ms <ms>       Runtime changes below this are noise (default: 5)\n";
+    std::cerr << "  --require-reference      Fail cases that have no reference netlist\n";
+    std::cerr << "  --require-baseline       Fail if the baseline file is missing, and cases\n"
+                 "                           that have no baseline entry\n";
+    std::cerr << "  -- <args>...             Extra arguments for the netlister (-I, --xschemrc)\n";
+}
+
+// ============================================================================
+// Measurement
+// ============================================================================
+
+struct Measurement {
+    double ms = 0;
+    long peak_rss_kb = 0;
+};
+
+// Run the netlister in a child process; wall time and the child's own peak RSS
+static bool run_netlister(const std::vector<std::string>& args, Measurement& m) {
+    std::vector<char*> argv;
+    for (const auto& a : args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    std::cout.flush();  // Or the child inherits unwritten output
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        // Netlister progress output is not part of the report
+        if (!freopen("/dev/null", "w", stdout)) _exit(127);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0) return false;
+    m.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    m.peak_rss_kb = usage.ru_maxrss;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Baseline file: one "<case> <ms> <peak_rss_kb>" line per case
+static std::map<std::string, Measurement> read_baseline(const std::string& path) {
+    std::map<std::string, Measurement> baseline;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string name;
+        Measurement m;
+        if (fields >> name >> m.ms >> m.peak_rss_kb) baseline[name] = m;
+    }
+    return baseline;
+}
+
+static bool write_baseline(const std::string& path, const std::map<std::string, Measurement>& baseline) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot write baseline: " << path << "\n";
+        return false;
+    }
+    out << "# xschem_regress baseline: <case> <ms> <peak_rss_kb>\n";
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [name, m] : baseline) {
+        out << name << " " << m.ms << " " << m.peak_rss_kb << "\n";
+    }
+    return out.good();
+}
+
+// ============================================================================
+// Runner
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    std::string netlister = "./xschem_lite";
+    std::string ref_dir = "nonlibraryflow/netlists";
+    std::string out_dir = (fs::temp_directory_path() / "xschem_regress").string();
+    std::string baseline_path;
+    bool update_baseline = false;
+    bool require_reference = false;
+    bool require_baseline = false;
+    int repeat = 3;
+    double time_threshold = 1.25;
+    double mem_threshold = 1.25;
+    double min_time_ms = 5;
+    std::vector<std::string> cases;
+    std::vector<std::string> extra_args;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--netlister" && i + 1 < argc) {
+            netlister = argv[++i];
+        } else if (arg == "--references" && i + 1 < argc) {
+            ref_dir = argv[++i];
+        } else if (arg == "--out-dir" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (arg == "--baseline" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--update-baseline") {
+            update_baseline = true;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--time-threshold" && i + 1 < argc) {
+            time_threshold = std::atof(argv[++i]);
+        } else if (arg == "--mem-threshold" && i + 1 < argc) {
+            mem_threshold = std::atof(argv[++i]);
+        } else if (arg == "--min-time-ms" && i + 1 < argc) {
+            min_time_ms = std::atof(argv[++i]);
+        } else if (arg == "--require-baseline") {
+            require_baseline = true;
+        } else if (arg == "--require-reference") {
+            require_reference = true;
+        } else if (arg == "--") {
+            extra_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 2;
+        } else {
+            cases.push_back(arg);
+        }
+    }
+
+    if (cases.empty()) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (update_baseline && baseline_path.empty()) {
+        std::cerr << "Error: --update-baseline needs --baseline <file>\n";
+        return 2;
+    }
+    if (require_baseline && !update_baseline && (baseline_path.empty() || !fs::exists(baseline_path))) {
+        std::cerr << "Error: --require-baseline: no baseline file"
+                  << (baseline_path.empty() ? std::string() : " " + baseline_path)
+                  << " (record one with --update-baseline)\n";
+        return 2;
+    }
+
+    std::error_code ec;
+    fs::create_directories(out_dir, ec);
+    std::map<std::string, Measurement> baseline;
+    if (!baseline_path.empty()) {
+        baseline = read_baseline(baseline_path);
+        if (baseline.empty() && !update_baseline) {
+            std::cout << "No baseline in " << baseline_path
+                      << ": runtime and memory are not checked (see --update-baseline)\n";
+        }
+    }
+
+    int failures = 0;
+    std::cout << std::left << std::setw(32) << "case" << std::setw(10) << "netlist"
+              << std::right << std::setw(10) << "ms" << std::setw(10) << "base ms"
+              << std::setw(10) << "rss KiB" << std::setw(10) << "base KiB" << "  perf\n";
+
+    for (const auto& sch : cases) {
+        std::string name = fs::path(sch).stem().string();
+        std::string out_file = (fs::path(out_dir) / (name + ".spice")).string();
+        std::string ref_file = (fs::path(ref_dir) / (name + ".spice")).string();
+
+        std::vector<std::string> args = {netlister};
+        args.insert(args.end(), extra_args.begin(), extra_args.end());
+        args.push_back(sch);
+        args.push_back(out_file);
+
+        Measurement best;
+        bool ok = true;
+        for (int r = 0; r < repeat && ok; r++) {
+            Measurement m;
+            ok = run_netlister(args, m);
+            if (r == 0 || m.ms < best.ms) best.ms = m.ms;
+            if (r == 0 || m.peak_rss_kb < best.peak_rss_kb) best.peak_rss_kb = m.peak_rss_kb;
+        }
+
+        // Correctness
+        std::string netlist_status;
+        std::vector<std::string> diffs;
+        xschem::SpiceNetlist ref_netlist, out_netlist;
+        if (!ok) {
+            netlist_status = "ERROR";
+        } else if (!fs::exists(ref_file)) {
+            netlist_status = require_reference ? "NOREF" : "skip";
+        } else if (!xschem::read_spice_netlist(ref_file, ref_netlist) ||
+                   !xschem::read_spice_netlist(out_file, out_netlist)) {
+            netlist_status = "ERROR";
+        } else {
+            diffs = xschem::compare_spice_netlists(ref_netlist, out_netlist).mismatches;
+            netlist_status = diffs.empty() ? "PASS" : "FAIL";
+        }
+        bool case_failed = netlist_status != "PASS" && netlist_status != "skip";
+
+        // Performance, against the stored baseline
+        std::string perf_status = "-";
+        auto base_it = baseline.find(name);
+        if (ok && base_it != baseline.end()) {
+            const Measurement& base = base_it->second;
+            bool slow = best.ms > base.ms * time_threshold && best.ms - base.ms > min_time_ms;
+            bool big = best.peak_rss_kb > base.peak_rss_kb * mem_threshold;
+            perf_status = slow && big ? "SLOWER+MEM" : slow ? "SLOWER" : big ? "MEM" : "ok";
+            if (slow || big) case_failed = true;
+        } else if (ok && require_baseline && !update_baseline) {
+            perf_status = "NOBASE";
+            case_failed = true;
+        }
+        if (ok && update_baseline) baseline[name] = best;
+
+        std::cout << std::left << std::setw(32) << name << std::setw(10) << netlist_status
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << best.ms;
+        if (base_it != baseline.end() && !update_baseline) {
+            std::cout << std::setw(10) << base_it->second.ms << std::setw(10) << best.peak_rss_kb
+                      << std::setw(10) << base_it->second.peak_rss_kb;
+        } else {
+            std::cout << std::setw(10) << "-" << std::setw(10) << best.peak_rss_kb << std::setw(10) << "-";
+        }
+        std::cout << "  " << perf_status << "\n";
+
+        const size_t max_diffs = 20;
+        for (size_t d = 0; d < diffs.size() && d < max_diffs; d++) {
+            std::cout << "    " << diffs[d] << "\n";
+        }
+        if (diffs.size() > max_diffs) {
+            std::cout << "    ... " << diffs.size() - max_diffs << " more differences\n";
+        }
+        if (netlist_status == "NOREF") {
+            std::cout << "    no reference netlist: " << ref_file << "\n";
+        }
+        if (case_failed) failures++;
+    }
+
+    if (update_baseline && !write_baseline(baseline_path, baseline)) return 2;
+
+    std::cout << "\n" << cases.size() - failures << "/" << cases.size() << " cases passed\n";
+    return failures ? 1 : 0;
+}
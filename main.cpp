@@ -2,24 +2,67 @@
 // Shows how to load a .sch file and generate a SPICE netlist
 
 #include "xschem_lite.h"
+#include "xschem_emit.h"
+#include "xschem_flatten.h"
+#include "xschem_snapshot.h"
+#include "xschem_stats.h"
+#include "xschem_sweep.h"
+#include "xschem_trace.h"
 #include <iostream>
 #include <iomanip>
+#include <filesystem>
+#include <cstdlib>
 
 void print_usage(const char* prog_name) {
     std::cerr << "Usage: " << prog_name << " <input.sch> [output.spice] [options]\n\n";
     std::cerr << "Options:\n";
     std::cerr << "  -I <path>           Add symbol search path\n";
     std::cerr << "  --xschemrc <file>   Load symbol paths from xschemrc file\n";
+    std::cerr << "  --rc-cache          Keep a snapshot of the evaluated xschemrc and reuse it\n";
+    std::cerr << "                      while the xschemrc and environment are unchanged\n";
     std::cerr << "  --flat              Generate flat netlist (no .subckt wrapper)\n";
+    std::cerr << "  --flatten           Expand subcircuits that have a schematic into one SPICE\n";
+    std::cerr << "                      netlist without .subckt wrapper. Elements are named as\n";
+    std::cerr << "                      SPICE names expanded subcircuit elements: letter, path,\n";
+    std::cerr << "                      name (R.x1.x3.R2); parameters passed to a cell are\n";
+    std::cerr << "                      substituted in its elements. SPICE output only\n";
+    std::cerr << "  --eval              Write the numeric value of expression parameters\n";
+    std::cerr << "                      ('W/nf * 0.29') instead of the expression\n";
+    std::cerr << "  --verilog <file>    Also write a structural Verilog netlist (- for stdout)\n";
+    std::cerr << "  --json <file>       Also write the connectivity as JSON (- for stdout)\n";
+    std::cerr << "                      (all formats share one load and net resolution;\n";
+    std::cerr << "                      with -, progress messages go to stderr)\n";
     std::cerr << "  --info              Print schematic info only (no netlist)\n";
+    std::cerr << "  --erc               Report floating pins, shorted labels, dangling wires,\n";
+    std::cerr << "                      duplicate names and output conflicts to stderr\n";
+    std::cerr << "  --merge-wires       Merge collinear, overlapping wire segments before\n";
+    std::cerr << "                      resolving nets and report how many were removed\n";
+    std::cerr << "  --save-snapshot <file>  Save the resolved design as a binary snapshot\n";
+    std::cerr << "                      (a snapshot can be given instead of a .sch: it skips\n";
+    std::cerr << "                      parsing and net resolution; --info reads it in place,\n";
+    std::cerr << "                      netlists are written from a copy of its contents)\n";
+    std::cerr << "  -MD                 Write a make dependency file (<output>.d)\n";
+    std::cerr << "  -MF <file>          Write the dependency file to <file> (implies -MD)\n";
+    std::cerr << "  -MT <target>        Target name used in the dependency file\n";
+    std::cerr << "  -MP                 Add a phony target for each dependency\n";
+    std::cerr << "  --sweep <table>     Write one netlist per row of a .csv/.json property table\n";
+    std::cerr << "                      (the output argument is then a directory)\n";
+    std::cerr << "  --threads <n>       Worker threads for --sweep (default: all cores)\n";
+    std::cerr << "  --stats             Print per-stage timings and counters to stderr\n";
+    std::cerr << "  --stats-json <file> Write the same metrics as JSON (- for stdout, progress\n";
+    std::cerr << "                      messages then go to stderr; needs an output file)\n";
+    std::cerr << "  --trace <file>      Write a Chrome trace-event timeline (chrome://tracing)\n";
     std::cerr << "  -h, --help          Show this help\n\n";
     std::cerr << "Environment variables:\n";
     std::cerr << "  PDK_ROOT            Path to PDK installation (e.g., /home/user/pdk)\n";
-    std::cerr << "  PDK                 PDK variant (default: sky130A)\n\n";
+    std::cerr << "  PDK                 PDK variant (default: sky130A)\n";
+    std::cerr << "  XSCHEM_LITE_CACHE_DIR  Directory for --rc-cache snapshots\n";
+    std::cerr << "                      (default: $XDG_CACHE_HOME/xschem_lite or ~/.cache/xschem_lite)\n\n";
     std::cerr << "Examples:\n";
     std::cerr << "  " << prog_name << " inverter.sch\n";
     std::cerr << "  " << prog_name << " inverter.sch inverter.spice\n";
     std::cerr << "  " << prog_name << " -I ./symbols top.sch top.spice\n";
+    std::cerr << "  " << prog_name << " --sweep sizes.csv inverter.sch sweep_out\n";
     std::cerr << "  " << prog_name << " --xschemrc $PDK_ROOT/sky130A/libs.tech/xschem/xschemrc circuit.sch\n";
 }
 
@@ -66,6 +109,115 @@ void print_schematic_info(const xschem::Schematic& sch) {
     }
 }
 
+void print_erc_warning(const std::string& filename, const xschem::ErcViolation& v) {
+    std::cerr << "Warning: " << filename << ": " << xschem::erc_kind_name(v.kind) << " at ("
+              << v.at.x << "," << v.at.y << "): " << v.message << "\n";
+}
+
+// Reports of one schematic; returns their number
+size_t print_erc_warnings(const xschem::Schematic& sch) {
+    for (const auto& v : sch.erc) print_erc_warning(sch.filename, v);
+    return sch.erc.size();
+}
+
+void print_erc_total(size_t count) {
+    std::cerr << "ERC: " << count << " violation" << (count == 1 ? "" : "s") << "\n";
+}
+
+// Same report as print_schematic_info, read directly from a mapped snapshot
+void print_snapshot_info(const xschem::SnapshotView& view) {
+    std::cout << "=== Schematic Info ===\n";
+    std::cout << "File: " << view.str(view.schematic().filename) << "\n";
+    std::cout << "Wires: " << view.wires().size() << "\n";
+    std::cout << "Instances: " << view.instances().size() << "\n";
+    std::cout << "Texts: " << view.texts().size() << "\n";
+    std::cout << "Symbols loaded: " << view.symbols().size() << "\n";
+
+    std::cout << "\n=== Instances ===\n";
+    for (const auto& inst : view.instances()) {
+        std::cout << "  " << std::setw(12) << std::left << view.str(inst.inst_name)
+                  << " -> " << view.str(inst.symbol_name);
+
+        if (const auto* sym = view.find_symbol(view.str(inst.symbol_name))) {
+            std::cout << " (type: " << view.str(sym->type) << ")";
+        }
+        std::cout << "\n";
+
+        // Print properties
+        if (inst.prop_count > 0) {
+            std::cout << "      props: ";
+            bool first = true;
+            for (const auto& prop : view.props(inst)) {
+                if (!first) std::cout << ", ";
+                std::cout << view.str(prop.key) << "=" << view.str(prop.value);
+                first = false;
+            }
+            std::cout << "\n";
+        }
+    }
+
+    std::cout << "\n=== Wires ===\n";
+    for (const auto& wire : view.wires()) {
+        std::cout << "  (" << wire.x1 << "," << wire.y1 << ") -> ("
+                  << wire.x2 << "," << wire.y2 << ")";
+        if (wire.node.size > 0) {
+            std::cout << "  [" << view.str(wire.node) << "]";
+        }
+        std::cout << "\n";
+    }
+}
+
+// Collects metrics for the whole run and reports them when main returns,
+// whichever path it returns from
+class RunStats {
+public:
+    void enable(bool print, const std::string& json_file) {
+        m_print = m_print || print;
+        if (!json_file.empty()) m_json_file = json_file;
+        if (!m_scope) m_scope = std::make_unique<xschem::StatsScope>(&m_stats);
+    }
+
+    bool writes_stdout() const { return m_json_file == "-"; }
+
+    ~RunStats() {
+        if (!m_scope) return;
+        xschem::StatsReport report = m_stats.report();
+        m_scope.reset();
+        if (m_print) xschem::print_stats(std::cerr, report);
+        if (m_json_file == "-") {
+            std::cout << xschem::stats_to_json(report);
+        } else if (!m_json_file.empty()) {
+            std::ofstream out(m_json_file);
+            out << xschem::stats_to_json(report);
+            if (!out) std::cerr << "Error: Cannot write stats file: " << m_json_file << "\n";
+        }
+    }
+
+private:
+    xschem::Stats m_stats;
+    std::unique_ptr<xschem::StatsScope> m_scope;
+    bool m_print = false;
+    std::string m_json_file;
+};
+
+// Records a timeline for the whole run and writes it when main returns
+class RunTrace {
+public:
+    void enable(const std::string& file) {
+        m_file = file;
+        xschem::trace_enable();
+    }
+
+    ~RunTrace() {
+        if (m_file.empty()) return;
+        xschem::trace_disable();
+        xschem::write_trace(m_file);
+    }
+
+private:
+    std::string m_file;
+};
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         print_usage(argv[0]);
@@ -77,7 +229,23 @@ int main(int argc, char* argv[]) {
     std::string xschemrc_file;
     std::vector<std::string> symbol_paths;
     bool subcircuit_mode = true;
+    bool flatten = false;
     bool info_only = false;
+    bool run_erc = false;
+    bool merge_wires = false;
+    bool evaluate = false;
+    bool rc_cache = false;
+    bool write_deps = false;
+    bool phony_deps = false;
+    std::string depfile;
+    std::string dep_target;
+    std::string snapshot_out;
+    std::string sweep_table;
+    std::string verilog_file;
+    std::string json_file;
+    unsigned sweep_threads = 0;
+    RunStats run_stats;
+    RunTrace run_trace;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -90,10 +258,45 @@ int main(int argc, char* argv[]) {
             symbol_paths.push_back(argv[++i]);
         } else if (arg == "--xschemrc" && i + 1 < argc) {
             xschemrc_file = argv[++i];
+        } else if (arg == "--rc-cache") {
+            rc_cache = true;
         } else if (arg == "--flat") {
             subcircuit_mode = false;
+        } else if (arg == "--flatten") {
+            flatten = true;
+        } else if (arg == "--eval") {
+            evaluate = true;
+        } else if (arg == "--verilog" && i + 1 < argc) {
+            verilog_file = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_file = argv[++i];
         } else if (arg == "--info") {
             info_only = true;
+        } else if (arg == "--erc") {
+            run_erc = true;
+        } else if (arg == "--merge-wires") {
+            merge_wires = true;
+        } else if (arg == "--save-snapshot" && i + 1 < argc) {
+            snapshot_out = argv[++i];
+        } else if (arg == "-MD") {
+            write_deps = true;
+        } else if (arg == "-MF" && i + 1 < argc) {
+            write_deps = true;
+            depfile = argv[++i];
+        } else if (arg == "-MT" && i + 1 < argc) {
+            dep_target = argv[++i];
+        } else if (arg == "-MP") {
+            phony_deps = true;
+        } else if (arg == "--sweep" && i + 1 < argc) {
+            sweep_table = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            sweep_threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--stats") {
+            run_stats.enable(true, "");
+        } else if (arg == "--stats-json" && i + 1 < argc) {
+            run_stats.enable(false, argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            run_trace.enable(argv[++i]);
         } else if (arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << "\n";
             return 1;
@@ -110,13 +313,83 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Read the table before loading so that a bad table fails fast
+    std::vector<xschem::SweepVariant> sweep_variants;
+    if (!sweep_table.empty()) {
+        if (output_file.empty()) {
+            std::cerr << "Error: --sweep needs an output directory\n";
+            return 1;
+        }
+        if (write_deps) {
+            std::cerr << "Error: -MD cannot be combined with --sweep\n";
+            return 1;
+        }
+        if (!xschem::load_sweep_table(sweep_table, sweep_variants)) return 1;
+    }
+
+    if (dep_target.empty()) dep_target = output_file;
+    if (write_deps && depfile.empty() && !output_file.empty()) {
+        depfile = std::filesystem::path(output_file).replace_extension(".d").string();
+    }
+    if (write_deps && (depfile.empty() || dep_target.empty())) {
+        std::cerr << "Error: -MD needs an output file, or -MF and -MT\n";
+        return 1;
+    }
+
+    // A document written to stdout ("-") must be all that is on stdout:
+    // progress messages then go to stderr
+    std::vector<std::string> to_stdout;
+    if (info_only) {
+        to_stdout.push_back("--info");
+    } else if (output_file.empty() && verilog_file.empty() && json_file.empty() && sweep_table.empty()) {
+        to_stdout.push_back("the SPICE netlist (no output file)");
+    }
+    if (verilog_file == "-") to_stdout.push_back("--verilog -");
+    if (json_file == "-") to_stdout.push_back("--json -");
+    if (run_stats.writes_stdout()) to_stdout.push_back("--stats-json -");
+    if (to_stdout.size() > 1) {
+        std::cerr << "Error: " << to_stdout[0] << " and " << to_stdout[1] << " cannot both write to stdout\n";
+        return 1;
+    }
+    bool document_on_stdout = verilog_file == "-" || json_file == "-" || run_stats.writes_stdout();
+    std::ostream& log = document_on_stdout ? std::cerr : std::cout;
+
+    // A snapshot is already resolved: no xschemrc or symbol lookup needed
+    bool from_snapshot = xschem::is_snapshot_file(input_file);
+
+    // --flatten expands the hierarchy into one SPICE netlist and nothing else
+    if (flatten) {
+        const char* other = from_snapshot ? "a snapshot input" : !sweep_table.empty() ? "--sweep"
+                          : !snapshot_out.empty() ? "--save-snapshot" : info_only ? "--info"
+                          : !verilog_file.empty() ? "--verilog" : !json_file.empty() ? "--json" : nullptr;
+        if (other) {
+            std::cerr << "Error: --flatten cannot be combined with " << other
+                      << " (only SPICE netlists are flattened)\n";
+            return 1;
+        }
+    }
+    if (from_snapshot && run_erc) {
+        std::cerr << "Error: --erc needs a .sch input (snapshots do not keep ERC results)\n";
+        return 1;
+    }
+    if (from_snapshot && merge_wires) {
+        std::cerr << "Error: --merge-wires needs a .sch input (snapshots are already resolved)\n";
+        return 1;
+    }
+    if (from_snapshot && info_only) {
+        xschem::SnapshotView view;
+        if (!view.open(input_file)) return 1;
+        print_snapshot_info(view);
+        return 0;
+    }
+
     // Load paths from xschemrc if specified
-    if (!xschemrc_file.empty()) {
-        std::cout << "Loading xschemrc: " << xschemrc_file << "\n";
-        auto rc_paths = xschem::parse_xschemrc(xschemrc_file);
-        std::cout << "Found " << rc_paths.size() << " symbol paths:\n";
+    if (!xschemrc_file.empty() && !from_snapshot) {
+        log << "Loading xschemrc: " << xschemrc_file << "\n";
+        auto rc_paths = xschem::parse_xschemrc(xschemrc_file, rc_cache);
+        log << "Found " << rc_paths.size() << " symbol paths:\n";
         for (const auto& p : rc_paths) {
-            std::cout << "  " << p << "\n";
+            log << "  " << p << "\n";
             symbol_paths.push_back(p);
         }
     }
@@ -129,38 +402,164 @@ int main(int argc, char* argv[]) {
     symbol_paths.push_back("/usr/local/share/xschem/xschem_library/devices");
 
     // Load the schematic
-    std::cout << "Loading schematic: " << input_file << "\n";
+    log << "Loading schematic: " << input_file << "\n";
+
+    // Flat SPICE netlist: the whole hierarchy, each cell loaded once
+    if (flatten) {
+        xschem::FlatDesign design;
+        xschem::FlattenOptions flat_options;
+        flat_options.evaluate = evaluate;
+        flat_options.load.merge_wires = merge_wires;
+        if (!design.load(input_file, symbol_paths, flat_options)) {
+            std::cerr << "Error: Failed to load schematic\n";
+            return 1;
+        }
+        log << "Loaded " << design.cell_count() << " cells, "
+            << design.device_count() << " flat devices\n";
+        if (merge_wires) {
+            size_t merged = 0;
+            for (uint32_t id = 0; id < design.cell_count(); id++) merged += design.cell(id).merged_wires;
+            log << "Merged wires: " << merged << " segments removed\n";
+        }
+        if (run_erc) {
+            std::vector<xschem::FlatDesign::Violation> violations = design.erc();
+            for (const auto& v : violations) print_erc_warning(design.cell(v.cell).filename, v.erc);
+            print_erc_total(violations.size());
+        }
+
+        if (output_file.empty()) {
+            std::cout << "\n=== SPICE Netlist ===\n";
+            if (!design.write_spice(std::cout)) {
+                std::cerr << "Error: Failed to generate netlist\n";
+                return 1;
+            }
+        } else {
+            log << "Generating netlist: " << output_file << "\n";
+            if (!design.write_spice(output_file)) {
+                std::cerr << "Error: Failed to generate netlist\n";
+                return 1;
+            }
+            log << "Done.\n";
+        }
+
+        if (write_deps) {
+            std::vector<std::string> deps = {input_file};
+            if (!xschemrc_file.empty() && std::filesystem::exists(xschemrc_file)) {
+                deps.push_back(xschemrc_file);
+            }
+            std::vector<std::string> cell_deps = design.dependencies();
+            deps.insert(deps.end(), cell_deps.begin(), cell_deps.end());
+            if (!xschem::write_depfile(depfile, dep_target, deps, phony_deps)) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    // Keep only what this run reports: snapshots store everything
+    xschem::LoadOptions load_options = xschem::LoadOptions::netlist_only();
+    if (!snapshot_out.empty()) {
+        load_options = xschem::LoadOptions::full();
+    } else if (info_only) {
+        load_options = xschem::LoadOptions::info();
+    }
+    load_options.merge_wires = merge_wires;
 
     xschem::Schematic sch;
-    if (!xschem::load_schematic(input_file, sch, symbol_paths)) {
+    // The netlisters work on a Schematic, so the mapped records are copied
+    if (from_snapshot) {
+        if (!xschem::load_snapshot(input_file, sch)) {
+            std::cerr << "Error: Failed to load snapshot\n";
+            return 1;
+        }
+    } else if (!xschem::load_schematic(input_file, sch, symbol_paths, load_options)) {
         std::cerr << "Error: Failed to load schematic\n";
         return 1;
     }
 
-    std::cout << "Loaded " << sch.instances.size() << " instances, "
-              << sch.wires.size() << " wires\n";
+    log << "Loaded " << sch.instances.size() << " instances, "
+        << sch.wires.size() << " wires\n";
+    if (merge_wires) {
+        log << "Merged wires: " << sch.merged_wires << " segments removed\n";
+    }
+
+    if (!snapshot_out.empty()) {
+        if (!sch.resolved) {
+            xschem::NetResolver resolver(sch);
+            resolver.resolve();
+        }
+        log << "Saving snapshot: " << snapshot_out << "\n";
+        if (!xschem::save_snapshot(sch, snapshot_out)) {
+            std::cerr << "Error: Failed to save snapshot\n";
+            return 1;
+        }
+    }
+
+    if (run_erc) {
+        if (!sch.resolved) {
+            xschem::NetResolver resolver(sch);
+            resolver.resolve();
+        }
+        print_erc_total(print_erc_warnings(sch));
+    }
 
     if (info_only) {
         print_schematic_info(sch);
         return 0;
     }
 
-    // Generate SPICE netlist
-    if (output_file.empty()) {
-        // Output to stdout
+    if (!sweep_table.empty()) {
+        log << "Generating " << sweep_variants.size() << " sweep netlists in: "
+            << output_file << "\n";
+        if (!xschem::generate_sweep(sch, sweep_variants, output_file, subcircuit_mode,
+                                    sweep_threads, evaluate)) {
+            std::cerr << "Error: Failed to generate sweep\n";
+            return 1;
+        }
+        log << "Done.\n";
+        return 0;
+    }
+
+    // Other formats: SPICE only goes to the output file, if one is given
+    if (!verilog_file.empty() || !json_file.empty()) {
+        xschem::NetlistOutputs outputs;
+        outputs.spice = output_file;
+        outputs.verilog = verilog_file;
+        outputs.json = json_file;
+        outputs.subcircuit_mode = subcircuit_mode;
+        outputs.evaluate = evaluate;
+        if (!xschem::generate_netlists(sch, outputs)) {
+            std::cerr << "Error: Failed to generate netlist\n";
+            return 1;
+        }
+    } else if (output_file.empty()) {
+        // Generate SPICE netlist to stdout
         std::cout << "\n=== SPICE Netlist ===\n";
-        if (!xschem::generate_spice_netlist(sch, std::cout, subcircuit_mode)) {
+        if (!xschem::generate_spice_netlist(sch, std::cout, subcircuit_mode, evaluate)) {
             std::cerr << "Error: Failed to generate netlist\n";
             return 1;
         }
     } else {
         // Output to file
-        std::cout << "Generating netlist: " << output_file << "\n";
-        if (!xschem::generate_spice_netlist(sch, output_file, subcircuit_mode)) {
+        log << "Generating netlist: " << output_file << "\n";
+        if (!xschem::generate_spice_netlist(sch, output_file, subcircuit_mode, evaluate)) {
             std::cerr << "Error: Failed to generate netlist\n";
             return 1;
         }
-        std::cout << "Done.\n";
+        log << "Done.\n";
+    }
+
+    if (write_deps) {
+        std::vector<std::string> deps = {input_file};
+        if (!xschemrc_file.empty() && std::filesystem::exists(xschemrc_file)) {
+            deps.push_back(xschemrc_file);
+        }
+        if (!from_snapshot) {
+            deps.insert(deps.end(), sch.dependencies.begin(), sch.dependencies.end());
+        }
+        if (!xschem::write_depfile(depfile, dep_target, deps, phony_deps)) {
+            return 1;
+        }
     }
 
     return 0;
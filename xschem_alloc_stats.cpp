@@ -0,0 +1,35 @@
+// xschem_alloc_stats.cpp - Allocation counting for xschem_stats
+// Replaces the global operator new/delete so that allocations made while a
+// Stats object is bound (StatsScope) are counted. Link this file into the
+// executable to enable it; the library itself does not replace allocators.
+
+#include "xschem_stats.h"
+#include <cstdlib>
+#include <new>
+
+void* operator new(std::size_t size) {
+    xschem::stat_add(&xschem::Stats::allocations);
+    xschem::stat_add(&xschem::Stats::allocated_bytes, size);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
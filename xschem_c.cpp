@@ -0,0 +1,304 @@
+// xschem_c.cpp - C interface to xschem_lite for in-process embedding
+// Implementation file
+
+#include "xschem_c.h"
+#include "xschem_emit.h"
+#include "xschem_lite.h"
+#include "xschem_snapshot.h"
+#include "xschem_stats.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+
+struct xschem_context {
+    std::mutex mutex;
+    std::vector<std::string> symbol_paths;
+    bool subcircuit = true;
+    bool evaluate = false;
+    bool merge_wires = false;
+    unsigned prefetch_threads = 8;
+    std::shared_ptr<xschem::WorkerPool> prefetch_pool;     // Shared by loads, started by the first
+    bool rc_cache = false;
+};
+
+struct xschem_schematic {
+    std::mutex mutex;
+    xschem::Schematic sch;
+    std::unique_ptr<xschem::NetTable> nets;     // Built on first netlist
+    bool subcircuit = true;
+    bool evaluate = false;
+    xschem::Stats stats;
+    double elapsed_ms = 0;
+};
+
+namespace {
+
+thread_local std::string t_last_error;
+
+xschem_status fail(xschem_status status, std::string message) {
+    t_last_error = std::move(message);
+    return status;
+}
+
+// Runs `body` with the handle's stats bound and its wall time counted;
+// exceptions become status codes
+template <typename Body>
+xschem_status guarded(xschem_schematic* handle, Body&& body) {
+    try {
+        std::optional<xschem::StatsScope> scope;
+        auto start = std::chrono::steady_clock::now();
+        if (handle) scope.emplace(&handle->stats);
+        xschem_status status = body();
+        if (handle) {
+            handle->elapsed_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+        }
+        return status;
+    } catch (const std::bad_alloc&) {
+        return fail(XSCHEM_ERR_MEMORY, "Out of memory");
+    } catch (const std::exception& e) {
+        return fail(XSCHEM_ERR_OUTPUT, e.what());
+    }
+}
+
+xschem_status to_buffer(const std::string& text, char** data, size_t* size) {
+    char* buffer = static_cast<char*>(std::malloc(text.size() + 1));
+    if (!buffer) return fail(XSCHEM_ERR_MEMORY, "Out of memory");
+    std::memcpy(buffer, text.data(), text.size() + 1);
+    *data = buffer;
+    if (size) *size = text.size();
+    return XSCHEM_OK;
+}
+
+void resolve(xschem_schematic* handle) {
+    if (!handle->sch.resolved) {
+        xschem::NetResolver resolver(handle->sch);
+        resolver.resolve();
+    }
+}
+
+bool write_netlist(xschem_schematic* handle, xschem_format format, std::ostream& out) {
+    resolve(handle);
+    if (!handle->nets) handle->nets = std::make_unique<xschem::NetTable>(handle->sch);
+    switch (format) {
+        case XSCHEM_FORMAT_SPICE: {
+            xschem::SpiceNetlister spice(handle->sch);
+            spice.set_subcircuit_mode(handle->subcircuit);
+            spice.set_evaluate_expressions(handle->evaluate);
+            spice.set_net_table(handle->nets.get());
+            return spice.generate(out);
+        }
+        case XSCHEM_FORMAT_VERILOG:
+            return xschem::VerilogNetlister(handle->sch, *handle->nets).generate(out);
+        case XSCHEM_FORMAT_JSON:
+            return xschem::JsonNetlister(handle->sch, *handle->nets).generate(out);
+    }
+    return false;
+}
+
+bool known_format(xschem_format format) {
+    return format == XSCHEM_FORMAT_SPICE || format == XSCHEM_FORMAT_VERILOG || format == XSCHEM_FORMAT_JSON;
+}
+
+} // namespace
+
+extern "C" {
+
+unsigned xschem_api_version(void) {
+    return XSCHEM_C_API_VERSION;
+}
+
+const char* xschem_last_error(void) {
+    return t_last_error.c_str();
+}
+
+// ============================================================================
+// Context
+// ============================================================================
+
+xschem_context* xschem_context_new(void) {
+    try {
+        return new xschem_context();
+    } catch (const std::bad_alloc&) {
+        fail(XSCHEM_ERR_MEMORY, "Out of memory");
+        return nullptr;
+    }
+}
+
+void xschem_context_free(xschem_context* ctx) {
+    delete ctx;
+}
+
+xschem_status xschem_context_add_symbol_path(xschem_context* ctx, const char* path) {
+    if (!ctx || !path) return fail(XSCHEM_ERR_ARGUMENT, "NULL context or path");
+    return guarded(nullptr, [&] {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->symbol_paths.push_back(path);
+        return XSCHEM_OK;
+    });
+}
+
+xschem_status xschem_context_load_xschemrc(xschem_context* ctx, const char* xschemrc_path) {
+    if (!ctx || !xschemrc_path) return fail(XSCHEM_ERR_ARGUMENT, "NULL context or path");
+    return guarded(nullptr, [&] {
+        bool rc_cache;
+        {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            rc_cache = ctx->rc_cache;
+        }
+        xschem::XschemrcConfig config;
+        if (!xschem::load_xschemrc(xschemrc_path, config, rc_cache ? xschem::default_xschemrc_cache_dir() : "")) {
+            return fail(XSCHEM_ERR_LOAD, std::string("Cannot load xschemrc: ") + xschemrc_path);
+        }
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->symbol_paths.insert(ctx->symbol_paths.end(), config.library_paths.begin(),
+                                 config.library_paths.end());
+        return XSCHEM_OK;
+    });
+}
+
+xschem_status xschem_context_set_option(xschem_context* ctx, xschem_option option, int value) {
+    if (!ctx) return fail(XSCHEM_ERR_ARGUMENT, "NULL context");
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    switch (option) {
+        case XSCHEM_OPT_SUBCIRCUIT:         ctx->subcircuit = value != 0; break;
+        case XSCHEM_OPT_EVALUATE:           ctx->evaluate = value != 0; break;
+        case XSCHEM_OPT_MERGE_WIRES:        ctx->merge_wires = value != 0; break;
+        case XSCHEM_OPT_PREFETCH_THREADS:
+            if (value < 0) return fail(XSCHEM_ERR_ARGUMENT, "Negative thread count");
+            ctx->prefetch_threads = static_cast<unsigned>(value);
+            ctx->prefetch_pool.reset();
+            break;
+        case XSCHEM_OPT_RC_CACHE:           ctx->rc_cache = value != 0; break;
+        default:
+            return fail(XSCHEM_ERR_ARGUMENT, "Unknown option " + std::to_string(option));
+    }
+    return XSCHEM_OK;
+}
+
+// ============================================================================
+// Schematic
+// ============================================================================
+
+xschem_status xschem_load(xschem_context* ctx, const char* filename, xschem_schematic** sch) {
+    if (!ctx || !filename || !sch) return fail(XSCHEM_ERR_ARGUMENT, "NULL context, filename or result");
+    *sch = nullptr;
+    std::unique_ptr<xschem_schematic> handle;
+    return guarded(nullptr, [&] {
+        handle = std::make_unique<xschem_schematic>();
+        xschem::StatsScope scope(&handle->stats);
+        auto start = std::chrono::steady_clock::now();
+
+        xschem::SchematicParser parser;
+        {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            for (const auto& path : ctx->symbol_paths) parser.add_symbol_path(path);
+            xschem::LoadOptions options = xschem::LoadOptions::netlist_only();
+            options.merge_wires = ctx->merge_wires;
+            parser.set_load_options(options);
+            parser.set_prefetch_threads(ctx->prefetch_threads);
+            if (!ctx->prefetch_pool && ctx->prefetch_threads > 0) {
+                ctx->prefetch_pool = std::make_shared<xschem::WorkerPool>(ctx->prefetch_threads);
+            }
+            parser.set_worker_pool(ctx->prefetch_pool);
+            handle->subcircuit = ctx->subcircuit;
+            handle->evaluate = ctx->evaluate;
+        }
+
+        if (xschem::is_snapshot_file(filename)) {
+            if (!xschem::load_snapshot(filename, handle->sch)) {
+                return fail(XSCHEM_ERR_LOAD, std::string("Cannot load snapshot: ") + filename);
+            }
+        } else {
+            if (!parser.load(filename)) {
+                return fail(XSCHEM_ERR_LOAD, std::string("Cannot load schematic: ") + filename);
+            }
+            handle->sch = std::move(parser.schematic());
+        }
+        handle->elapsed_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        *sch = handle.release();
+        return XSCHEM_OK;
+    });
+}
+
+void xschem_schematic_free(xschem_schematic* sch) {
+    delete sch;
+}
+
+xschem_status xschem_resolve(xschem_schematic* sch) {
+    if (!sch) return fail(XSCHEM_ERR_ARGUMENT, "NULL schematic");
+    std::lock_guard<std::mutex> lock(sch->mutex);
+    return guarded(sch, [&] {
+        resolve(sch);
+        return XSCHEM_OK;
+    });
+}
+
+xschem_status xschem_netlist_to_buffer(xschem_schematic* sch, xschem_format format,
+                                       char** data, size_t* size) {
+    if (!sch || !data) return fail(XSCHEM_ERR_ARGUMENT, "NULL schematic or buffer");
+    if (!known_format(format)) return fail(XSCHEM_ERR_ARGUMENT, "Unknown format");
+    std::lock_guard<std::mutex> lock(sch->mutex);
+    return guarded(sch, [&] {
+        std::ostringstream out;
+        if (!write_netlist(sch, format, out)) {
+            return fail(XSCHEM_ERR_OUTPUT, "Cannot generate netlist for " + sch->sch.filename);
+        }
+        return to_buffer(out.str(), data, size);
+    });
+}
+
+xschem_status xschem_netlist_to_file(xschem_schematic* sch, xschem_format format, const char* path) {
+    if (!sch || !path) return fail(XSCHEM_ERR_ARGUMENT, "NULL schematic or path");
+    if (!known_format(format)) return fail(XSCHEM_ERR_ARGUMENT, "Unknown format");
+    std::lock_guard<std::mutex> lock(sch->mutex);
+    return guarded(sch, [&] {
+        std::ofstream out(path);
+        if (!out) return fail(XSCHEM_ERR_OUTPUT, std::string("Cannot create output file: ") + path);
+        if (!write_netlist(sch, format, out) || !out.flush()) {
+            return fail(XSCHEM_ERR_OUTPUT, std::string("Cannot write netlist: ") + path);
+        }
+        return XSCHEM_OK;
+    });
+}
+
+xschem_status xschem_get_stats(xschem_schematic* sch, xschem_stats* stats) {
+    if (!sch || !stats || stats->struct_size < sizeof(size_t)) {
+        return fail(XSCHEM_ERR_ARGUMENT, "NULL schematic or stats, or struct_size not set");
+    }
+    std::lock_guard<std::mutex> lock(sch->mutex);
+    xschem::StatsReport report = sch->stats.report();
+    xschem_stats s;
+    s.struct_size = std::min(stats->struct_size, sizeof(xschem_stats));
+    s.instances = sch->sch.instances.size();
+    s.wires = sch->sch.wires.size();
+    s.symbols = sch->sch.symbols.size();
+    s.nets = sch->sch.resolved ? sch->sch.net_index.net_count() : 0;
+    s.files_opened = report.files_opened;
+    s.exists_probes = report.exists_probes;
+    s.hash_lookups = report.hash_lookups;
+    s.elapsed_ms = sch->elapsed_ms;
+    std::memcpy(stats, &s, s.struct_size);
+    return XSCHEM_OK;
+}
+
+xschem_status xschem_stats_json(xschem_schematic* sch, char** data, size_t* size) {
+    if (!sch || !data) return fail(XSCHEM_ERR_ARGUMENT, "NULL schematic or buffer");
+    std::lock_guard<std::mutex> lock(sch->mutex);
+    return guarded(nullptr, [&] {
+        return to_buffer(xschem::stats_to_json(sch->stats.report()), data, size);
+    });
+}
+
+void xschem_buffer_free(char* data) {
+    std::free(data);
+}
+
+} // extern "C"
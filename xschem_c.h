@@ -0,0 +1,111 @@
+/* xschem_c.h - C interface to xschem_lite for in-process embedding
+ * Built into libxschem_lite.so (and libxschem_lite.a) for hosts that load
+ * and netlist many cells without starting a process per cell: Python
+ * through ctypes/cffi, Tcl through a C extension. Only these functions are
+ * exported from the shared library; the C++ API stays internal.
+ *
+ * Handles are opaque. A context holds symbol paths and options; it can be
+ * shared by threads loading schematics, and changing it does not affect
+ * schematics already loaded. Each schematic handle serializes the calls
+ * made on it, so different handles can be worked on concurrently.
+ *
+ * Functions return XSCHEM_OK or an error status; xschem_last_error() gives
+ * the message of the calling thread's last failure. Buffers handed out are
+ * NUL terminated and released with xschem_buffer_free(). No C++ exception
+ * crosses this interface.
+ */
+
+#ifndef XSCHEM_C_H
+#define XSCHEM_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define XSCHEM_API __attribute__((visibility("default")))
+#else
+#define XSCHEM_API
+#endif
+
+/* Incremented when a function or struct changes incompatibly */
+#define XSCHEM_C_API_VERSION 1
+
+typedef struct xschem_context xschem_context;
+typedef struct xschem_schematic xschem_schematic;
+
+typedef enum xschem_status {
+    XSCHEM_OK = 0,
+    XSCHEM_ERR_ARGUMENT = 1,    /* NULL handle or pointer, unknown option or format */
+    XSCHEM_ERR_LOAD = 2,        /* Schematic, snapshot or xschemrc not read */
+    XSCHEM_ERR_OUTPUT = 3,      /* Netlist not generated or not written */
+    XSCHEM_ERR_MEMORY = 4
+} xschem_status;
+
+typedef enum xschem_option {
+    XSCHEM_OPT_SUBCIRCUIT = 1,      /* SPICE .subckt wrapper (default 1) */
+    XSCHEM_OPT_EVALUATE = 2,        /* Evaluate parameter expressions (default 0) */
+    XSCHEM_OPT_MERGE_WIRES = 3,     /* Merge collinear wires when loading (default 0) */
+    XSCHEM_OPT_PREFETCH_THREADS = 4,/* Threads reading symbols during a load (default 8) */
+    XSCHEM_OPT_RC_CACHE = 5         /* Keep and reuse xschemrc snapshots in the user cache
+                                       directory (default 0: nothing is written) */
+} xschem_option;
+
+typedef enum xschem_format {
+    XSCHEM_FORMAT_SPICE = 0,
+    XSCHEM_FORMAT_VERILOG = 1,
+    XSCHEM_FORMAT_JSON = 2
+} xschem_format;
+
+/* Counters of one schematic handle. Set struct_size to sizeof(xschem_stats)
+ * before the call; fields beyond it are not written. */
+typedef struct xschem_stats {
+    size_t struct_size;
+    uint64_t instances;
+    uint64_t wires;
+    uint64_t symbols;
+    uint64_t nets;              /* 0 until resolved */
+    uint64_t files_opened;      /* By calls on this handle */
+    uint64_t exists_probes;
+    uint64_t hash_lookups;
+    double elapsed_ms;          /* Wall time spent in calls on this handle */
+} xschem_stats;
+
+XSCHEM_API unsigned xschem_api_version(void);
+XSCHEM_API const char* xschem_last_error(void);
+
+/* Context: symbol search paths, in lookup order, and options. There are no
+ * default paths. */
+XSCHEM_API xschem_context* xschem_context_new(void);
+XSCHEM_API void xschem_context_free(xschem_context* ctx);
+XSCHEM_API xschem_status xschem_context_add_symbol_path(xschem_context* ctx, const char* path);
+/* Append the XSCHEM_LIBRARY_PATH entries of an xschemrc */
+XSCHEM_API xschem_status xschem_context_load_xschemrc(xschem_context* ctx, const char* xschemrc_path);
+XSCHEM_API xschem_status xschem_context_set_option(xschem_context* ctx, xschem_option option, int value);
+
+/* Load a .sch file, or a snapshot written by --save-snapshot. The context's
+ * paths and options are copied into the schematic. */
+XSCHEM_API xschem_status xschem_load(xschem_context* ctx, const char* filename, xschem_schematic** sch);
+XSCHEM_API void xschem_schematic_free(xschem_schematic* sch);
+
+/* Resolve nets; netlisting resolves on first use if this is not called */
+XSCHEM_API xschem_status xschem_resolve(xschem_schematic* sch);
+XSCHEM_API xschem_status xschem_netlist_to_buffer(xschem_schematic* sch, xschem_format format,
+                                                  char** data, size_t* size);
+XSCHEM_API xschem_status xschem_netlist_to_file(xschem_schematic* sch, xschem_format format,
+                                                const char* path);
+
+XSCHEM_API xschem_status xschem_get_stats(xschem_schematic* sch, xschem_stats* stats);
+/* Per-stage times and counters as JSON (the --stats-json layout) */
+XSCHEM_API xschem_status xschem_stats_json(xschem_schematic* sch, char** data, size_t* size);
+
+XSCHEM_API void xschem_buffer_free(char* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* XSCHEM_C_H */
@@ -0,0 +1,225 @@
+// xschem_emit.cpp - Verilog and JSON netlists, and multi-format emission
+// Implementation file
+
+#include "xschem_emit.h"
+#include "xschem_stats.h"
+#include "xschem_trace.h"
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <unordered_set>
+
+namespace xschem {
+
+namespace {
+
+bool is_verilog_keyword(const std::string& name) {
+    static const std::unordered_set<std::string> keywords = {
+        "always", "and", "assign", "begin", "buf", "case", "default", "else", "end",
+        "endcase", "endmodule", "for", "function", "if", "initial", "inout", "input",
+        "integer", "module", "nand", "nor", "not", "or", "output", "parameter", "reg",
+        "supply0", "supply1", "tri", "wire", "xnor", "xor",
+    };
+    return keywords.count(name) > 0;
+}
+
+// Plain identifier, or an escaped one ("\D[3] ", trailing space included)
+std::string verilog_name(const std::string& name) {
+    bool plain = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0])) &&
+                 name[0] != '$' && !is_verilog_keyword(name);
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '$') plain = false;
+    }
+    return plain ? name : "\\" + name + " ";
+}
+
+void write_json_string(std::ostream& out, const std::string& s) {
+    out << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                        << static_cast<int>(c) << std::dec << std::setfill(' ');
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+std::string cell_name_of(const Schematic& sch, const std::string& top_cell_name) {
+    if (!top_cell_name.empty()) return top_cell_name;
+    return std::filesystem::path(sch.filename).stem().string();
+}
+
+const char* port_direction(char dir) {
+    return dir == 'I' ? "input" : dir == 'O' ? "output" : "inout";
+}
+
+// Port name of a symbol pin: "D" for "D[3:0]"
+std::string pin_base_name(const std::string& pin) {
+    return pin.substr(0, pin.find('['));
+}
+
+// Write to a file, or to stdout for "-"
+template <typename Emit>
+bool write_output(const std::string& path, Emit emit) {
+    if (path == "-") return emit(std::cout);
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot open output file: " << path << std::endl;
+        return false;
+    }
+    return emit(out) && out.good();
+}
+
+} // namespace
+
+bool VerilogNetlister::generate(std::ostream& out) const {
+    StageTimer timer(Stage::Emission);
+    XSCHEM_TRACE_SCOPE("emit_verilog", m_sch.filename);
+
+    out << "// sch_path: " << m_sch.filename << "\n";
+    out << "module " << verilog_name(cell_name_of(m_sch, m_top_cell_name)) << " (";
+
+    // A label placed on several pins is one port
+    std::vector<bool> is_port(m_nets.net_count(), false);
+    std::vector<const NetTable::Port*> ports;
+    for (const auto& port : m_nets.ports()) {
+        if (!is_port[port.net]) ports.push_back(&port);
+        is_port[port.net] = true;
+    }
+    for (size_t i = 0; i < ports.size(); i++) {
+        out << (i ? ",\n  " : "\n  ") << verilog_name(ports[i]->name);
+    }
+    out << (ports.empty() ? ");\n" : "\n);\n");
+    for (const auto* port : ports) {
+        out << "  " << port_direction(port->dir) << " " << verilog_name(port->name) << ";\n";
+    }
+
+    // Internal nets, in first-use order
+    for (uint32_t id = 0; id < m_nets.net_count(); id++) {
+        if (!is_port[id] && !m_nets.net(id).empty()) {
+            out << "  wire " << verilog_name(m_nets.net(id)) << ";\n";
+        }
+    }
+
+    // Devices only: a code block holds simulator commands, not a module
+    for (size_t i = 0; i < m_sch.instances.size(); i++) {
+        if (!m_nets.is_device(i)) continue;
+        const Symbol& sym = *m_nets.symbol(i);
+        const std::string cell = std::filesystem::path(sym.name).stem().string();
+        BusName inst_name(m_sch.instances[i].inst_name);
+        const size_t pins = std::min(m_nets.pin_count(i), sym.pins.size());
+
+        for (size_t copy = 0; copy < m_nets.copies(i); copy++) {
+            out << "\n  " << verilog_name(cell) << " " << verilog_name(inst_name.bit(copy)) << " (";
+            for (size_t p = 0; p < pins; p++) {
+                const size_t width = m_nets.pin_width(i, p);
+                out << (p ? ",\n    ." : "\n    .") << verilog_name(pin_base_name(sym.pins[p].name)) << "(";
+                if (width > 1) out << "{";
+                for (size_t b = 0; b < width; b++) {
+                    const std::string& net = m_nets.net(m_nets.pin_net(i, p, copy, b));
+                    out << (b ? ", " : "") << (net.empty() ? "" : verilog_name(net));
+                }
+                out << (width > 1 ? "})" : ")");
+            }
+            out << (pins ? "\n  );\n" : ");\n");
+        }
+    }
+
+    out << "endmodule\n";
+    return out.good();
+}
+
+bool JsonNetlister::generate(std::ostream& out) const {
+    StageTimer timer(Stage::Emission);
+    XSCHEM_TRACE_SCOPE("emit_json", m_sch.filename);
+
+    out << "{\n  \"schematic\": ";
+    write_json_string(out, m_sch.filename);
+    out << ",\n  \"cell\": ";
+    write_json_string(out, cell_name_of(m_sch, m_top_cell_name));
+
+    out << ",\n  \"ports\": [";
+    const auto& ports = m_nets.ports();
+    for (size_t i = 0; i < ports.size(); i++) {
+        out << (i ? ",\n    " : "\n    ") << "{\"name\": ";
+        write_json_string(out, ports[i].name);
+        out << ", \"direction\": \"" << port_direction(ports[i].dir)
+            << "\", \"net\": " << ports[i].net << "}";
+    }
+    out << (ports.empty() ? "]" : "\n  ]");
+
+    out << ",\n  \"nets\": [";
+    for (uint32_t id = 0; id < m_nets.net_count(); id++) {
+        out << (id ? ",\n    " : "\n    ");
+        write_json_string(out, m_nets.net(id));
+    }
+    out << (m_nets.net_count() ? "\n  ]" : "]");
+
+    // Devices only, and instance arrays one element per copy
+    out << ",\n  \"instances\": [";
+    bool first = true;
+    for (size_t i = 0; i < m_sch.instances.size(); i++) {
+        if (!m_nets.is_device(i)) continue;
+        const Symbol& sym = *m_nets.symbol(i);
+        BusName inst_name(m_sch.instances[i].inst_name);
+        for (size_t copy = 0; copy < m_nets.copies(i); copy++) {
+            out << (first ? "\n    " : ",\n    ") << "{\"name\": ";
+            first = false;
+            write_json_string(out, inst_name.bit(copy));
+            out << ", \"symbol\": ";
+            write_json_string(out, sym.name);
+            out << ", \"type\": ";
+            write_json_string(out, sym.type);
+            out << ", \"pins\": [";
+            for (size_t p = 0; p < m_nets.pin_count(i); p++) {
+                const size_t width = m_nets.pin_width(i, p);
+                BusName pin_name(p < sym.pins.size() ? std::string_view(sym.pins[p].name) : "");
+                for (size_t b = 0; b < width; b++) {
+                    out << (p || b ? ", " : "") << "{\"name\": ";
+                    write_json_string(out, pin_name.bit(b));
+                    out << ", \"net\": " << m_nets.pin_net(i, p, copy, b) << "}";
+                }
+            }
+            out << "]}";
+        }
+    }
+    out << (first ? "]" : "\n  ]") << "\n}\n";
+    return out.good();
+}
+
+bool generate_netlists(Schematic& sch, const NetlistOutputs& outputs) {
+    if (!sch.resolved) {
+        NetResolver resolver(sch);
+        resolver.resolve();
+    }
+    NetTable nets(sch);
+
+    bool ok = true;
+    if (!outputs.spice.empty()) {
+        SpiceNetlister spice(sch);
+        spice.set_subcircuit_mode(outputs.subcircuit_mode);
+        spice.set_evaluate_expressions(outputs.evaluate);
+        spice.set_net_table(&nets);
+        ok = write_output(outputs.spice, [&](std::ostream& out) { return spice.generate(out); }) && ok;
+    }
+    if (!outputs.verilog.empty()) {
+        VerilogNetlister verilog(sch, nets);
+        ok = write_output(outputs.verilog, [&](std::ostream& out) { return verilog.generate(out); }) && ok;
+    }
+    if (!outputs.json.empty()) {
+        JsonNetlister json(sch, nets);
+        ok = write_output(outputs.json, [&](std::ostream& out) { return json.generate(out); }) && ok;
+    }
+    return ok;
+}
+
+} // namespace xschem
@@ -0,0 +1,58 @@
+// xschem_emit.h - Verilog and JSON netlists, and multi-format emission
+// The emitters read net names from a NetTable, the same table
+// SpiceNetlister uses, so one resolution feeds every format. Bus pins and
+// nets are written bit by bit, with the bit names SPICE uses.
+
+#ifndef XSCHEM_EMIT_H
+#define XSCHEM_EMIT_H
+
+#include "xschem_lite.h"
+
+namespace xschem {
+
+// Structural Verilog: one module for the schematic, one cell instance per
+// netlisted instance (cell name = symbol name), ports connected by name.
+// Names that are not plain Verilog identifiers are escaped ("\#net2 ").
+class VerilogNetlister {
+public:
+    VerilogNetlister(const Schematic& sch, const NetTable& nets) : m_sch(sch), m_nets(nets) {}
+
+    bool generate(std::ostream& out) const;
+    void set_top_cell_name(const std::string& name) { m_top_cell_name = name; }
+
+private:
+    const Schematic& m_sch;
+    const NetTable& m_nets;
+    std::string m_top_cell_name;
+};
+
+// Connectivity as JSON: ports, the net name list, and per instance its
+// symbol and the net index of every pin bit
+class JsonNetlister {
+public:
+    JsonNetlister(const Schematic& sch, const NetTable& nets) : m_sch(sch), m_nets(nets) {}
+
+    bool generate(std::ostream& out) const;
+    void set_top_cell_name(const std::string& name) { m_top_cell_name = name; }
+
+private:
+    const Schematic& m_sch;
+    const NetTable& m_nets;
+    std::string m_top_cell_name;
+};
+
+// Output files of one run; empty = not written, "-" = stdout
+struct NetlistOutputs {
+    std::string spice;
+    std::string verilog;
+    std::string json;
+    bool subcircuit_mode = true;
+    bool evaluate = false;      // SpiceNetlister::set_evaluate_expressions
+};
+
+// Resolve once, build one NetTable and write every requested format
+bool generate_netlists(Schematic& sch, const NetlistOutputs& outputs);
+
+} // namespace xschem
+
+#endif // XSCHEM_EMIT_H
@@ -0,0 +1,320 @@
+// xschem_expr.cpp - Compiled arithmetic expressions for property values
+// Implementation file
+
+#include "xschem_expr.h"
+#include "xschem_stats.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+namespace xschem {
+
+bool parse_spice_number(std::string_view text, double& value) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) text.remove_suffix(1);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    if (text.empty()) return false;
+
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc()) return false;
+
+    // Scale suffix; trailing unit letters ("10pF") are ignored
+    std::string_view suffix(end, text.data() + text.size() - end);
+    if (suffix.empty()) return true;
+    if (!std::all_of(suffix.begin(), suffix.end(),
+                     [](char c) { return std::isalpha(static_cast<unsigned char>(c)); })) {
+        return false;
+    }
+    auto starts = [&](const char* s) {
+        size_t n = std::char_traits<char>::length(s);
+        if (suffix.size() < n) return false;
+        for (size_t i = 0; i < n; i++) {
+            if (std::tolower(static_cast<unsigned char>(suffix[i])) != s[i]) return false;
+        }
+        return true;
+    };
+    if (starts("meg")) value *= 1e6;
+    else if (starts("mil")) value *= 25.4e-6;
+    else {
+        switch (std::tolower(static_cast<unsigned char>(suffix[0]))) {
+            case 't': value *= 1e12; break;
+            case 'g': value *= 1e9; break;
+            case 'k': value *= 1e3; break;
+            case 'm': value *= 1e-3; break;
+            case 'u': value *= 1e-6; break;
+            case 'n': value *= 1e-9; break;
+            case 'p': value *= 1e-12; break;
+            case 'f': value *= 1e-15; break;
+            case 'a': value *= 1e-18; break;
+            default: break;
+        }
+    }
+    return true;
+}
+
+std::string format_spice_number(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.12g", value);
+    return buf;
+}
+
+// Recursive descent compiler emitting postfix code
+class ExpressionCompiler {
+public:
+    ExpressionCompiler(std::string_view text, Expression& expr) : m_in(text), m_expr(expr) {}
+
+    bool compile(std::string* error) {
+        bool ok = additive() && (skip_ws(), m_pos == m_in.size() || fail("Unexpected character"));
+        if (!ok && error) *error = m_error;
+        return ok;
+    }
+
+private:
+    std::string_view m_in;
+    Expression& m_expr;
+    size_t m_pos = 0;
+    size_t m_depth = 0;
+    std::string m_error;
+
+    bool fail(const char* what) {
+        if (m_error.empty()) m_error = std::string(what) + " at offset " + std::to_string(m_pos);
+        return false;
+    }
+
+    void skip_ws() {
+        while (m_pos < m_in.size() && std::isspace(static_cast<unsigned char>(m_in[m_pos]))) m_pos++;
+    }
+
+    char peek() {
+        skip_ws();
+        return m_pos < m_in.size() ? m_in[m_pos] : '\0';
+    }
+
+    // Operands push one value, binary operators pop two and push one
+    void emit(Expression::Op op, uint32_t arg = 0, int stack_effect = -1) {
+        m_expr.m_code.push_back({op, arg});
+        m_depth += stack_effect;
+        m_expr.m_max_stack = std::max(m_expr.m_max_stack, m_depth);
+        if (op != Expression::Op::Const && op != Expression::Op::Var) m_expr.m_has_operations = true;
+    }
+
+    bool additive() {
+        if (!multiplicative()) return false;
+        while (true) {
+            char c = peek();
+            if (c != '+' && c != '-') return true;
+            m_pos++;
+            if (!multiplicative()) return false;
+            emit(c == '+' ? Expression::Op::Add : Expression::Op::Sub);
+        }
+    }
+
+    bool multiplicative() {
+        if (!unary()) return false;
+        while (true) {
+            char c = peek();
+            if (c == '*' && m_pos + 1 < m_in.size() && m_in[m_pos + 1] == '*') return true;  // Power
+            if (c != '*' && c != '/' && c != '%') return true;
+            m_pos++;
+            if (!unary()) return false;
+            emit(c == '*' ? Expression::Op::Mul : c == '/' ? Expression::Op::Div : Expression::Op::Mod);
+        }
+    }
+
+    bool unary() {
+        char c = peek();
+        if (c == '+' || c == '-') {
+            m_pos++;
+            if (!unary()) return false;
+            if (c == '-') emit(Expression::Op::Neg, 0, 0);
+            return true;
+        }
+        return power();
+    }
+
+    // Right associative, binds tighter than unary minus: -2**2 == -4
+    bool power() {
+        if (!primary()) return false;
+        char c = peek();
+        if (c == '^') {
+            m_pos++;
+        } else if (c == '*' && m_pos + 1 < m_in.size() && m_in[m_pos + 1] == '*') {
+            m_pos += 2;
+        } else {
+            return true;
+        }
+        if (!unary()) return false;
+        emit(Expression::Op::Pow);
+        return true;
+    }
+
+    bool primary() {
+        char c = peek();
+        if (c == '(') {
+            m_pos++;
+            if (!additive()) return false;
+            if (peek() != ')') return fail("Expected ')'");
+            m_pos++;
+            return true;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') return number();
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') return identifier();
+        return fail(c ? "Unexpected character" : "Unexpected end of expression");
+    }
+
+    bool number() {
+        size_t start = m_pos;
+        while (m_pos < m_in.size() &&
+               (std::isdigit(static_cast<unsigned char>(m_in[m_pos])) || m_in[m_pos] == '.')) {
+            m_pos++;
+        }
+        // Exponent, only if digits follow ("1e-3", not the "e" of a unit)
+        if (m_pos < m_in.size() && (m_in[m_pos] == 'e' || m_in[m_pos] == 'E')) {
+            size_t p = m_pos + 1;
+            if (p < m_in.size() && (m_in[p] == '+' || m_in[p] == '-')) p++;
+            if (p < m_in.size() && std::isdigit(static_cast<unsigned char>(m_in[p]))) {
+                m_pos = p;
+                while (m_pos < m_in.size() && std::isdigit(static_cast<unsigned char>(m_in[m_pos]))) m_pos++;
+            }
+        }
+        while (m_pos < m_in.size() && std::isalpha(static_cast<unsigned char>(m_in[m_pos]))) m_pos++;
+
+        double value;
+        if (!parse_spice_number(m_in.substr(start, m_pos - start), value)) {
+            m_pos = start;
+            return fail("Bad number");
+        }
+        m_expr.m_constants.push_back(value);
+        emit(Expression::Op::Const, static_cast<uint32_t>(m_expr.m_constants.size() - 1), 1);
+        return true;
+    }
+
+    bool identifier() {
+        size_t start = m_pos;
+        while (m_pos < m_in.size() &&
+               (std::isalnum(static_cast<unsigned char>(m_in[m_pos])) || m_in[m_pos] == '_')) {
+            m_pos++;
+        }
+        std::string_view name = m_in.substr(start, m_pos - start);
+        if (peek() == '(') return call(name);
+
+        auto& vars = m_expr.m_variables;
+        auto it = std::find(vars.begin(), vars.end(), name);
+        if (it == vars.end()) it = vars.insert(vars.end(), std::string(name));
+        emit(Expression::Op::Var, static_cast<uint32_t>(it - vars.begin()), 1);
+        return true;
+    }
+
+    bool call(std::string_view name) {
+        struct Function {
+            const char* name;
+            Expression::Op op;
+            size_t args;
+        };
+        static constexpr Function functions[] = {
+            {"int", Expression::Op::Int, 1},     {"abs", Expression::Op::Abs, 1},
+            {"sqrt", Expression::Op::Sqrt, 1},   {"exp", Expression::Op::Exp, 1},
+            {"log", Expression::Op::Log, 1},     {"ln", Expression::Op::Log, 1},
+            {"log10", Expression::Op::Log10, 1}, {"floor", Expression::Op::Floor, 1},
+            {"ceil", Expression::Op::Ceil, 1},   {"round", Expression::Op::Round, 1},
+            {"min", Expression::Op::Min, 2},     {"max", Expression::Op::Max, 2},
+            {"pow", Expression::Op::Pow, 2},
+        };
+        const Function* fn = nullptr;
+        for (const auto& f : functions) {
+            if (name == f.name) fn = &f;
+        }
+        if (!fn) return fail("Unknown function");
+
+        m_pos++;  // '('
+        for (size_t i = 0; i < fn->args; i++) {
+            if (i > 0) {
+                if (peek() != ',') return fail("Expected ','");
+                m_pos++;
+            }
+            if (!additive()) return false;
+        }
+        if (peek() != ')') return fail("Expected ')'");
+        m_pos++;
+        emit(fn->op, 0, fn->args == 2 ? -1 : 0);
+        return true;
+    }
+};
+
+std::unique_ptr<Expression> Expression::compile(std::string_view text, std::string* error) {
+    auto expr = std::make_unique<Expression>();
+    ExpressionCompiler compiler(text, *expr);
+    if (!compiler.compile(error)) return nullptr;
+    return expr;
+}
+
+bool Expression::evaluate(const double* values, double& result) const {
+    // Expressions in property values are short; deeper ones use the heap
+    double small[32];
+    std::vector<double> large;
+    double* stack = small;
+    if (m_max_stack > std::size(small)) {
+        large.resize(m_max_stack);
+        stack = large.data();
+    }
+
+    size_t sp = 0;
+    for (const Instr& in : m_code) {
+        switch (in.op) {
+            case Op::Const: stack[sp++] = m_constants[in.arg]; break;
+            case Op::Var:   stack[sp++] = values[in.arg]; break;
+            case Op::Add:   sp--; stack[sp - 1] += stack[sp]; break;
+            case Op::Sub:   sp--; stack[sp - 1] -= stack[sp]; break;
+            case Op::Mul:   sp--; stack[sp - 1] *= stack[sp]; break;
+            case Op::Div:
+                sp--;
+                if (stack[sp] == 0) return false;
+                stack[sp - 1] /= stack[sp];
+                break;
+            case Op::Mod:
+                sp--;
+                if (stack[sp] == 0) return false;
+                stack[sp - 1] = std::fmod(stack[sp - 1], stack[sp]);
+                break;
+            case Op::Pow:   sp--; stack[sp - 1] = std::pow(stack[sp - 1], stack[sp]); break;
+            case Op::Min:   sp--; stack[sp - 1] = std::min(stack[sp - 1], stack[sp]); break;
+            case Op::Max:   sp--; stack[sp - 1] = std::max(stack[sp - 1], stack[sp]); break;
+            case Op::Neg:   stack[sp - 1] = -stack[sp - 1]; break;
+            case Op::Int:   stack[sp - 1] = std::trunc(stack[sp - 1]); break;
+            case Op::Abs:   stack[sp - 1] = std::fabs(stack[sp - 1]); break;
+            case Op::Sqrt:  stack[sp - 1] = std::sqrt(stack[sp - 1]); break;
+            case Op::Exp:   stack[sp - 1] = std::exp(stack[sp - 1]); break;
+            case Op::Log:   stack[sp - 1] = std::log(stack[sp - 1]); break;
+            case Op::Log10: stack[sp - 1] = std::log10(stack[sp - 1]); break;
+            case Op::Floor: stack[sp - 1] = std::floor(stack[sp - 1]); break;
+            case Op::Ceil:  stack[sp - 1] = std::ceil(stack[sp - 1]); break;
+            case Op::Round: stack[sp - 1] = std::round(stack[sp - 1]); break;
+        }
+    }
+    result = stack[0];
+    return std::isfinite(result);
+}
+
+const Expression* ExpressionCache::get(std::string_view text) {
+    stat_add(&Stats::hash_lookups, 1);
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_entries.find(text);
+        if (it != m_entries.end()) return it->second.get();
+    }
+
+    // Compile outside the lock; if another thread won the race, keep theirs
+    std::unique_ptr<Expression> expr = Expression::compile(text);
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_entries.try_emplace(std::string(text), std::move(expr)).first;
+    return it->second.get();
+}
+
+size_t ExpressionCache::size() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+} // namespace xschem
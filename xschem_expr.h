@@ -0,0 +1,88 @@
+// xschem_expr.h - Compiled arithmetic expressions for property values
+// Expressions such as 'int((nf+1)/2) * W/nf * 0.29' are compiled once into
+// a small stack bytecode and evaluated per instance. Variables are bound
+// by index, so evaluating needs no string handling beyond looking up the
+// variable values. ExpressionCache shares compiled expressions by text
+// across instances and threads.
+//
+// Syntax: numbers with SPICE suffixes (1.5u, 10k, 2meg), identifiers,
+// + - * / % and ** or ^ (right associative), unary + -, parentheses and
+// the functions int abs sqrt exp log log10 floor ceil round min max pow.
+
+#ifndef XSCHEM_EXPR_H
+#define XSCHEM_EXPR_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xschem {
+
+// Parse a SPICE number ("0.15", "150000u", "2.2meg", "10pF")
+bool parse_spice_number(std::string_view text, double& value);
+
+// Shortest form SPICE reads back to the same value for netlist output
+std::string format_spice_number(double value);
+
+class Expression {
+public:
+    enum class Op : uint8_t {
+        Const, Var, Add, Sub, Mul, Div, Mod, Pow, Neg,
+        Int, Abs, Sqrt, Exp, Log, Log10, Floor, Ceil, Round, Min, Max
+    };
+
+    struct Instr {
+        Op op;
+        uint32_t arg;   // Constant or variable index
+    };
+
+    // nullptr and `error` set if `text` is not a valid expression
+    static std::unique_ptr<Expression> compile(std::string_view text, std::string* error = nullptr);
+
+    // Distinct identifiers in first-use order; evaluate() takes their
+    // values in this order
+    const std::vector<std::string>& variables() const { return m_variables; }
+
+    // False for a lone number or identifier, which is not worth evaluating
+    bool has_operations() const { return m_has_operations; }
+
+    // False on a domain error (division by zero, log of a negative, ...)
+    bool evaluate(const double* values, double& result) const;
+
+private:
+    std::vector<Instr> m_code;
+    std::vector<double> m_constants;
+    std::vector<std::string> m_variables;
+    size_t m_max_stack = 0;
+    bool m_has_operations = false;
+
+    friend class ExpressionCompiler;
+};
+
+// Compiled expressions by text. Invalid expressions are cached as well so
+// that they are not re-parsed either. Safe to use from several threads.
+class ExpressionCache {
+public:
+    // nullptr if `text` is not a valid expression
+    const Expression* get(std::string_view text);
+
+    size_t size() const;
+
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    };
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, std::unique_ptr<Expression>, Hash, std::equal_to<>> m_entries;
+};
+
+} // namespace xschem
+
+#endif // XSCHEM_EXPR_H
@@ -0,0 +1,707 @@
+// xschem_flatten.cpp - Flat view of a hierarchical design
+// Implementation file
+
+#include "xschem_flatten.h"
+#include "xschem_stats.h"
+#include "xschem_trace.h"
+#include "xschem_expr.h"
+#include <cctype>
+#include <iostream>
+#include <filesystem>
+
+namespace xschem {
+
+namespace {
+
+// Local net classes: the low bits index the internal nets, the placing
+// symbol's pin bits or the global nets
+constexpr uint32_t net_internal = 0;
+constexpr uint32_t net_port = 1u << 30;
+constexpr uint32_t net_global = 2u << 30;
+constexpr uint32_t net_index_mask = net_port - 1;
+
+// Instance ranges of the top cell written per task
+constexpr size_t write_tasks_per_thread = 8;
+
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+bool is_name_char(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// key=value fields of a placement line, sorted by key. Quoted ('W * 2')
+// and braced ({W*2}) values are kept whole.
+Params line_params(std::string_view text) {
+    Params params;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+        const size_t start = pos;
+        char quote = 0;
+        int braces = 0;
+        for (; pos < text.size() && (quote || braces || !std::isspace(static_cast<unsigned char>(text[pos]))); pos++) {
+            char c = text[pos];
+            if (quote) {
+                if (c == quote) quote = 0;
+            } else if (c == '\'' || c == '"') {
+                quote = c;
+            } else if (c == '{') {
+                braces++;
+            } else if (c == '}' && braces > 0) {
+                braces--;
+            }
+        }
+        std::string_view field = text.substr(start, pos - start);
+        size_t eq = field.find('=');
+        if (eq != std::string_view::npos && eq > 0 && eq + 1 < field.size()) {
+            params.emplace_back(field.substr(0, eq), field.substr(eq + 1));
+        }
+    }
+    std::stable_sort(params.begin(), params.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    return params;
+}
+
+// A property value with the cell's parameter names replaced by their
+// values. A value that is only a name takes the parameter value as it is;
+// inside an expression the value loses its quotes or braces and, unless it
+// is a number, is parenthesized ('W/2' with W='L*2' gives '(L*2)/2').
+std::string substitute_params(std::string_view value, const Params& params) {
+    auto find = [&params](std::string_view name) -> const std::string* {
+        for (const auto& [key, val] : params) {
+            if (key == name) return &val;
+        }
+        return nullptr;
+    };
+    if (const std::string* whole = find(value)) return *whole;
+
+    std::string out;
+    size_t pos = 0;
+    while (pos < value.size()) {
+        const char c = value[pos];
+        // A name starts with a letter not inside a number ("2u") or name
+        const bool starts = (std::isalpha(static_cast<unsigned char>(c)) || c == '_') &&
+                            (pos == 0 || (!is_name_char(value[pos - 1]) && value[pos - 1] != '.'));
+        if (!starts) {
+            out += c;
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while (end < value.size() && is_name_char(value[end])) end++;
+        std::string_view name = value.substr(pos, end - pos);
+        pos = end;
+        const std::string* param = find(name);
+        if (!param) {
+            out += name;
+            continue;
+        }
+        std::string_view inner = *param;
+        if (inner.size() >= 2 && ((inner.front() == '\'' && inner.back() == '\'') ||
+                                  (inner.front() == '{' && inner.back() == '}'))) {
+            inner = inner.substr(1, inner.size() - 2);
+        }
+        double number;
+        if (parse_spice_number(inner, number)) {
+            out += inner;
+        } else {
+            out += '(';
+            out += inner;
+            out += ')';
+        }
+    }
+    return out;
+}
+
+// Properties that name or connect an instance rather than give it a value
+bool structural_property(std::string_view key) {
+    return key == "name" || key == "lab" || key == "schematic" || key == "spiceprefix";
+}
+
+// Substitute a cell's parameters in the properties of its elements, and in
+// the symbol template values their formats fall back to. Code blocks are
+// simulator commands and stay as written.
+void apply_params(Schematic& sch, const Params& params) {
+    for (auto& inst : sch.instances) {
+        auto sym_it = sch.symbols.find(inst.symbol_name);
+        const Symbol* sym = sym_it == sch.symbols.end() ? nullptr : &sym_it->second;
+        if (sym && sym->kind == SymbolKind::Code) continue;
+        PropMap substituted;
+        for (const auto& [key, val] : inst.prop_map) {
+            substituted.set(key, structural_property(key) ? val : substitute_params(val, params));
+        }
+        if (sym) {
+            for (const FormatToken& token : sym->format_tokens) {
+                if (token.kind != FormatToken::Kind::Property || inst.prop_map.find(token.text) != inst.prop_map.end()) {
+                    continue;
+                }
+                std::string val = get_tok_value(sym->template_str, token.text);
+                if (!val.empty()) substituted.set(token.text, substitute_params(val, params));
+            }
+        }
+        inst.prop_map = std::move(substituted);
+    }
+}
+
+} // namespace
+
+struct FlatDesign::Cell {
+    std::string name;                   // Schematic file stem
+    std::string path;                   // Schematic file
+    std::string symbol;                 // Symbol placing it ("" for the top)
+    Params params;                      // Passed by its placements, substituted in its elements
+    std::vector<std::string> pin_bits;  // Of that symbol, in pin order ("A", "D[3]")
+    SchematicParser parser;             // Holds the schematic
+    std::unique_ptr<NetTable> nets;
+    size_t instance_count = 0;
+
+    // Per instance: the cell it places (npos: written as an element line),
+    // and while loading, the schematic found for it and the parameters the
+    // placement passes
+    std::vector<uint32_t> child;
+    std::vector<std::string> child_path;
+    std::vector<Params> child_params;
+
+    // Element lines per instance copy, split around the pin nets (CSR)
+    std::vector<uint32_t> line_first;
+    std::vector<std::pair<std::string, std::string>> lines;
+    std::vector<std::string> commands;  // Code block lines, not devices
+
+    std::vector<std::string> global_labels;
+    std::vector<uint32_t> net_class;    // Per local net
+    std::vector<uint32_t> internal;     // Local net of each internal net
+    uint32_t internal_nets = 0;
+
+    // Per instance (+1): flat nets below child cells after the internal
+    // nets, and flat devices, up to that instance
+    std::vector<uint64_t> net_first;
+    std::vector<uint64_t> device_first;
+
+    uint64_t flat_nets() const { return internal_nets + net_first.back(); }
+    uint64_t flat_devices() const { return device_first.back(); }
+};
+
+// A flat net: a local net of the cell instance `owner`, or global net
+// `local` when owner is null
+struct FlatDesign::NetRef {
+    const Frame* owner;
+    uint32_t local;
+};
+
+// One placed cell on the way down the hierarchy
+struct FlatDesign::Frame {
+    uint32_t cell = 0;
+    uint64_t base = 0;              // Flat id of internal net 0
+    std::vector<NetRef> ports;      // Per pin bit of the placing symbol
+    std::string prefix;             // "x1.x3." when names are built
+    InstancePath path;
+};
+
+FlatDesign::FlatDesign() = default;
+FlatDesign::~FlatDesign() = default;
+
+const Schematic& FlatDesign::cell(uint32_t id) const { return m_cells[id]->parser.schematic(); }
+const std::string& FlatDesign::cell_name(uint32_t id) const { return m_cells[id]->name; }
+
+uint64_t FlatDesign::device_count() const {
+    return m_cells.empty() ? 0 : m_cells[0]->flat_devices();
+}
+
+uint64_t FlatDesign::net_count() const {
+    return m_cells.empty() ? 0 : m_globals.size() + m_cells[0]->flat_nets();
+}
+
+// ============================================================================
+// Loading
+// ============================================================================
+
+bool FlatDesign::load_cell(Cell& cell, const std::vector<std::string>& symbol_paths,
+                           const FlattenOptions& options) {
+    XSCHEM_TRACE_SCOPE("flatten_cell", cell.path);
+    cell.parser.set_load_options(options.load);
+    for (const auto& path : symbol_paths) cell.parser.add_symbol_path(path);
+    if (!cell.parser.load(cell.path)) {
+        std::cerr << "Error: Failed to load schematic: " << cell.path << std::endl;
+        return false;
+    }
+    Schematic& sch = cell.parser.schematic();
+    if (!cell.params.empty()) apply_params(sch, cell.params);
+    NetResolver(sch).resolve();
+    cell.nets = std::make_unique<NetTable>(sch);
+    cell.instance_count = sch.instances.size();
+
+    SpiceNetlister netlister(sch);
+    netlister.set_net_table(cell.nets.get());
+    netlister.set_evaluate_expressions(options.evaluate);
+
+    // Subcircuits with a schematic are descended into; every other element
+    // is formatted once here, whatever the number of placements
+    std::unordered_map<std::string_view, std::string> schematic_of;
+    cell.child.assign(cell.instance_count, npos);
+    cell.child_path.assign(cell.instance_count, std::string());
+    cell.child_params.assign(cell.instance_count, Params());
+    cell.line_first.assign(1, 0);
+    for (size_t i = 0; i < cell.instance_count; i++) {
+        const Instance& inst = sch.instances[i];
+        const Symbol* sym = cell.nets->symbol(i);
+        if (sym && sym->kind == SymbolKind::Subcircuit && cell.nets->is_element(i)) {
+            auto [it, fresh] = schematic_of.try_emplace(inst.symbol_name);
+            if (fresh) {
+                std::string name = get_tok_value(sym->props, "schematic");
+                if (name.empty()) name = std::filesystem::path(inst.symbol_name).replace_extension(".sch").string();
+                it->second = cell.parser.find_symbol_file(name);
+            }
+            cell.child_path[i] = it->second;
+        }
+        std::string before, after;
+        if (!cell.child_path[i].empty()) {
+            // Parameters passed to the cell (k=v after the pins); every
+            // copy of an array passes the same
+            if (netlister.split_element(i, 0, before, after)) cell.child_params[i] = line_params(after);
+        } else if (sym && sym->kind == SymbolKind::Code) {
+            for (size_t c = 0; c < cell.nets->copies(i) && netlister.split_element(i, c, before, after); c++) {
+                if (!before.empty() || !after.empty()) cell.commands.push_back(before + after);
+            }
+        } else {
+            for (size_t c = 0; c < cell.nets->copies(i) && netlister.split_element(i, c, before, after); c++) {
+                cell.lines.emplace_back(std::move(before), std::move(after));
+            }
+        }
+        cell.line_first.push_back(static_cast<uint32_t>(cell.lines.size()));
+
+        if (sym && sym->names_net && get_tok_value(sym->props, "global") == "true") {
+            BusName lab(get_tok_value(inst.props, "lab"));
+            for (size_t b = 0; b < lab.width(); b++) cell.global_labels.push_back(lab.bit(b));
+        }
+    }
+    stat_add(&Stats::hash_lookups, cell.instance_count);
+    return true;
+}
+
+bool FlatDesign::link_cells() {
+    // Children before parents; a cell reached again on the way down places itself
+    std::vector<uint8_t> state(m_cells.size(), 0);   // 0 new, 1 open, 2 done
+    std::vector<uint32_t> order;
+    std::vector<std::pair<uint32_t, size_t>> stack = {{0, 0}};
+    state[0] = 1;
+    while (!stack.empty()) {
+        auto& [id, next] = stack.back();
+        const Cell& cell = *m_cells[id];
+        if (next == cell.instance_count) {
+            state[id] = 2;
+            order.push_back(id);
+            stack.pop_back();
+            continue;
+        }
+        uint32_t child = cell.child[next++];
+        if (child == npos || state[child] == 2) continue;
+        if (state[child] == 1) {
+            std::cerr << "Error: Recursive instantiation of " << m_cells[child]->path << std::endl;
+            return false;
+        }
+        state[child] = 1;
+        stack.emplace_back(child, 0);
+    }
+
+    // Global nets, then each cell's local nets: global, port or internal
+    std::vector<std::string> globals;
+    for (const auto& cell : m_cells) {
+        globals.insert(globals.end(), cell->global_labels.begin(), cell->global_labels.end());
+    }
+    std::sort(globals.begin(), globals.end());
+    globals.erase(std::unique(globals.begin(), globals.end()), globals.end());
+    m_globals = std::move(globals);
+
+    for (uint32_t id : order) {
+        Cell& cell = *m_cells[id];
+        const NetTable& nets = *cell.nets;
+        cell.net_class.assign(nets.net_count(), npos);
+        std::unordered_map<std::string_view, uint32_t> pin_bit;
+        for (size_t k = 0; k < cell.pin_bits.size(); k++) {
+            pin_bit.try_emplace(cell.pin_bits[k], static_cast<uint32_t>(k));
+        }
+        for (const auto& port : nets.ports()) {
+            auto it = pin_bit.find(port.name);
+            if (it != pin_bit.end()) cell.net_class[port.net] = net_port | it->second;
+        }
+        cell.internal.clear();
+        for (uint32_t n = 0; n < nets.net_count(); n++) {
+            auto global = std::lower_bound(m_globals.begin(), m_globals.end(), nets.net(n));
+            if (global != m_globals.end() && *global == nets.net(n)) {
+                cell.net_class[n] = net_global | static_cast<uint32_t>(global - m_globals.begin());
+            } else if (cell.net_class[n] == npos) {
+                cell.net_class[n] = net_internal | static_cast<uint32_t>(cell.internal.size());
+                cell.internal.push_back(n);
+            }
+        }
+        cell.internal_nets = static_cast<uint32_t>(cell.internal.size());
+        stat_add(&Stats::hash_lookups, cell.pin_bits.size() + nets.ports().size());
+
+        cell.net_first.assign(1, 0);
+        cell.device_first.assign(1, 0);
+        for (size_t i = 0; i < cell.instance_count; i++) {
+            uint64_t nets_below = 0, devices = cell.line_first[i + 1] - cell.line_first[i];
+            if (cell.child[i] != npos) {
+                const Cell& child = *m_cells[cell.child[i]];
+                nets_below = child.flat_nets() * nets.copies(i);
+                devices = child.flat_devices() * nets.copies(i);
+            }
+            cell.net_first.push_back(cell.net_first.back() + nets_below);
+            cell.device_first.push_back(cell.device_first.back() + devices);
+        }
+    }
+    return true;
+}
+
+bool FlatDesign::load(const std::string& filename, const std::vector<std::string>& symbol_paths,
+                      const FlattenOptions& options) {
+    XSCHEM_TRACE_SCOPE("flatten", filename);
+    m_cells.clear();
+    m_globals.clear();
+    m_threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    auto top = std::make_unique<Cell>();
+    top->path = filename;
+    m_cells.push_back(std::move(top));
+
+    // One level of new cells at a time, each level loaded in parallel. The
+    // cell parsers share one pool for reading symbols; it cannot be `pool`,
+    // whose tasks wait for the symbols.
+    WorkerPool pool(m_threads);
+    auto symbol_pool = std::make_shared<WorkerPool>(m_threads);
+    std::unordered_map<std::string, uint32_t> cell_ids;     // Schematic + symbol + parameters
+    size_t level_begin = 0;
+    while (level_begin < m_cells.size()) {
+        const size_t level_end = m_cells.size();
+        std::vector<char> ok(level_end - level_begin, 0);
+        for (size_t id = level_begin; id < level_end; id++) {
+            m_cells[id]->parser.set_worker_pool(symbol_pool);
+            pool.submit([&, id, stats = current_stats()] {
+                StatsScope scope(stats);
+                ok[id - level_begin] = load_cell(*m_cells[id], symbol_paths, options);
+            });
+        }
+        pool.wait();
+        for (size_t id = level_begin; id < level_end; id++) m_cells[id]->parser.set_worker_pool(nullptr);
+        if (std::find(ok.begin(), ok.end(), 0) != ok.end()) return false;
+
+        for (size_t id = level_begin; id < level_end; id++) {
+            Cell& cell = *m_cells[id];
+            const Schematic& sch = cell.parser.schematic();
+            for (size_t i = 0; i < cell.instance_count; i++) {
+                if (cell.child_path[i].empty()) continue;
+                const std::string& symbol = sch.instances[i].symbol_name;
+                std::string key = cell.child_path[i] + '\n' + symbol;
+                for (const auto& [name, value] : cell.child_params[i]) key += '\n' + name + '=' + value;
+                auto [it, fresh] = cell_ids.try_emplace(std::move(key), static_cast<uint32_t>(m_cells.size()));
+                if (fresh) {
+                    auto child = std::make_unique<Cell>();
+                    child->path = cell.child_path[i];
+                    child->symbol = symbol;
+                    child->params = std::move(cell.child_params[i]);
+                    for (const auto& pin : cell.nets->symbol(i)->pins) {
+                        BusName bits(pin.name);
+                        for (size_t b = 0; b < bits.width(); b++) child->pin_bits.push_back(bits.bit(b));
+                    }
+                    m_cells.push_back(std::move(child));
+                }
+                cell.child[i] = it->second;
+            }
+            cell.child_path = std::vector<std::string>();
+            cell.child_params = std::vector<Params>();
+        }
+        level_begin = level_end;
+    }
+
+    for (auto& cell : m_cells) {
+        cell->name = std::filesystem::path(cell->path).stem().string();
+    }
+    return link_cells();
+}
+
+std::vector<std::string> FlatDesign::dependencies() const {
+    std::vector<std::string> deps;
+    for (size_t id = 0; id < m_cells.size(); id++) {
+        if (id > 0) deps.push_back(m_cells[id]->path);
+        const auto& sch_deps = m_cells[id]->parser.schematic().dependencies;
+        deps.insert(deps.end(), sch_deps.begin(), sch_deps.end());
+    }
+    std::vector<std::string> unique;
+    std::unordered_set<std::string_view> seen;
+    for (const auto& dep : deps) {
+        if (seen.insert(dep).second) unique.push_back(dep);
+    }
+    return unique;
+}
+
+// ============================================================================
+// Expansion
+// ============================================================================
+
+FlatDesign::NetRef FlatDesign::resolve(const Frame& frame, uint32_t net) const {
+    uint32_t cls = m_cells[frame.cell]->net_class[net];
+    if (cls >= net_global) return {nullptr, cls & net_index_mask};
+    if (cls >= net_port) return frame.ports[cls & net_index_mask];
+    return {&frame, net};
+}
+
+uint64_t FlatDesign::flat_id(const NetRef& ref) const {
+    if (!ref.owner) return ref.local;
+    return ref.owner->base + (m_cells[ref.owner->cell]->net_class[ref.local] & net_index_mask);
+}
+
+void FlatDesign::enter(const Frame& parent, uint32_t inst, uint32_t copy, bool names, Frame& child) const {
+    const Cell& cell = *m_cells[parent.cell];
+    const NetTable& nets = *cell.nets;
+    child.cell = cell.child[inst];
+    child.base = parent.base + cell.internal_nets + cell.net_first[inst] +
+                 copy * m_cells[child.cell]->flat_nets();
+    child.ports.clear();
+    for (size_t p = 0; p < nets.pin_count(inst); p++) {
+        for (size_t b = 0; b < nets.pin_width(inst, p); b++) {
+            child.ports.push_back(resolve(parent, nets.pin_net(inst, p, copy, b)));
+        }
+    }
+    child.path = parent.path;
+    child.path.push_back({parent.cell, inst, copy});
+    if (names) {
+        child.prefix = parent.prefix;
+        BusName(cell.parser.schematic().instances[inst].inst_name).append_bit(child.prefix, copy);
+        child.prefix += '.';
+    }
+}
+
+// Calls visit(frame, inst, copy, line) for the element lines of instances
+// first..last-1 of the frame's cell and, depth first, of the cells they place
+template <typename Visit>
+void FlatDesign::expand(const Frame& frame, size_t first, size_t last, bool names, Visit& visit) const {
+    const Cell& cell = *m_cells[frame.cell];
+    for (size_t i = first; i < last; i++) {
+        if (cell.child[i] == npos) {
+            for (uint32_t line = cell.line_first[i]; line < cell.line_first[i + 1]; line++) {
+                visit(frame, static_cast<uint32_t>(i), line - cell.line_first[i], line);
+            }
+            continue;
+        }
+        Frame child;
+        for (uint32_t c = 0; c < cell.nets->copies(i); c++) {
+            enter(frame, static_cast<uint32_t>(i), c, names, child);
+            expand(child, 0, m_cells[child.cell]->instance_count, names, visit);
+        }
+    }
+}
+
+void FlatDesign::for_each_device(const std::function<void(const InstancePath&, const Device&)>& visit) const {
+    if (m_cells.empty()) return;
+    Frame top;
+    top.base = m_globals.size();
+    std::vector<uint64_t> nets;
+    auto device = [&](const Frame& frame, uint32_t inst, uint32_t copy, uint32_t) {
+        const NetTable& table = *m_cells[frame.cell]->nets;
+        nets.clear();
+        for (size_t p = 0; p < table.pin_count(inst); p++) {
+            for (size_t b = 0; b < table.pin_width(inst, p); b++) {
+                nets.push_back(flat_id(resolve(frame, table.pin_net(inst, p, copy, b))));
+            }
+        }
+        visit(frame.path, Device{frame.cell, inst, copy, nets});
+    };
+    expand(top, 0, m_cells[0]->instance_count, false, device);
+}
+
+std::string FlatDesign::path_name(const InstancePath& path) const {
+    std::string name;
+    for (const auto& step : path) {
+        if (!name.empty()) name += '.';
+        BusName(m_cells[step.cell]->parser.schematic().instances[step.inst].inst_name).append_bit(name, step.copy);
+    }
+    return name;
+}
+
+std::string FlatDesign::device_name(const InstancePath& path, const Device& device) const {
+    std::string name = path_name(path);
+    if (!name.empty()) name += '.';
+    BusName(m_cells[device.cell]->parser.schematic().instances[device.inst].inst_name).append_bit(name, device.copy);
+    return name;
+}
+
+std::string FlatDesign::net_name(uint64_t net) const {
+    if (net < m_globals.size()) return m_globals[net];
+
+    // Walk down from the top to the cell instance owning the net
+    std::string prefix;
+    uint32_t id = 0;
+    uint64_t offset = net - m_globals.size();
+    for (;;) {
+        const Cell& cell = *m_cells[id];
+        if (offset < cell.internal_nets) return prefix + cell.nets->net(cell.internal[offset]);
+        offset -= cell.internal_nets;
+        auto next = std::upper_bound(cell.net_first.begin(), cell.net_first.end(), offset) - 1;
+        auto inst = static_cast<size_t>(next - cell.net_first.begin());
+        offset -= *next;
+        const Cell& child = *m_cells[cell.child[inst]];
+        size_t copy = offset / child.flat_nets();
+        offset %= child.flat_nets();
+        BusName(cell.parser.schematic().instances[inst].inst_name).append_bit(prefix, copy);
+        prefix += '.';
+        id = cell.child[inst];
+    }
+}
+
+// ============================================================================
+// ERC
+// ============================================================================
+
+void FlatDesign::placement_erc(const Frame& frame, std::vector<Violation>& out) const {
+    const Cell& cell = *m_cells[frame.cell];
+    const std::string path = frame.prefix.empty() ? "" : frame.prefix.substr(0, frame.prefix.size() - 1) + ": ";
+    for (const auto& v : cell.parser.schematic().erc) {
+        if (v.kind == ErcViolation::Kind::OutputConflict) continue;
+        out.push_back({frame.cell, {v.kind, v.at, path + v.message}});
+    }
+    Frame child;
+    for (size_t i = 0; i < cell.instance_count; i++) {
+        if (cell.child[i] == npos) continue;
+        for (uint32_t c = 0; c < cell.nets->copies(i); c++) {
+            enter(frame, static_cast<uint32_t>(i), c, true, child);
+            placement_erc(child, out);
+        }
+    }
+}
+
+std::vector<FlatDesign::Violation> FlatDesign::erc() const {
+    std::vector<Violation> result;
+    if (m_cells.empty()) return result;
+    Frame top;
+    top.base = m_globals.size();
+    placement_erc(top, result);
+
+    // The first output pin on a flat net drives it, wherever its device is;
+    // cells report their own conflicts on local nets only, so those are
+    // found here instead
+    std::unordered_map<uint64_t, std::string> drivers;
+    uint64_t lookups = 0;
+    for_each_device([&](const InstancePath& path, const Device& device) {
+        const Cell& cell = *m_cells[device.cell];
+        const Symbol& sym = *cell.nets->symbol(device.inst);
+        size_t bit = 0;
+        for (size_t p = 0; p < cell.nets->pin_count(device.inst); p++) {
+            const size_t width = cell.nets->pin_width(device.inst, p);
+            if (!sym.pins[p].output) {
+                bit += width;
+                continue;
+            }
+            for (size_t b = 0; b < width; b++, bit++) {
+                std::string driver = device_name(path, device) + " pin " + sym.pins[p].name;
+                auto [it, first] = drivers.try_emplace(device.nets[bit], driver);
+                lookups++;
+                if (first) continue;
+                const Instance& inst = cell.parser.schematic().instances[device.inst];
+                result.push_back({device.cell, {ErcViolation::Kind::OutputConflict,
+                                                instance_point(inst, sym.pins[p].x, sym.pins[p].y),
+                                                net_name(device.nets[bit]) + ": " + it->second + ", " + driver}});
+            }
+        }
+    });
+    stat_add(&Stats::hash_lookups, lookups);
+    return result;
+}
+
+// ============================================================================
+// SPICE output
+// ============================================================================
+
+void FlatDesign::write_range(size_t first, size_t last, std::string& out) const {
+    Frame top;
+    top.base = m_globals.size();
+    auto line = [&](const Frame& frame, uint32_t inst, uint32_t copy, uint32_t index) {
+        const Cell& cell = *m_cells[frame.cell];
+        const NetTable& nets = *cell.nets;
+        const auto& [before, after] = cell.lines[index];
+        const size_t start = out.size();
+
+        // Element name: letter, '.', path, name
+        if (!frame.prefix.empty() && !before.empty()) {
+            out += before[0];
+            out += '.';
+            out += frame.prefix;
+        }
+        out += before;
+        size_t pins = 0;
+        for (size_t p = 0; p < nets.pin_count(inst); p++) {
+            for (size_t b = 0; b < nets.pin_width(inst, p); b++) {
+                if (pins++ > 0) out += ' ';
+                const NetRef ref = resolve(frame, nets.pin_net(inst, p, copy, b));
+                if (ref.owner) out += ref.owner->prefix;
+                out += ref.owner ? m_cells[ref.owner->cell]->nets->net(ref.local) : m_globals[ref.local];
+            }
+        }
+        // No pin nets: the spaces around them collapse, as in SpiceNetlister
+        if (pins == 0 && out.size() > start && out.back() == ' ' && !after.empty() && after[0] == ' ') {
+            out.pop_back();
+        }
+        out += after;
+        while (out.size() > start && out.back() == ' ') out.pop_back();
+        if (out.size() > start) out += '\n';
+    };
+    expand(top, first, last, true, line);
+}
+
+bool FlatDesign::write_spice(std::ostream& out) const {
+    if (m_cells.empty()) return false;
+    StageTimer timer(Stage::Emission);
+    XSCHEM_TRACE_SCOPE("emit_flat_netlist", m_cells[0]->path);
+    const Cell& top = *m_cells[0];
+
+    out << "** sch_path: " << top.parser.schematic().filename << "\n";
+    out << "** " << top.name << "\n";
+
+    // Ranges of top-level instances of about equal device counts, written
+    // in parallel and output in order, a bounded number at a time
+    const size_t tasks = m_threads * write_tasks_per_thread;
+    const uint64_t per_task = std::max<uint64_t>(1, top.flat_devices() / tasks);
+    std::vector<size_t> bounds = {0};
+    for (size_t i = 1; i < top.instance_count; i++) {
+        if (top.device_first[i] - top.device_first[bounds.back()] >= per_task) bounds.push_back(i);
+    }
+    bounds.push_back(top.instance_count);
+
+    std::vector<std::string> texts(tasks);
+    WorkerPool pool(m_threads);
+    for (size_t wave = 0; wave + 1 < bounds.size(); wave += tasks) {
+        const size_t count = std::min(tasks, bounds.size() - 1 - wave);
+        for (size_t t = 0; t < count; t++) {
+            pool.submit([&, t, stats = current_stats()] {
+                StatsScope scope(stats);
+                XSCHEM_TRACE_SCOPE("emit_subtrees");
+                texts[t].clear();
+                write_range(bounds[wave + t], bounds[wave + t + 1], texts[t]);
+            });
+        }
+        pool.wait();
+        for (size_t t = 0; t < count; t++) out << texts[t];
+    }
+
+    // Code blocks after the devices, once per cell definition, the top's
+    // first; the same text in several cells (".include models.lib") once
+    std::unordered_set<std::string_view> written;
+    for (size_t id = 0; id < m_cells.size(); id++) {
+        for (const auto& command : m_cells[id]->commands) {
+            if (written.insert(command).second) out << command << "\n";
+        }
+    }
+
+    out << ".end\n";
+    return true;
+}
+
+bool FlatDesign::write_spice(const std::string& output_file) const {
+    std::ofstream out(output_file);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot open output file: " << output_file << std::endl;
+        return false;
+    }
+    return write_spice(out);
+}
+
+} // namespace xschem
@@ -0,0 +1,124 @@
+// xschem_flatten.h - Flat view of a hierarchical design
+// The design is held as a DAG of cell definitions: each schematic reached
+// through a subcircuit symbol is loaded, resolved and formatted once per
+// set of parameter values, however often it is placed. Flat devices and nets are not stored. They are
+// numbered by offsets into each cell's subtree and visited depth first
+// along an instance path, so hierarchical names ("x1.x3.M2") are only built
+// when a netlist is written. Cells load in parallel, one level of the DAG
+// at a time, and the writer expands independent subtrees of the top cell
+// in parallel.
+//
+// A subcircuit symbol is descended into when its schematic= property, or
+// the symbol name with .sch instead of .sym, is found on the symbol paths.
+// Its pins connect by name to the ipin/opin/iopin labels of that schematic.
+// Nets labelled by a symbol with global=true are one net across the design.
+// A placement that passes parameters (x1 ... sub W=2) places the cell
+// definition for those values: the names are replaced by the values in the
+// element properties of that definition before it is formatted, so nested
+// placements and --eval see the values. Placements passing the same values
+// share one definition.
+// Code blocks (netlist_commands) are simulator commands, not devices: they
+// are written as they are after the devices, once per cell definition.
+
+#ifndef XSCHEM_FLATTEN_H
+#define XSCHEM_FLATTEN_H
+
+#include "xschem_lite.h"
+#include <ostream>
+
+namespace xschem {
+
+struct FlattenOptions {
+    LoadOptions load = LoadOptions::netlist_only();
+    bool evaluate = false;      // As SpiceNetlister::set_evaluate_expressions
+    unsigned threads = 0;       // Cell loading and writing (0: all cores)
+};
+
+class FlatDesign {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // One level of an instance path: copy `copy` of instance `inst` of
+    // `cell`, which places the next cell down
+    struct PathStep {
+        uint32_t cell;
+        uint32_t inst;
+        uint32_t copy;
+    };
+    using InstancePath = std::vector<PathStep>;
+
+    // A flat device: one copy of a netlisted instance that is not descended
+    // into. Valid during the for_each_device callback only.
+    struct Device {
+        uint32_t cell;
+        uint32_t inst;
+        uint32_t copy;
+        std::span<const uint64_t> nets;     // Flat net per pin bit
+    };
+
+    // An ERC report of the flat design, in the coordinates of cell `cell`
+    struct Violation {
+        uint32_t cell;
+        ErcViolation erc;
+    };
+
+    FlatDesign();
+    ~FlatDesign();
+    FlatDesign(const FlatDesign&) = delete;
+    FlatDesign& operator=(const FlatDesign&) = delete;
+
+    // Load the top schematic and every cell below it
+    bool load(const std::string& filename, const std::vector<std::string>& symbol_paths,
+              const FlattenOptions& options = FlattenOptions());
+
+    // Cell 0 is the top
+    size_t cell_count() const { return m_cells.size(); }
+    const Schematic& cell(uint32_t id) const;
+    const std::string& cell_name(uint32_t id) const;
+    uint64_t device_count() const;
+    uint64_t net_count() const;
+
+    // Devices in netlist order: instance order, depth first
+    void for_each_device(const std::function<void(const InstancePath&, const Device&)>& visit) const;
+    std::string path_name(const InstancePath& path) const;                          // "x1.x3"
+    std::string device_name(const InstancePath& path, const Device& device) const;  // "x1.x3.M2"
+    std::string net_name(uint64_t net) const;   // "x1.net4"; net < net_count()
+
+    // Flat SPICE netlist, no .subckt wrapper. Element names get the path in
+    // the form SPICE simulators use for expanded subcircuits: letter, '.',
+    // path, original name ("R.x1.x3.R2"); top-level elements keep theirs.
+    bool write_spice(std::ostream& out) const;
+    bool write_spice(const std::string& output_file) const;
+
+    // ERC of the flat design: each cell's reports at every placement, the
+    // message prefixed with the instance path ("x1.x3: M2 pin G"), then
+    // output conflicts between devices on one flat net, across cells
+    std::vector<Violation> erc() const;
+
+    // Files the design was loaded from besides the top schematic
+    std::vector<std::string> dependencies() const;
+
+private:
+    struct Cell;
+    struct Frame;
+    struct NetRef;
+
+    std::vector<std::unique_ptr<Cell>> m_cells;
+    std::vector<std::string> m_globals;     // Global net names, sorted; flat ids 0..
+    unsigned m_threads = 1;
+
+    bool load_cell(Cell& cell, const std::vector<std::string>& symbol_paths,
+                   const FlattenOptions& options);
+    bool link_cells();
+    NetRef resolve(const Frame& frame, uint32_t net) const;
+    uint64_t flat_id(const NetRef& ref) const;
+    void enter(const Frame& parent, uint32_t inst, uint32_t copy, bool names, Frame& child) const;
+    template <typename Visit>
+    void expand(const Frame& frame, size_t first, size_t last, bool names, Visit& visit) const;
+    void write_range(size_t first, size_t last, std::string& out) const;
+    void placement_erc(const Frame& frame, std::vector<Violation>& out) const;
+};
+
+} // namespace xschem
+
+#endif // XSCHEM_FLATTEN_H
@@ -2,10 +2,18 @@
 // Implementation file
 
 #include "xschem_lite.h"
+#include "xschem_stats.h"
+#include "xschem_trace.h"
 #include <iostream>
+#include <atomic>
 #include <cctype>
+#include <charconv>
 #include <filesystem>
-#include <regex>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <string_view>
+#include <unistd.h>
 
 namespace xschem {
 
@@ -69,8 +77,8 @@ std::string get_tok_value(const std::string& props, const std::string& key) {
     return "";
 }
 
-std::unordered_map<std::string, std::string> parse_props(const std::string& props) {
-    std::unordered_map<std::string, std::string> result;
+PropMap parse_props(const std::string& props) {
+    PropMap result;
     if (props.empty()) return result;
 
     size_t pos = 0;
@@ -108,84 +116,635 @@ std::unordered_map<std::string, std::string> parse_props(const std::string& prop
         }
 
         if (!key.empty()) {
-            result[key] = value;
+            result.set(std::move(key), std::move(value));
         }
     }
     return result;
 }
 
+BusName::BusName(std::string_view name) : m_name(name) {
+    if (name.find_first_of("[,") == std::string_view::npos) return;
+
+    auto parse_long = [](std::string_view text, long& value) {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size();
+    };
+
+    // "a", "a:b" or "a:b:step" index of `base`
+    auto add_range = [&](std::string_view base, std::string_view spec) {
+        Segment seg;
+        seg.base = base;
+        seg.indexed = true;
+        size_t c1 = spec.find(':');
+        long last = 0, step = 1;
+        if (c1 == std::string_view::npos) {
+            if (!parse_long(spec, seg.first)) return false;
+            last = seg.first;
+        } else {
+            size_t c2 = spec.find(':', c1 + 1);
+            std::string_view last_text = spec.substr(c1 + 1, c2 == std::string_view::npos ? c2 : c2 - c1 - 1);
+            if (!parse_long(spec.substr(0, c1), seg.first) || !parse_long(last_text, last)) return false;
+            if (c2 != std::string_view::npos && (!parse_long(spec.substr(c2 + 1), step) || step <= 0)) {
+                return false;
+            }
+        }
+        seg.step = seg.first > last ? -step : step;
+        seg.width = static_cast<size_t>(std::abs(last - seg.first) / step) + 1;
+        m_segments.push_back(seg);
+        return true;
+    };
+
+    // Top-level commas separate segments; commas inside [] separate indices
+    bool ok = true;
+    size_t start = 0;
+    while (ok && start <= name.size()) {
+        size_t end = start;
+        int depth = 0;
+        while (end < name.size() && (depth > 0 || name[end] != ',')) {
+            if (name[end] == '[') depth++;
+            else if (name[end] == ']') depth--;
+            end++;
+        }
+        std::string_view part = name.substr(start, end - start);
+        size_t open = part.find('[');
+        if (part.empty()) {
+            ok = false;
+        } else if (open == std::string_view::npos || part.back() != ']') {
+            Segment seg;
+            seg.base = part;
+            m_segments.push_back(seg);
+        } else {
+            std::string_view base = part.substr(0, open);
+            std::string_view specs = part.substr(open + 1, part.size() - open - 2);
+            size_t s = 0;
+            while (ok && s <= specs.size()) {
+                size_t comma = specs.find(',', s);
+                if (comma == std::string_view::npos) comma = specs.size();
+                ok = add_range(base, specs.substr(s, comma - s));
+                s = comma + 1;
+            }
+        }
+        start = end + 1;
+    }
+
+    // Single bits ("DATA[3]") and anything we cannot read stay plain names
+    m_width = 0;
+    for (const auto& seg : m_segments) m_width += seg.width;
+    if (!ok || m_width <= 1) {
+        m_segments.clear();
+        m_width = 1;
+    }
+}
+
+void BusName::append_bit(std::string& out, size_t i) const {
+    if (m_segments.empty()) {
+        out += m_name;
+        return;
+    }
+    i %= m_width;
+    for (const auto& seg : m_segments) {
+        if (i >= seg.width) {
+            i -= seg.width;
+            continue;
+        }
+        out += seg.base;
+        if (seg.indexed) {
+            out += '[';
+            out += std::to_string(seg.first + static_cast<long>(i) * seg.step);
+            out += ']';
+        }
+        return;
+    }
+}
+
+std::string BusName::bit(size_t i) const {
+    std::string out;
+    append_bit(out, i);
+    return out;
+}
+
 // ============================================================================
-// SchematicParser implementation
+// File access and worker pool
 // ============================================================================
 
-std::string SchematicParser::read_braced_string(std::istream& in) {
-    std::string result;
-    int brace_count = 0;
-    char c;
+bool FileProvider::exists(const std::string& path) const {
+    stat_add(&Stats::exists_probes);
+    std::error_code ec;
+    return std::filesystem::exists(path, ec);
+}
 
-    // Skip whitespace to find opening brace
-    while (in.get(c) && std::isspace(c));
+bool FileProvider::read(const std::string& path, std::string& content) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    stat_add(&Stats::files_opened);
+    std::ostringstream buf;
+    buf << file.rdbuf();
+    content = std::move(buf).str();
+    return true;
+}
 
-    if (c != '{') {
-        in.putback(c);
-        return "";
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
     }
+    m_task_cv.notify_all();
+    for (auto& t : m_threads) t.join();
+}
 
-    brace_count = 1;
-    while (in.get(c) && brace_count > 0) {
-        if (c == '{') brace_count++;
-        else if (c == '}') brace_count--;
+void WorkerPool::submit(std::function<void()> task, Group* group) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back({std::move(task), group});
+        m_pending++;
+        if (group) group->pending++;
+        if (m_threads.size() < m_max_threads && m_threads.size() < m_pending) {
+            m_threads.emplace_back(&WorkerPool::worker, this);
+        }
+    }
+    m_task_cv.notify_one();
+}
 
-        if (brace_count > 0) result += c;
+void WorkerPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this] { return m_pending == 0; });
+}
+
+void WorkerPool::wait(Group& group) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [&group] { return group.pending == 0; });
+}
+
+void WorkerPool::worker() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_task_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+        if (m_tasks.empty()) return;
+        auto task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        lock.unlock();
+        task.run();
+        lock.lock();
+        const bool group_done = task.group && --task.group->pending == 0;
+        if (--m_pending == 0 || group_done) m_done_cv.notify_all();
     }
+}
 
-    return result;
+// ============================================================================
+// Streaming record parser
+// ============================================================================
+
+namespace {
+
+// Cursor over .sch/.sym content. Fields are returned as views into the input.
+class RecordReader {
+public:
+    explicit RecordReader(std::string_view input) : m_in(input) {}
+
+    bool at_end() const { return m_pos >= m_in.size(); }
+    size_t pos() const { return m_pos; }
+    char next() { return m_in[m_pos++]; }
+
+    void skip_space() {
+        while (m_pos < m_in.size() && std::isspace(static_cast<unsigned char>(m_in[m_pos]))) m_pos++;
+    }
+
+    void skip_line() {
+        size_t nl = m_in.find('\n', m_pos);
+        m_pos = nl == std::string_view::npos ? m_in.size() : nl + 1;
+    }
+
+    // Contents of the next {...} block ("" if the next field is not a block).
+    // Braces nest; a backslash escapes the following character.
+    std::string_view braced() {
+        skip_space();
+        if (m_pos >= m_in.size() || m_in[m_pos] != '{') return {};
+        size_t start = ++m_pos;
+        int depth = 1;
+        while (m_pos < m_in.size()) {
+            char c = m_in[m_pos++];
+            if (c == '\\') {
+                m_pos++;
+            } else if (c == '{') {
+                depth++;
+            } else if (c == '}' && --depth == 0) {
+                return m_in.substr(start, m_pos - 1 - start);
+            }
+        }
+        m_pos = m_in.size();
+        return m_in.substr(start);
+    }
+
+    bool number(double& value) {
+        skip_space();
+        size_t start = m_pos;
+        if (start < m_in.size() && m_in[start] == '+') start++;
+        auto [end, ec] = std::from_chars(m_in.data() + start, m_in.data() + m_in.size(), value);
+        if (ec != std::errc()) return false;
+        m_pos = end - m_in.data();
+        return true;
+    }
+
+    bool number(int& value) {
+        skip_space();
+        size_t start = m_pos;
+        if (start < m_in.size() && m_in[start] == '+') start++;
+        auto [end, ec] = std::from_chars(m_in.data() + start, m_in.data() + m_in.size(), value);
+        if (ec != std::errc()) return false;
+        m_pos = end - m_in.data();
+        return true;
+    }
+
+    // Skip the fields of a record up to its {props} block, and the block.
+    // The block may also start the next line.
+    void skip_record() {
+        while (m_pos < m_in.size() && m_in[m_pos] != '{' && m_in[m_pos] != '\n') m_pos++;
+        if (m_pos < m_in.size() && m_in[m_pos] == '\n') {
+            m_pos++;
+            while (m_pos < m_in.size() && (m_in[m_pos] == ' ' || m_in[m_pos] == '\t')) m_pos++;
+            if (m_pos >= m_in.size() || m_in[m_pos] != '{') return;
+        }
+        braced();
+    }
+
+    // Contents of an embedded symbol after its '[' up to the matching ']';
+    // brackets inside {} blocks do not count
+    std::string_view embedded() {
+        size_t start = m_pos;
+        int depth = 1;
+        while (m_pos < m_in.size()) {
+            char c = m_in[m_pos];
+            if (c == '{') {
+                braced();
+                continue;
+            }
+            m_pos++;
+            if (c == '[') depth++;
+            else if (c == ']' && --depth == 0) return m_in.substr(start, m_pos - 1 - start);
+        }
+        return m_in.substr(start);
+    }
+
+    int line_of(size_t pos) const {
+        return 1 + static_cast<int>(std::count(m_in.begin(), m_in.begin() + std::min(pos, m_in.size()), '\n'));
+    }
+
+private:
+    std::string_view m_in;
+    size_t m_pos = 0;
+};
+
+// Coordinates of an L, A or P record after its layer, as a bounding box.
+// Arcs are "x y r start sweep" in degrees, y pointing down as in xschem.
+bool read_shape(RecordReader& in, char tag, ShapeRecord& sh) {
+    if (tag == 'L') {
+        if (!(in.number(sh.x1) && in.number(sh.y1) && in.number(sh.x2) && in.number(sh.y2))) return false;
+        if (sh.x1 > sh.x2) std::swap(sh.x1, sh.x2);
+        if (sh.y1 > sh.y2) std::swap(sh.y1, sh.y2);
+        return true;
+    }
+    if (tag == 'A') {
+        double x, y, r, start, sweep;
+        if (!(in.number(x) && in.number(y) && in.number(r) && in.number(start) && in.number(sweep))) {
+            return false;
+        }
+        if (std::abs(sweep) >= 360) {
+            sh.x1 = x - r; sh.y1 = y - r; sh.x2 = x + r; sh.y2 = y + r;
+            return true;
+        }
+        // End points, plus every axis direction the arc passes
+        if (sweep < 0) {
+            start += sweep;
+            sweep = -sweep;
+        }
+        const double rad = std::numbers::pi / 180.0;
+        auto point = [&](double deg, double& px, double& py) {
+            px = x + r * std::cos(deg * rad);
+            py = y - r * std::sin(deg * rad);
+        };
+        point(start, sh.x1, sh.y1);
+        sh.x2 = sh.x1;
+        sh.y2 = sh.y1;
+        auto extend = [&](double deg) {
+            double px, py;
+            point(deg, px, py);
+            sh.x1 = std::min(sh.x1, px); sh.x2 = std::max(sh.x2, px);
+            sh.y1 = std::min(sh.y1, py); sh.y2 = std::max(sh.y2, py);
+        };
+        extend(start + sweep);
+        for (double axis = std::ceil(start / 90) * 90; axis < start + sweep; axis += 90) extend(axis);
+        return true;
+    }
+    int points;
+    if (!in.number(points) || points < 1) return false;
+    for (int i = 0; i < points; i++) {
+        double px, py;
+        if (!(in.number(px) && in.number(py))) return false;
+        if (i == 0) {
+            sh.x1 = sh.x2 = px;
+            sh.y1 = sh.y2 = py;
+        } else {
+            sh.x1 = std::min(sh.x1, px); sh.x2 = std::max(sh.x2, px);
+            sh.y1 = std::min(sh.y1, py); sh.y2 = std::max(sh.y2, py);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool parse_schematic_records(std::string_view input, SchematicVisitor& visitor,
+                             const std::string& filename) {
+    RecordReader in(input);
+    const bool texts = visitor.wants_texts();
+    const bool boxes = visitor.wants_boxes();
+    const bool shapes = visitor.wants_shapes();
+
+    for (in.skip_space(); !in.at_end(); in.skip_space()) {
+        size_t record_start = in.pos();
+        char tag = in.next();
+        bool ok = true;
+        switch (tag) {
+            case 'v':
+            case 'K':
+            case 'G':
+            case 'V':
+            case 'S':
+            case 'E':
+                visitor.on_header(tag, in.braced());
+                break;
+            case 'N': {
+                WireRecord w;
+                ok = in.number(w.x1) && in.number(w.y1) && in.number(w.x2) && in.number(w.y2);
+                if (ok) {
+                    w.props = in.braced();
+                    visitor.on_wire(w);
+                }
+                break;
+            }
+            case 'C': {
+                InstanceRecord inst;
+                inst.symbol_name = in.braced();
+                ok = in.number(inst.x) && in.number(inst.y) && in.number(inst.rot) && in.number(inst.flip);
+                if (ok) {
+                    inst.props = in.braced();
+                    visitor.on_instance(inst);
+                }
+                break;
+            }
+            case 'T': {
+                if (!texts) {
+                    in.braced();
+                    in.skip_record();
+                    break;
+                }
+                TextRecord t;
+                t.text = in.braced();
+                ok = in.number(t.x) && in.number(t.y) && in.number(t.rot) && in.number(t.flip) &&
+                     in.number(t.xscale) && in.number(t.yscale);
+                if (ok) {
+                    t.props = in.braced();
+                    visitor.on_text(t);
+                }
+                break;
+            }
+            case 'B': {
+                if (!boxes) {
+                    in.skip_record();
+                    break;
+                }
+                BoxRecord b;
+                ok = in.number(b.layer) && in.number(b.x1) && in.number(b.y1) &&
+                     in.number(b.x2) && in.number(b.y2);
+                if (ok) {
+                    b.props = in.braced();
+                    visitor.on_box(b);
+                }
+                break;
+            }
+            case 'L':
+            case 'A':
+            case 'P': {
+                if (!shapes) {
+                    in.skip_record();
+                    break;
+                }
+                ShapeRecord sh;
+                sh.tag = tag;
+                ok = in.number(sh.layer) && read_shape(in, tag, sh);
+                if (ok) {
+                    sh.props = in.braced();
+                    visitor.on_shape(sh);
+                }
+                break;
+            }
+            case '[':
+                visitor.on_embedded_symbol(in.embedded());
+                break;
+            case '#':
+            default:
+                // Comment or unknown record, skip the line
+                in.skip_line();
+                break;
+        }
+        if (!ok) {
+            std::cerr << "Error: " << (filename.empty() ? "<input>" : filename) << ":"
+                      << in.line_of(record_start) << ": Malformed '" << tag << "' record" << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
-void SchematicParser::parse_wire(std::istream& in) {
-    Wire w;
-    in >> w.x1 >> w.y1 >> w.x2 >> w.y2;
-    w.props = read_braced_string(in);
-    w.is_bus = (get_tok_value(w.props, "bus") == "true");
-    m_sch.wires.push_back(w);
+bool scan_schematic(const std::string& filename, SchematicVisitor& visitor,
+                    const FileProvider* files) {
+    static const FileProvider default_files;
+    std::string content;
+    if (!(files ? files : &default_files)->read(filename, content)) {
+        std::cerr << "Error: Cannot open file: " << filename << std::endl;
+        return false;
+    }
+    return parse_schematic_records(content, visitor, filename);
 }
 
-void SchematicParser::parse_instance(std::istream& in) {
-    Instance inst;
-    inst.symbol_name = read_braced_string(in);
-    in >> inst.x >> inst.y >> inst.rot >> inst.flip;
-    inst.props = read_braced_string(in);
-    inst.prop_map = parse_props(inst.props);
-    inst.inst_name = get_tok_value(inst.props, "name");
-    m_sch.instances.push_back(inst);
+// ============================================================================
+// Symbol kinds
+// ============================================================================
+
+const SymbolKindTraits& symbol_kind_traits(SymbolKind kind) {
+    static const SymbolKindTraits traits[] = {
+        {true,  true,  0,   "@name @pinlist @symname"},                             // Subcircuit
+        {true,  true,  0,   "@spiceprefix@name @pinlist @model w=@w l=@l m=@m"},    // Mos
+        {true,  true,  0,   "@name @pinlist @value m=@m"},                          // Resistor
+        {true,  true,  0,   "@name @pinlist @value m=@m"},                          // Capacitor
+        {true,  true,  0,   "@name @pinlist @value"},                               // Primitive
+        {true,  false, 0,   "@value"},                                              // Code
+        {false, false, 'I', ""},                                                    // InputPin
+        {false, false, 'O', ""},                                                    // OutputPin
+        {false, false, 'B', ""},                                                    // InoutPin
+        {false, false, 0,   ""},                                                    // Label
+        {false, false, 0,   ""},                                                    // Drawing
+    };
+    return traits[static_cast<size_t>(kind)];
+}
+
+// Split a SPICE format into literal runs and @ fields
+static std::vector<FormatToken> tokenize_format(std::string_view format, const std::string& symbol_name) {
+    std::vector<FormatToken> tokens;
+    size_t pos = 0;
+    while (pos < format.size()) {
+        if (format[pos] != '@') {
+            size_t start = pos;
+            while (pos < format.size() && format[pos] != '@') pos++;
+            tokens.push_back({FormatToken::Kind::Text, std::string(format.substr(start, pos - start))});
+            continue;
+        }
+        size_t start = ++pos;
+        while (pos < format.size() &&
+               (std::isalnum(static_cast<unsigned char>(format[pos])) || format[pos] == '_' ||
+                format[pos] == '#' || format[pos] == ':')) {
+            pos++;
+        }
+        std::string_view name = format.substr(start, pos - start);
+        if (name == "name") {
+            tokens.push_back({FormatToken::Kind::Name, {}});
+        } else if (name == "pinlist") {
+            tokens.push_back({FormatToken::Kind::Pinlist, {}});
+        } else if (name == "symname") {
+            tokens.push_back({FormatToken::Kind::Symname, std::filesystem::path(symbol_name).stem().string()});
+        } else if (name == "spiceprefix" || name == "extra") {
+            tokens.push_back({FormatToken::Kind::RawProperty, std::string(name)});
+        } else {
+            tokens.push_back({FormatToken::Kind::Property, std::string(name)});
+        }
+    }
+    return tokens;
 }
 
-void SchematicParser::parse_text(std::istream& in) {
-    Text t;
-    t.text = read_braced_string(in);
-    in >> t.x >> t.y >> t.rot >> t.flip >> t.xscale >> t.yscale;
-    t.props = read_braced_string(in);
-    m_sch.texts.push_back(t);
+void classify_symbol(Symbol& sym) {
+    const std::string& type = sym.type;
+
+    if (type == "ipin") sym.kind = SymbolKind::InputPin;
+    else if (type == "opin") sym.kind = SymbolKind::OutputPin;
+    else if (type == "iopin") sym.kind = SymbolKind::InoutPin;
+    else if (type == "label" || type == "netlabel" || type == "net_name") sym.kind = SymbolKind::Label;
+    // Title blocks and ammeters are drawn, not netlisted
+    else if (type == "title" || type == "logo" || type == "graphic" || type == "current_probe")
+        sym.kind = SymbolKind::Drawing;
+    else if (type == "subcircuit") sym.kind = SymbolKind::Subcircuit;
+    else if (type == "nmos" || type == "pmos") sym.kind = SymbolKind::Mos;
+    else if (type == "resistor") sym.kind = SymbolKind::Resistor;
+    else if (type == "capacitor") sym.kind = SymbolKind::Capacitor;
+    else if (type == "netlist_commands") sym.kind = SymbolKind::Code;
+    else sym.kind = SymbolKind::Primitive;
+
+    sym.names_net = type == "label";
+    sym.format_tokens = tokenize_format(sym.format.empty() ? symbol_kind_traits(sym.kind).default_format
+                                                           : std::string_view(sym.format), sym.name);
+    for (auto& pin : sym.pins) pin.output = pin.direction == "out";
 }
 
+// ============================================================================
+// SchematicParser implementation
+// ============================================================================
+
+SchematicParser::SchematicParser() : m_files(std::make_shared<FileProvider>()) {}
+
+class SchematicParser::LoadVisitor : public SchematicVisitor {
+public:
+    explicit LoadVisitor(SchematicParser& parser) : m_parser(parser), m_sch(parser.m_sch) {}
+
+    void on_header(char tag, std::string_view props) override {
+        if (tag == 'v') {
+            m_sch.version = props;
+        } else if (tag == 'K') {
+            m_sch.K_props = props;
+        } else if (m_parser.m_options.header_blocks) {
+            if (tag == 'G') m_sch.G_props = props;
+            else if (tag == 'V') m_sch.V_props = props;
+            else if (tag == 'S') m_sch.S_props = props;
+            else m_sch.E_props = props;
+        }
+    }
+
+    void on_wire(const WireRecord& rec) override {
+        Wire w;
+        w.x1 = rec.x1;
+        w.y1 = rec.y1;
+        w.x2 = rec.x2;
+        w.y2 = rec.y2;
+        w.props = rec.props;
+        w.is_bus = (get_tok_value(w.props, "bus") == "true");
+        m_sch.wires.push_back(std::move(w));
+    }
+
+    void on_instance(const InstanceRecord& rec) override {
+        Instance inst;
+        inst.symbol_name = rec.symbol_name;
+        inst.x = rec.x;
+        inst.y = rec.y;
+        inst.rot = rec.rot;
+        inst.flip = rec.flip;
+        inst.props = rec.props;
+        inst.prop_map = parse_props(inst.props);
+        inst.inst_name = get_tok_value(inst.props, "name");
+        m_sch.instances.push_back(std::move(inst));
+
+        // An embedded symbol follows its instance and is not looked up, and
+        // neither are later placements of a symbol that is already embedded
+        // (or otherwise loaded)
+        const Instance& added = m_sch.instances.back();
+        if (!m_parser.m_prefetching) return;
+        auto embed_it = added.prop_map.find("embed");
+        stat_add(&Stats::hash_lookups);
+        if ((embed_it == added.prop_map.end() || embed_it->second != "true") &&
+            !m_sch.symbols.contains(added.symbol_name)) {
+            m_parser.prefetch_symbol(added.symbol_name);
+        }
+    }
+
+    void on_embedded_symbol(std::string_view content) override {
+        m_parser.add_embedded_symbol(content);
+    }
+
+    void on_text(const TextRecord& rec) override {
+        Text t;
+        t.text = rec.text;
+        t.x = rec.x;
+        t.y = rec.y;
+        t.rot = rec.rot;
+        t.flip = rec.flip;
+        t.xscale = rec.xscale;
+        t.yscale = rec.yscale;
+        t.props = rec.props;
+        m_sch.texts.push_back(std::move(t));
+    }
+
+    bool wants_texts() const override { return m_parser.m_options.texts; }
+
+private:
+    SchematicParser& m_parser;
+    Schematic& m_sch;
+};
+
 std::string SchematicParser::find_symbol_file(const std::string& symbol_name) const {
     namespace fs = std::filesystem;
 
     // If it's already an absolute path, use it
-    if (fs::path(symbol_name).is_absolute() && fs::exists(symbol_name)) {
+    if (fs::path(symbol_name).is_absolute() && m_files->exists(symbol_name)) {
         return symbol_name;
     }
 
     // Search in symbol paths
     for (const auto& base_path : m_symbol_paths) {
         fs::path full_path = fs::path(base_path) / symbol_name;
-        if (fs::exists(full_path)) {
+        if (m_files->exists(full_path.string())) {
             return full_path.string();
         }
         // Try with .sym extension
         if (!symbol_name.ends_with(".sym")) {
             full_path = fs::path(base_path) / (symbol_name + ".sym");
-            if (fs::exists(full_path)) {
+            if (m_files->exists(full_path.string())) {
                 return full_path.string();
             }
         }
@@ -195,7 +754,7 @@ std::string SchematicParser::find_symbol_file(const std::string& symbol_name) co
     if (!m_sch.filename.empty()) {
         fs::path sch_dir = fs::path(m_sch.filename).parent_path();
         fs::path full_path = sch_dir / symbol_name;
-        if (fs::exists(full_path)) {
+        if (m_files->exists(full_path.string())) {
             return full_path.string();
         }
     }
@@ -203,201 +762,213 @@ std::string SchematicParser::find_symbol_file(const std::string& symbol_name) co
     return "";
 }
 
-void SchematicParser::parse_symbol_pin(std::istream& in, Symbol& sym) {
-    // B 5 x1 y1 x2 y2 {name=pinname dir=in/out/inout}
-    int layer;
-    double x1, y1, x2, y2;
-    in >> layer >> x1 >> y1 >> x2 >> y2;
-    std::string props = read_braced_string(in);
+Symbol SchematicParser::placeholder_symbol(const std::string& symbol_name) {
+    // Create a placeholder symbol for built-in types
+    Symbol sym;
+    sym.name = symbol_name;
+
+    // Detect common built-in types from symbol name
+    std::string base_name = std::filesystem::path(symbol_name).stem().string();
+    std::string full_path_lower = symbol_name;
+    std::transform(full_path_lower.begin(), full_path_lower.end(),
+                  full_path_lower.begin(), ::tolower);
+
+    // Check for FET symbols (MOS transistors) - various naming conventions
+    bool is_nfet = (base_name.find("nmos") != std::string::npos ||
+                   base_name.find("nfet") != std::string::npos ||
+                   full_path_lower.find("nfet") != std::string::npos);
+    bool is_pfet = (base_name.find("pmos") != std::string::npos ||
+                   base_name.find("pfet") != std::string::npos ||
+                   full_path_lower.find("pfet") != std::string::npos);
+
+    if (is_nfet || is_pfet) {
+        sym.type = is_pfet ? "pmos" : "nmos";
+        // PDK style format: @spiceprefix@name d g s b @model L=@L W=@W ...
+        sym.format = "@spiceprefix@name @pinlist @model L=@L W=@W nf=1 ad='int((nf+1)/2) * W/nf * 0.29' as='int((nf+2)/2) * W/nf * 0.29'\n+ pd='2*int((nf+1)/2) * (W/nf + 0.29)' ps='2*int((nf+2)/2) * (W/nf + 0.29)' nrd='0.29 / W' nrs='0.29 / W' sa=0 sb=0 sd=0 mult=1 m=1";
+        // Standard 4-pin MOS: D, G, S, B
+        sym.pins = {{"D", "inout", 0, -30}, {"G", "in", -20, 0},
+                   {"S", "inout", 0, 30}, {"B", "in", 20, 0}};
+    } else if (base_name.find("res") != std::string::npos) {
+        sym.type = "resistor";
+        sym.format = "@name @pinlist @value m=@m";
+        sym.pins = {{"P", "inout", 0, -30}, {"M", "inout", 0, 30}};
+    } else if (base_name.find("cap") != std::string::npos) {
+        sym.type = "capacitor";
+        sym.format = "@name @pinlist @value m=@m";
+        sym.pins = {{"P", "inout", 0, -30}, {"M", "inout", 0, 30}};
+    } else if (base_name.find("ipin") != std::string::npos) {
+        sym.type = "ipin";
+        sym.pins = {{"p", "in", 20, 0}};
+    } else if (base_name.find("opin") != std::string::npos) {
+        sym.type = "opin";
+        sym.pins = {{"p", "out", -20, 0}};
+    } else if (base_name.find("iopin") != std::string::npos) {
+        sym.type = "iopin";
+        sym.pins = {{"p", "inout", 0, 0}};
+    } else if (base_name.find("lab_pin") != std::string::npos ||
+               base_name.find("lab_wire") != std::string::npos) {
+        sym.type = "label";
+        sym.pins = {{"p", "inout", 0, 0}};
+    } else if (base_name.find("vdd") != std::string::npos ||
+               base_name.find("gnd") != std::string::npos ||
+               base_name.find("vss") != std::string::npos) {
+        sym.type = "label";
+        sym.pins = {{"p", "inout", 0, 0}};
+    } else if (base_name.find("title") != std::string::npos) {
+        sym.type = "logo";
+    } else if (base_name.find("ammeter") != std::string::npos) {
+        sym.type = "current_probe";
+    } else {
+        // Default to subcircuit
+        sym.type = "subcircuit";
+        sym.format = "@spiceprefix@name @pinlist @symname";
+    }
+
+    return sym;
+}
+
+namespace {
+
+// Symbol type and format from K, pins from the layer 5 (PINLAYER) boxes,
+// the bounding box from pins and graphics. Texts are skipped.
+class SymbolVisitor : public SchematicVisitor {
+public:
+    explicit SymbolVisitor(Symbol& sym) : m_sym(sym) {}
+
+    void on_header(char tag, std::string_view props) override {
+        if (tag != 'K') return;
+        m_sym.props = props;
+        m_sym.type = get_tok_value(m_sym.props, "type");
+        m_sym.format = get_tok_value(m_sym.props, "format");
+        m_sym.template_str = get_tok_value(m_sym.props, "template");
+    }
 
-    // Layer 5 is PINLAYER in xschem
-    if (layer == 5) {
+    void on_box(const BoxRecord& box) override {
+        extend(box.x1, box.y1, box.x2, box.y2);
+        if (box.layer != 5) return;
+
+        std::string props(box.props);
         Pin pin;
         pin.name = get_tok_value(props, "name");
         pin.direction = get_tok_value(props, "dir");
         if (pin.direction.empty()) pin.direction = "inout";
-        pin.x = (x1 + x2) / 2.0;
-        pin.y = (y1 + y2) / 2.0;
+        pin.x = (box.x1 + box.x2) / 2.0;
+        pin.y = (box.y1 + box.y2) / 2.0;
+        m_sym.pins.push_back(pin);
+    }
 
-        // Update symbol bounding box
-        if (sym.pins.empty()) {
-            sym.minx = sym.maxx = pin.x;
-            sym.miny = sym.maxy = pin.y;
-        } else {
-            sym.minx = std::min(sym.minx, pin.x);
-            sym.maxx = std::max(sym.maxx, pin.x);
-            sym.miny = std::min(sym.miny, pin.y);
-            sym.maxy = std::max(sym.maxy, pin.y);
-        }
+    void on_shape(const ShapeRecord& shape) override {
+        extend(shape.x1, shape.y1, shape.x2, shape.y2);
+    }
+
+    bool wants_texts() const override { return false; }
+    bool wants_boxes() const override { return true; }
+    bool wants_shapes() const override { return true; }
 
-        sym.pins.push_back(pin);
+private:
+    Symbol& m_sym;
+    bool m_has_bbox = false;
+
+    void extend(double x1, double y1, double x2, double y2) {
+        if (!m_has_bbox) {
+            m_sym.minx = m_sym.maxx = x1;
+            m_sym.miny = m_sym.maxy = y1;
+            m_has_bbox = true;
+        }
+        m_sym.minx = std::min({m_sym.minx, x1, x2});
+        m_sym.maxx = std::max({m_sym.maxx, x1, x2});
+        m_sym.miny = std::min({m_sym.miny, y1, y2});
+        m_sym.maxy = std::max({m_sym.maxy, y1, y2});
     }
+};
+
+} // namespace
+
+void SchematicParser::parse_symbol(std::string_view content, Symbol& sym, const std::string& path) {
+    // A malformed record is reported; the symbol keeps what was read before it
+    SymbolVisitor visitor(sym);
+    parse_schematic_records(content, visitor, path);
 }
 
-bool SchematicParser::load_symbol(const std::string& symbol_name) {
-    // Check if already loaded
-    if (m_sch.symbols.count(symbol_name)) {
-        return true;
+bool SchematicParser::fetch_symbol(const std::string& symbol_name, Symbol& sym,
+                                   std::string& sym_path) const {
+    XSCHEM_TRACE_SCOPE("load_symbol", symbol_name);
+    {
+        StageTimer timer(Stage::SymbolLookup);
+        sym_path = find_symbol_file(symbol_name);
     }
-
-    std::string sym_path = find_symbol_file(symbol_name);
+    StageTimer timer(Stage::SymbolParse);
     if (sym_path.empty()) {
-        // Create a placeholder symbol for built-in types
-        Symbol sym;
-        sym.name = symbol_name;
-
-        // Detect common built-in types from symbol name
-        std::string base_name = std::filesystem::path(symbol_name).stem().string();
-        std::string full_path_lower = symbol_name;
-        std::transform(full_path_lower.begin(), full_path_lower.end(),
-                      full_path_lower.begin(), ::tolower);
-
-        // Check for FET symbols (MOS transistors) - various naming conventions
-        bool is_nfet = (base_name.find("nmos") != std::string::npos ||
-                       base_name.find("nfet") != std::string::npos ||
-                       full_path_lower.find("nfet") != std::string::npos);
-        bool is_pfet = (base_name.find("pmos") != std::string::npos ||
-                       base_name.find("pfet") != std::string::npos ||
-                       full_path_lower.find("pfet") != std::string::npos);
-
-        if (is_nfet || is_pfet) {
-            sym.type = is_pfet ? "pmos" : "nmos";
-            // PDK style format: @spiceprefix@name d g s b @model L=@L W=@W ...
-            sym.format = "@spiceprefix@name @pinlist @model L=@L W=@W nf=1 ad='int((nf+1)/2) * W/nf * 0.29' as='int((nf+2)/2) * W/nf * 0.29'\n+ pd='2*int((nf+1)/2) * (W/nf + 0.29)' ps='2*int((nf+2)/2) * (W/nf + 0.29)' nrd='0.29 / W' nrs='0.29 / W' sa=0 sb=0 sd=0 mult=1 m=1";
-            // Standard 4-pin MOS: D, G, S, B
-            sym.pins = {{"D", "inout", 0, -30}, {"G", "in", -20, 0},
-                       {"S", "inout", 0, 30}, {"B", "in", 20, 0}};
-        } else if (base_name.find("res") != std::string::npos) {
-            sym.type = "resistor";
-            sym.format = "@name @pinlist @value m=@m";
-            sym.pins = {{"P", "inout", 0, -30}, {"M", "inout", 0, 30}};
-        } else if (base_name.find("cap") != std::string::npos) {
-            sym.type = "capacitor";
-            sym.format = "@name @pinlist @value m=@m";
-            sym.pins = {{"P", "inout", 0, -30}, {"M", "inout", 0, 30}};
-        } else if (base_name.find("ipin") != std::string::npos) {
-            sym.type = "ipin";
-            sym.pins = {{"p", "in", 20, 0}};
-        } else if (base_name.find("opin") != std::string::npos) {
-            sym.type = "opin";
-            sym.pins = {{"p", "out", -20, 0}};
-        } else if (base_name.find("iopin") != std::string::npos) {
-            sym.type = "iopin";
-            sym.pins = {{"p", "inout", 0, 0}};
-        } else if (base_name.find("lab_pin") != std::string::npos ||
-                   base_name.find("lab_wire") != std::string::npos) {
-            sym.type = "label";
-            sym.pins = {{"p", "inout", 0, 0}};
-        } else if (base_name.find("vdd") != std::string::npos ||
-                   base_name.find("gnd") != std::string::npos ||
-                   base_name.find("vss") != std::string::npos) {
-            sym.type = "label";
-            sym.pins = {{"p", "inout", 0, 0}};
-        } else {
-            // Default to subcircuit
-            sym.type = "subcircuit";
-            sym.format = "@spiceprefix@name @pinlist @symname";
-        }
-
-        m_sch.symbols[symbol_name] = sym;
+        sym = placeholder_symbol(symbol_name);
+        classify_symbol(sym);
         return true;
     }
 
-    std::ifstream file(sym_path);
-    if (!file.is_open()) {
+    std::string content;
+    if (!m_files->read(sym_path, content)) {
+        sym_path.clear();
         return false;
     }
 
+    sym = Symbol();
+    sym.name = symbol_name;
+    parse_symbol(content, sym, sym_path);
+    classify_symbol(sym);
+    return true;
+}
+
+void SchematicParser::add_embedded_symbol(std::string_view content) {
+    if (m_sch.instances.empty()) return;
+    const std::string& symbol_name = m_sch.instances.back().symbol_name;
+    XSCHEM_TRACE_SCOPE("embedded_symbol", symbol_name);
+    StageTimer timer(Stage::SymbolParse);
     Symbol sym;
     sym.name = symbol_name;
+    parse_symbol(content, sym, m_sch.filename);
+    classify_symbol(sym);
+    m_sch.symbols[symbol_name] = std::move(sym);
+    stat_add(&Stats::hash_lookups);
+}
 
-    char tag;
-    while (file >> tag) {
-        switch (tag) {
-            case 'v': {
-                // Version line
-                std::string version = read_braced_string(file);
-                break;
-            }
-            case 'K': {
-                // Symbol properties (type, format, template)
-                std::string k_props = read_braced_string(file);
-                sym.type = get_tok_value(k_props, "type");
-                sym.format = get_tok_value(k_props, "format");
-                sym.template_str = get_tok_value(k_props, "template");
-                sym.props = k_props;
-                break;
-            }
-            case 'G':
-            case 'V':
-            case 'S':
-            case 'E':
-                read_braced_string(file);
-                break;
-            case 'B': {
-                // Box - could be a pin (layer 5)
-                parse_symbol_pin(file, sym);
-                break;
-            }
-            case 'L':
-            case 'A':
-            case 'P': {
-                // Skip graphical elements
-                std::string line;
-                std::getline(file, line);
-                // Read trailing braced string if any
-                while (file.peek() == ' ' || file.peek() == '\t') file.get();
-                if (file.peek() == '{') {
-                    read_braced_string(file);
-                }
-                break;
-            }
-            case 'T': {
-                // Text - might contain pin info
-                std::string text = read_braced_string(file);
-                double x, y;
-                int rot, flip;
-                double xscale, yscale;
-                file >> x >> y >> rot >> flip >> xscale >> yscale;
-                std::string props = read_braced_string(file);
-
-                // Check if this is a pin text (contains @#n:net_name pattern)
-                if (text.find("@#") != std::string::npos) {
-                    // Extract pin index from @#n pattern
-                    size_t pos = text.find("@#");
-                    if (pos != std::string::npos && pos + 2 < text.size()) {
-                        int pin_idx = text[pos + 2] - '0';
-                        if (pin_idx >= 0 && pin_idx <= 9) {
-                            // This gives us pin order info
-                        }
-                    }
-                }
-                break;
-            }
-            case '#':
-                // Comment
-                {
-                    std::string line;
-                    std::getline(file, line);
-                }
-                break;
-            default:
-                // Skip unknown
-                {
-                    std::string line;
-                    std::getline(file, line);
-                }
-                break;
-        }
+bool SchematicParser::load_symbol(const std::string& symbol_name) {
+    // Check if already loaded
+    stat_add(&Stats::hash_lookups);
+    if (m_sch.symbols.count(symbol_name)) {
+        return true;
     }
 
-    m_sch.symbols[symbol_name] = sym;
+    Symbol sym;
+    std::string sym_path;
+    if (!fetch_symbol(symbol_name, sym, sym_path)) {
+        return false;
+    }
+    if (!sym_path.empty()) {
+        m_sch.dependencies.push_back(sym_path);
+    }
+    m_sch.symbols[symbol_name] = std::move(sym);
     return true;
 }
 
+void SchematicParser::prefetch_symbol(const std::string& symbol_name) {
+    stat_add(&Stats::hash_lookups);
+    if (!m_prefetch_names.insert(symbol_name).second) {
+        return;
+    }
+    PrefetchSlot& slot = m_prefetch.emplace_back();
+    slot.name = symbol_name;
+    m_pool->submit([this, &slot, stats = current_stats()] {
+        StatsScope scope(stats);
+        if (!fetch_symbol(slot.name, slot.sym, slot.path)) {
+            slot.name.clear();  // Read failed, load_symbol() retries after parsing
+        }
+    }, &m_prefetch_tasks);
+}
+
 bool SchematicParser::load(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    XSCHEM_TRACE_SCOPE("load_schematic", filename);
+    std::optional<StageTimer> parse_timer(std::in_place, Stage::SchParse);
+    std::string content;
+    if (!m_files->read(filename, content)) {
         std::cerr << "Error: Cannot open file: " << filename << std::endl;
         return false;
     }
@@ -406,83 +977,55 @@ bool SchematicParser::load(const std::string& filename) {
     m_sch.wires.clear();
     m_sch.instances.clear();
     m_sch.texts.clear();
-
-    char tag;
-    while (file >> tag) {
-        switch (tag) {
-            case 'v': {
-                m_sch.version = read_braced_string(file);
-                break;
-            }
-            case 'K':
-                m_sch.K_props = read_braced_string(file);
-                break;
-            case 'G':
-                m_sch.G_props = read_braced_string(file);
-                break;
-            case 'V':
-                m_sch.V_props = read_braced_string(file);
-                break;
-            case 'S':
-                m_sch.S_props = read_braced_string(file);
-                break;
-            case 'E':
-                m_sch.E_props = read_braced_string(file);
-                break;
-            case 'N':
-                parse_wire(file);
-                break;
-            case 'C':
-                parse_instance(file);
-                break;
-            case 'T':
-                parse_text(file);
-                break;
-            case 'L':
-            case 'B':
-            case 'A':
-            case 'P': {
-                // Skip graphical elements
-                std::string line;
-                std::getline(file, line);
-                // Read trailing props if any
-                while (file.peek() == ' ' || file.peek() == '\t') file.get();
-                if (file.peek() == '{') {
-                    read_braced_string(file);
-                }
-                break;
-            }
-            case '#': {
-                // Comment line
-                std::string line;
-                std::getline(file, line);
-                break;
-            }
-            case '[': {
-                // Embedded symbol - skip for now
-                int bracket_count = 1;
-                char c;
-                while (file.get(c) && bracket_count > 0) {
-                    if (c == '[') bracket_count++;
-                    else if (c == ']') bracket_count--;
-                }
-                break;
-            }
-            default:
-                // Unknown tag, skip rest of line
-                {
-                    std::string line;
-                    std::getline(file, line);
-                }
-                break;
+    m_sch.G_props.clear();
+    m_sch.V_props.clear();
+    m_sch.S_props.clear();
+    m_sch.E_props.clear();
+    m_sch.dependencies.clear();
+    m_sch.resolved = false;
+    m_sch.net_index.clear();
+    m_sch.erc.clear();
+    m_sch.merged_wires = 0;
+
+    // Symbols are looked up and read by the pool while the rest of the
+    // file is parsed
+    if (!m_pool && m_prefetch_threads > 0) {
+        m_pool = std::make_shared<WorkerPool>(m_prefetch_threads);
+    }
+    m_prefetching = m_pool != nullptr;
+    LoadVisitor visitor(*this);
+    bool parsed = parse_schematic_records(content, visitor, filename);
+
+    parse_timer.reset();
+
+    // Merge prefetched symbols in first-seen order, so that the result does
+    // not depend on which worker finished first
+    if (m_prefetching) {
+        m_pool->wait(m_prefetch_tasks);
+        m_prefetching = false;
+        for (auto& slot : m_prefetch) {
+            // Embedded after it was prefetched for an earlier instance
+            if (slot.name.empty() || m_sch.symbols.contains(slot.name)) continue;
+            if (!slot.path.empty()) m_sch.dependencies.push_back(slot.path);
+            m_sch.symbols.emplace(slot.name, std::move(slot.sym));
         }
+        m_prefetch.clear();
+        m_prefetch_names.clear();
     }
 
-    // Load symbols for all instances
+    if (!parsed) {
+        return false;
+    }
+
+    // Load symbols for all instances (anything not prefetched)
     for (const auto& inst : m_sch.instances) {
         load_symbol(inst.symbol_name);
     }
 
+    if (m_options.merge_wires) {
+        normalize_wires(m_sch);
+    }
+
     return true;
 }
 
@@ -520,23 +1063,230 @@ static void apply_rotation(int rot, int flip, double x0, double y0,
     else               { rx = x0 + y - y0; ry = y0 - xxtmp + x0; }
 }
 
+Point transform_point(int rot, int flip, double x0, double y0, double dx, double dy) {
+    Point p;
+    apply_rotation(rot, flip, x0, y0, x0 + dx, y0 + dy, p.x, p.y);
+    return p;
+}
+
+// ============================================================================
+// Wire normalization
+// ============================================================================
+
+size_t normalize_wires(Schematic& sch) {
+    StageTimer timer(Stage::WireMerge);
+    XSCHEM_TRACE_SCOPE("wire_merge", sch.filename);
+
+    // Axis-aligned wires on a 0.01 grid, the resolution of Point. Wires
+    // only merge with wires of the same class (bus flag and properties).
+    struct Segment {
+        uint32_t axis;          // 0: horizontal, 1: vertical
+        uint32_t cls;
+        long long line;         // y or x
+        long long lo, hi;       // Along the line, lo < hi
+        uint32_t wire;
+    };
+    auto grid = [](double v) { return std::llround(v * 100); };
+    std::unordered_map<std::string_view, uint32_t> classes[2];
+    std::vector<Segment> segments;
+    segments.reserve(sch.wires.size());
+    for (size_t i = 0; i < sch.wires.size(); i++) {
+        const Wire& w = sch.wires[i];
+        long long x1 = grid(w.x1), y1 = grid(w.y1), x2 = grid(w.x2), y2 = grid(w.y2);
+        uint32_t axis;
+        if (y1 == y2 && x1 != x2) axis = 0;
+        else if (x1 == x2 && y1 != y2) axis = 1;
+        else continue;
+        auto& by_props = classes[w.is_bus];
+        uint32_t cls = by_props.try_emplace(w.props, static_cast<uint32_t>(2 * by_props.size() + w.is_bus)).first->second;
+        segments.push_back({axis, cls, axis ? x1 : y1, axis ? std::min(y1, y2) : std::min(x1, x2),
+                            axis ? std::max(y1, y2) : std::max(x1, x2), static_cast<uint32_t>(i)});
+    }
+    stat_add(&Stats::hash_lookups, segments.size());
+    std::sort(segments.begin(), segments.end(), [](const Segment& a, const Segment& b) {
+        return std::tie(a.axis, a.line, a.cls, a.lo, a.hi, a.wire) < std::tie(b.axis, b.line, b.cls, b.lo, b.hi, b.wire);
+    });
+
+    // Runs: wires of one class that overlap or touch along a line
+    struct Run {
+        size_t first, last;
+        bool overlap;
+    };
+    std::vector<Run> runs;
+    for (size_t i = 0; i < segments.size();) {
+        const Segment& first = segments[i];
+        long long hi = first.hi;
+        bool overlap = false;
+        size_t j = i + 1;
+        for (; j < segments.size(); j++) {
+            const Segment& s = segments[j];
+            if (s.axis != first.axis || s.line != first.line || s.cls != first.cls || s.lo > hi) break;
+            overlap = overlap || s.lo < hi;
+            hi = std::max(hi, s.hi);
+        }
+        if (j - i > 1) runs.push_back({i, j, overlap});
+        i = j;
+    }
+    if (runs.empty()) return 0;
+
+    // What else meets the ends of those wires: wire ends and instance pins
+    struct Attached {
+        uint32_t wire_ends = 0;
+        bool pin = false;
+    };
+    std::unordered_map<Point, Attached, PointHash> attached;
+    attached.reserve(2 * (segments.size() - runs.size()));
+    for (const Run& run : runs) {
+        for (size_t k = run.first; k < run.last; k++) {
+            const Wire& w = sch.wires[segments[k].wire];
+            attached.try_emplace({w.x1, w.y1});
+            attached.try_emplace({w.x2, w.y2});
+        }
+    }
+    for (const Wire& w : sch.wires) {
+        for (Point p : {Point{w.x1, w.y1}, Point{w.x2, w.y2}}) {
+            auto it = attached.find(p);
+            if (it != attached.end()) it->second.wire_ends++;
+        }
+    }
+    for (const Instance& inst : sch.instances) {
+        auto sym_it = sch.symbols.find(inst.symbol_name);
+        if (sym_it == sch.symbols.end()) continue;
+        for (const Pin& pin : sym_it->second.pins) {
+            auto it = attached.find(instance_point(inst, pin.x, pin.y));
+            if (it != attached.end()) it->second.pin = true;
+        }
+    }
+    stat_add(&Stats::hash_lookups, attached.size() + 2 * sch.wires.size() + sch.instances.size());
+
+    // Each run becomes the pieces between its outer ends and every inner
+    // wire end that anything besides the run's own wires meets. The pieces
+    // replace the run's first wire in file order.
+    std::vector<std::vector<Wire>> pieces(sch.wires.size());
+    std::vector<bool> dropped(sch.wires.size(), false);
+    std::vector<std::pair<long long, Point>> ends;
+    std::vector<Point> cuts;
+    bool changed = false;
+    for (const Run& run : runs) {
+        ends.clear();
+        for (size_t k = run.first; k < run.last; k++) {
+            const Segment& s = segments[k];
+            const Wire& w = sch.wires[s.wire];
+            Point p1{w.x1, w.y1}, p2{w.x2, w.y2};
+            bool forward = (s.axis ? grid(w.y1) : grid(w.x1)) == s.lo;
+            ends.emplace_back(s.lo, forward ? p1 : p2);
+            ends.emplace_back(s.hi, forward ? p2 : p1);
+        }
+        std::sort(ends.begin(), ends.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        cuts.assign(1, ends.front().second);
+        for (size_t k = 0, l; k < ends.size(); k = l) {
+            for (l = k + 1; l < ends.size() && ends[l].first == ends[k].first; l++) {}
+            if (k == 0 || l == ends.size()) continue;
+            const Attached& at = attached.find(ends[k].second)->second;
+            if (at.pin || at.wire_ends > l - k) cuts.push_back(ends[k].second);
+        }
+        cuts.push_back(ends.back().second);
+        stat_add(&Stats::hash_lookups, ends.size());
+        if (!run.overlap && cuts.size() - 1 == run.last - run.first) continue;   // The same wires
+
+        uint32_t head = segments[run.first].wire;
+        for (size_t k = run.first; k < run.last; k++) {
+            head = std::min(head, segments[k].wire);
+            dropped[segments[k].wire] = true;
+        }
+        const Wire& model = sch.wires[head];
+        for (size_t k = 0; k + 1 < cuts.size(); k++) {
+            Wire w;
+            w.x1 = cuts[k].x;
+            w.y1 = cuts[k].y;
+            w.x2 = cuts[k + 1].x;
+            w.y2 = cuts[k + 1].y;
+            w.props = model.props;
+            w.is_bus = model.is_bus;
+            pieces[head].push_back(std::move(w));
+        }
+        changed = true;
+    }
+    if (!changed) return 0;
+
+    std::vector<Wire> wires;
+    wires.reserve(sch.wires.size());
+    for (size_t i = 0; i < sch.wires.size(); i++) {
+        if (!dropped[i]) {
+            wires.push_back(std::move(sch.wires[i]));
+        } else {
+            for (auto& w : pieces[i]) wires.push_back(std::move(w));
+        }
+    }
+
+    // Overlapping wires cut where something meets them can come out as
+    // more pieces than they were
+    size_t removed = sch.wires.size() > wires.size() ? sch.wires.size() - wires.size() : 0;
+    sch.wires = std::move(wires);
+    sch.merged_wires += removed;
+    return removed;
+}
+
+const char* erc_kind_name(ErcViolation::Kind kind) {
+    switch (kind) {
+        case ErcViolation::Kind::FloatingPin:    return "floating pin";
+        case ErcViolation::Kind::ShortedLabels:  return "shorted labels";
+        case ErcViolation::Kind::DanglingWire:   return "dangling wire";
+        case ErcViolation::Kind::DuplicateName:  return "duplicate name";
+        case ErcViolation::Kind::OutputConflict: return "output conflict";
+    }
+    return "";
+}
+
+// Instances whose output pins drive their net: not labels or ports
+static bool is_driver(const Symbol& sym) {
+    return !sym.names_net && !symbol_kind_traits(sym.kind).port_dir;
+}
+
+void NetResolver::report(ErcViolation::Kind kind, const Point& at, std::string message) {
+    m_sch.erc.push_back({kind, at, std::move(message)});
+}
+
+uint32_t NetResolver::point_id(const Point& p) {
+    auto [it, added] = m_point_ids.try_emplace(p, static_cast<uint32_t>(m_points.size()));
+    m_hash_lookups++;
+    if (added) m_points.push_back({p, {}, {}});
+    return it->second;
+}
+
 void NetResolver::collect_connection_points() {
+    StageTimer timer(Stage::Connectivity);
+    XSCHEM_TRACE_SCOPE("connectivity");
+
     // Collect wire endpoints
+    m_wire_points.resize(m_sch.wires.size() * 2);
     for (size_t i = 0; i < m_sch.wires.size(); i++) {
         const auto& w = m_sch.wires[i];
-        Point p1{w.x1, w.y1};
-        Point p2{w.x2, w.y2};
-        m_wire_endpoints[p1].push_back(static_cast<int>(i));
-        m_wire_endpoints[p2].push_back(static_cast<int>(i));
+        for (int end = 0; end < 2; end++) {
+            uint32_t id = point_id(end ? Point{w.x2, w.y2} : Point{w.x1, w.y1});
+            m_points[id].wires.push_back(static_cast<int>(i));
+            m_wire_points[i * 2 + end] = id;
+        }
     }
 
-    // Collect instance pin locations
+    // Collect instance pin locations, symbols and label names
+    m_symbols.assign(m_sch.instances.size(), nullptr);
+    m_labels.assign(m_sch.instances.size(), std::string());
+    m_pin_first.assign(m_sch.instances.size() + 1, 0);
+    std::unordered_set<std::string_view> names;
     for (size_t i = 0; i < m_sch.instances.size(); i++) {
         const auto& inst = m_sch.instances[i];
+        m_pin_first[i] = static_cast<uint32_t>(m_pin_points.size());
+        if (!inst.inst_name.empty() && !names.insert(inst.inst_name).second) {
+            report(ErcViolation::Kind::DuplicateName, {inst.x, inst.y}, inst.inst_name);
+        }
         auto sym_it = m_sch.symbols.find(inst.symbol_name);
+        m_hash_lookups += 2;
         if (sym_it == m_sch.symbols.end()) continue;
 
         const auto& sym = sym_it->second;
+        m_symbols[i] = &sym;
+        if (!is_driver(sym)) m_labels[i] = get_tok_value(inst.props, "lab");
         for (size_t p = 0; p < sym.pins.size(); p++) {
             const auto& pin = sym.pins[p];
 
@@ -547,58 +1297,34 @@ void NetResolver::collect_connection_points() {
             apply_rotation(inst.rot, inst.flip, inst.x, inst.y,
                           inst.x + pin.x, inst.y + pin.y, rx, ry);
 
-            Point pt{rx, ry};
-            m_inst_pins[pt].push_back({static_cast<int>(i), static_cast<int>(p)});
+            uint32_t id = point_id({rx, ry});
+            m_points[id].pins.push_back({static_cast<int>(i), static_cast<int>(p)});
+            m_pin_points.push_back(id);
         }
     }
+    m_pin_first.back() = static_cast<uint32_t>(m_pin_points.size());
 }
 
-std::string NetResolver::get_label_at(const Point& p) {
-    // Check for label instances at this point
-    for (size_t i = 0; i < m_sch.instances.size(); i++) {
-        const auto& inst = m_sch.instances[i];
-        auto sym_it = m_sch.symbols.find(inst.symbol_name);
-        if (sym_it == m_sch.symbols.end()) continue;
-
-        const auto& sym = sym_it->second;
-
-        // Check if this is a label-type symbol
-        bool is_label = (sym.type == "label" ||
-                        inst.symbol_name.find("lab_pin") != std::string::npos ||
-                        inst.symbol_name.find("lab_wire") != std::string::npos ||
-                        inst.symbol_name.find("vdd") != std::string::npos ||
-                        inst.symbol_name.find("gnd") != std::string::npos ||
-                        inst.symbol_name.find("vss") != std::string::npos);
-
-        if (!is_label) continue;
-
-        // Check if instance pin is at this point
-        for (const auto& pin : sym.pins) {
-            // Transform pin position using xschem-compatible rotation
-            double px, py;
-            apply_rotation(inst.rot, inst.flip, inst.x, inst.y,
-                          inst.x + pin.x, inst.y + pin.y, px, py);
-
-            if (std::abs(px - p.x) < 0.01 && std::abs(py - p.y) < 0.01) {
-                std::string label = get_tok_value(inst.props, "lab");
-                if (!label.empty()) return label;
-            }
-        }
+std::string NetResolver::get_label_at(uint32_t point) {
+    // Label instances with a pin at this point, first in instance order
+    const ConnectionPoint& cp = m_points[point];
+    for (const auto& [inst, pin] : cp.pins) {
+        if (m_symbols[inst]->names_net && !m_labels[inst].empty()) return m_labels[inst];
     }
 
-    // Check for wire labels
-    for (const auto& w : m_sch.wires) {
-        if ((std::abs(w.x1 - p.x) < 0.01 && std::abs(w.y1 - p.y) < 0.01) ||
-            (std::abs(w.x2 - p.x) < 0.01 && std::abs(w.y2 - p.y) < 0.01)) {
-            std::string label = get_tok_value(w.props, "lab");
-            if (!label.empty()) return label;
-        }
+    // Then wire labels, first in wire order
+    for (int w : cp.wires) {
+        std::string label = get_tok_value(m_sch.wires[w].props, "lab");
+        if (!label.empty()) return label;
     }
 
     return "";
 }
 
-void NetResolver::assign_net_names() {
+void NetResolver::unite_wires() {
+    StageTimer timer(Stage::UnionFind);
+    XSCHEM_TRACE_SCOPE("union_find");
+
     // Initialize union-find
     size_t total_wires = m_sch.wires.size();
     m_parent.resize(total_wires);
@@ -606,30 +1332,30 @@ void NetResolver::assign_net_names() {
         m_parent[i] = static_cast<int>(i);
     }
 
-    // Unite wires that share endpoints
-    for (const auto& [point, wire_indices] : m_wire_endpoints) {
-        if (wire_indices.size() > 1) {
-            for (size_t i = 1; i < wire_indices.size(); i++) {
-                unite(wire_indices[0], wire_indices[i]);
-            }
+    // Unite wires that share endpoints, pins or not
+    for (const auto& cp : m_points) {
+        for (size_t i = 1; i < cp.wires.size(); i++) {
+            unite(cp.wires[0], cp.wires[i]);
         }
     }
+}
 
-    // Collect all connection points (wires + instance pins)
-    // and unite wires that connect through instance pins or labels
-    for (const auto& [point, inst_pin_list] : m_inst_pins) {
-        auto wire_it = m_wire_endpoints.find(point);
-        if (wire_it != m_wire_endpoints.end() && !wire_it->second.empty()) {
-            // Unite all wires at this point
-            for (size_t i = 1; i < wire_it->second.size(); i++) {
-                unite(wire_it->second[0], wire_it->second[i]);
-            }
-        }
-    }
+void NetResolver::assign_net_names() {
+    StageTimer timer(Stage::Naming);
+    XSCHEM_TRACE_SCOPE("naming");
 
     // Assign names to wire groups
     std::unordered_map<int, std::string> group_names;
 
+    // Every label of each group of connected wires and pins: groups are
+    // the union-find roots, then one per point that has no wire
+    struct GroupLabel {
+        size_t group;
+        std::string label;
+        Point at;
+    };
+    std::vector<GroupLabel> labels;
+
     // First pass: collect explicit labels
     for (size_t i = 0; i < m_sch.wires.size(); i++) {
         const auto& w = m_sch.wires[i];
@@ -639,17 +1365,17 @@ void NetResolver::assign_net_names() {
         std::string label = get_tok_value(w.props, "lab");
         if (!label.empty()) {
             group_names[group] = label;
+            labels.push_back({static_cast<size_t>(group), label, {w.x1, w.y1}});
         }
 
         // Check labels at endpoints
+        m_hash_lookups++;
         if (group_names.find(group) == group_names.end()) {
-            Point p1{w.x1, w.y1};
-            Point p2{w.x2, w.y2};
-            label = get_label_at(p1);
+            label = get_label_at(m_wire_points[i * 2]);
             if (!label.empty()) {
                 group_names[group] = label;
             } else {
-                label = get_label_at(p2);
+                label = get_label_at(m_wire_points[i * 2 + 1]);
                 if (!label.empty()) {
                     group_names[group] = label;
                 }
@@ -661,6 +1387,7 @@ void NetResolver::assign_net_names() {
     for (size_t i = 0; i < m_sch.wires.size(); i++) {
         int group = find(static_cast<int>(i));
         auto name_it = group_names.find(group);
+        m_hash_lookups++;
         if (name_it != group_names.end()) {
             m_sch.wires[i].node = name_it->second;
         } else {
@@ -671,38 +1398,59 @@ void NetResolver::assign_net_names() {
         }
     }
 
-    // Create map for pin-to-pin connections (pins at same location share a net)
-    // Key: point location, Value: assigned net name
-    std::unordered_map<Point, std::string, PointHash> point_net_names;
-
-    // First, assign net names to points that have wires
-    for (const auto& [point, wire_indices] : m_wire_endpoints) {
-        if (!wire_indices.empty()) {
-            point_net_names[point] = m_sch.wires[wire_indices[0]].node;
-        }
-    }
-
-    // Then, assign net names to points that only have pin-to-pin connections
-    // (multiple pins at same location without any wire)
-    for (const auto& [point, inst_pin_list] : m_inst_pins) {
-        if (point_net_names.find(point) == point_net_names.end()) {
+    // Net name of each point (pins at same location share a net). Points
+    // with wires take the wires' net; points with pins only take a label
+    // there or, for several pins, the next unnamed net in point order.
+    std::vector<std::string> point_nets(m_points.size());
+    size_t bare_group = m_sch.wires.size();
+    for (size_t id = 0; id < m_points.size(); id++) {
+        const ConnectionPoint& cp = m_points[id];
+        size_t group;
+        if (!cp.wires.empty()) {
+            point_nets[id] = m_sch.wires[cp.wires[0]].node;
+            if (cp.wires.size() == 1 && cp.pins.empty()) {
+                report(ErcViolation::Kind::DanglingWire, cp.at, point_nets[id]);
+            }
+            group = find(cp.wires[0]);
+        } else {
             // Check for label at this point first
-            std::string label = get_label_at(point);
+            std::string label = get_label_at(static_cast<uint32_t>(id));
             if (!label.empty()) {
-                point_net_names[point] = label;
-            } else if (inst_pin_list.size() > 1) {
+                point_nets[id] = std::move(label);
+            } else if (cp.pins.size() > 1) {
                 // Multiple pins at same point without wire - create a shared net
-                std::string net_name = "net" + std::to_string(m_sch.unnamed_net_count++);
-                point_net_names[point] = net_name;
+                point_nets[id] = "net" + std::to_string(m_sch.unnamed_net_count++);
             }
             // If only one pin at this point and no wire/label, leave unassigned
             // (will be marked NC later)
+            group = bare_group++;
+        }
+        for (const auto& [inst, pin] : cp.pins) {
+            if (!m_labels[inst].empty()) labels.push_back({group, m_labels[inst], cp.at});
         }
     }
 
-    // Assign nets to instance pins
-    for (auto& inst : m_sch.instances) {
+    // A group with more than one label name shorts those nets
+    std::sort(labels.begin(), labels.end(), [](const GroupLabel& a, const GroupLabel& b) {
+        return std::tie(a.group, a.label, a.at.y, a.at.x) < std::tie(b.group, b.label, b.at.y, b.at.x);
+    });
+    for (size_t i = 0, j; i < labels.size(); i = j) {
+        std::string names = labels[i].label;
+        const Point* at = nullptr;
+        for (j = i + 1; j < labels.size() && labels[j].group == labels[i].group; j++) {
+            if (labels[j].label == labels[j - 1].label) continue;
+            names += ", " + labels[j].label;
+            if (!at) at = &labels[j].at;
+        }
+        if (at) report(ErcViolation::Kind::ShortedLabels, *at, names);
+    }
+
+    // Assign nets to instance pins. The first output pin on a net drives it.
+    std::unordered_map<std::string_view, std::pair<size_t, size_t>> drivers;
+    for (size_t i = 0; i < m_sch.instances.size(); i++) {
+        auto& inst = m_sch.instances[i];
         auto sym_it = m_sch.symbols.find(inst.symbol_name);
+        m_hash_lookups++;
         if (sym_it == m_sch.symbols.end()) continue;
 
         const auto& sym = sym_it->second;
@@ -710,53 +1458,272 @@ void NetResolver::assign_net_names() {
 
         for (size_t p = 0; p < sym.pins.size(); p++) {
             const auto& pin = sym.pins[p];
+            uint32_t point = m_pin_points[m_pin_first[i] + p];
+            const Point& pt = m_points[point].at;
 
-            // Transform pin position using xschem-compatible rotation
-            double px, py;
-            apply_rotation(inst.rot, inst.flip, inst.x, inst.y,
-                          inst.x + pin.x, inst.y + pin.y, px, py);
+            if (!point_nets[point].empty()) {
+                inst.connected_nets[p] = point_nets[point];
+            } else {
+                // Unconnected pin - create unique net
+                inst.connected_nets[p] = "NC_" + inst.inst_name + "_" + pin.name;
+                report(ErcViolation::Kind::FloatingPin, pt, inst.inst_name + " pin " + pin.name);
+                continue;
+            }
 
-            Point pt{px, py};
+            if (pin.output && is_driver(sym)) {
+                auto [it, first] = drivers.try_emplace(inst.connected_nets[p], i, p);
+                m_hash_lookups++;
+                if (!first) {
+                    const auto& [other, other_pin] = it->second;
+                    const Instance& driver = m_sch.instances[other];
+                    report(ErcViolation::Kind::OutputConflict, pt,
+                           inst.connected_nets[p] + ": " +
+                           driver.inst_name + " pin " + m_sch.symbols.at(driver.symbol_name).pins[other_pin].name + ", " +
+                           inst.inst_name + " pin " + pin.name);
+                }
+            }
+        }
+    }
+}
+
+void NetResolver::resolve() {
+    XSCHEM_TRACE_SCOPE("resolve", m_sch.filename);
+    m_hash_lookups = 0;
+    m_sch.erc.clear();
+    collect_connection_points();
+    unite_wires();
+    assign_net_names();
+    std::sort(m_sch.erc.begin(), m_sch.erc.end(), [](const ErcViolation& a, const ErcViolation& b) {
+        return std::tie(a.kind, a.at.y, a.at.x, a.message) < std::tie(b.kind, b.at.y, b.at.x, b.message);
+    });
+    m_sch.net_index.build(m_sch);
+    m_sch.resolved = true;
+    stat_add(&Stats::hash_lookups, m_hash_lookups);
+}
+
+// ============================================================================
+// NetIndex implementation
+// ============================================================================
+
+namespace {
+
+// '*' matches any run of characters, '?' any one character
+bool glob_match(std::string_view pattern, std::string_view name) {
+    size_t p = 0, n = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            p++;
+            n++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = n;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            n = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') p++;
+    return p == pattern.size();
+}
+
+} // namespace
+
+void NetIndex::clear() {
+    m_names.clear();
+    m_sorted.clear();
+    m_pin_first.clear();
+    m_pins.clear();
+    m_wire_first.clear();
+    m_wires.clear();
+    m_inst_first.clear();
+    m_inst_nets.clear();
+    m_fanout.clear();
+}
+
+void NetIndex::build(const Schematic& sch) {
+    StageTimer timer(Stage::NetIndex);
+    XSCHEM_TRACE_SCOPE("net_index", sch.filename);
+    clear();
+
+    // Net ids; the map holds views into the schematic's own strings
+    std::unordered_map<std::string_view, uint32_t> ids;
+    auto intern = [&](const std::string& name) {
+        if (name.empty()) return npos;
+        auto [it, inserted] = ids.try_emplace(name, static_cast<uint32_t>(m_names.size()));
+        if (inserted) m_names.push_back(name);
+        return it->second;
+    };
+
+    std::vector<uint32_t> wire_nets(sch.wires.size());
+    for (size_t i = 0; i < sch.wires.size(); i++) wire_nets[i] = intern(sch.wires[i].node);
+
+    m_inst_first.reserve(sch.instances.size() + 1);
+    m_inst_first.push_back(0);
+    for (const auto& inst : sch.instances) {
+        for (const auto& net : inst.connected_nets) m_inst_nets.push_back(intern(net));
+        m_inst_first.push_back(static_cast<uint32_t>(m_inst_nets.size()));
+    }
+    stat_add(&Stats::hash_lookups, sch.wires.size() + m_inst_nets.size() + sch.instances.size());
+
+    // Counting pass, then fill: entries come out in instance/wire order
+    const size_t nets = m_names.size();
+    m_wire_first.assign(nets + 1, 0);
+    m_pin_first.assign(nets + 1, 0);
+    m_fanout.assign(nets, 0);
+    for (uint32_t net : wire_nets) {
+        if (net != npos) m_wire_first[net + 1]++;
+    }
+    for (uint32_t net : m_inst_nets) {
+        if (net != npos) m_pin_first[net + 1]++;
+    }
+    for (size_t n = 0; n < nets; n++) {
+        m_wire_first[n + 1] += m_wire_first[n];
+        m_pin_first[n + 1] += m_pin_first[n];
+    }
+
+    m_wires.resize(m_wire_first[nets]);
+    std::vector<uint32_t> fill(m_wire_first.begin(), m_wire_first.end() - 1);
+    for (size_t i = 0; i < wire_nets.size(); i++) {
+        if (wire_nets[i] != npos) m_wires[fill[wire_nets[i]]++] = static_cast<uint32_t>(i);
+    }
+
+    m_pins.resize(m_pin_first[nets]);
+    fill.assign(m_pin_first.begin(), m_pin_first.end() - 1);
+    for (size_t i = 0; i < sch.instances.size(); i++) {
+        auto sym_it = sch.symbols.find(sch.instances[i].symbol_name);
+        const Symbol* sym = sym_it == sch.symbols.end() ? nullptr : &sym_it->second;
+        for (uint32_t p = 0; p < m_inst_first[i + 1] - m_inst_first[i]; p++) {
+            uint32_t net = m_inst_nets[m_inst_first[i] + p];
+            if (net == npos) continue;
+            m_pins[fill[net]++] = {static_cast<uint32_t>(i), p};
+            if (!sym || p >= sym->pins.size() || !sym->pins[p].output) m_fanout[net]++;
+        }
+    }
+    stat_add(&Stats::hash_lookups, sch.instances.size());
+
+    m_sorted.resize(nets);
+    for (uint32_t n = 0; n < nets; n++) m_sorted[n] = n;
+    std::sort(m_sorted.begin(), m_sorted.end(),
+              [this](uint32_t a, uint32_t b) { return m_names[a] < m_names[b]; });
+}
+
+uint32_t NetIndex::find(std::string_view name) const {
+    auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), name,
+                               [this](uint32_t id, std::string_view key) { return m_names[id] < key; });
+    return it != m_sorted.end() && m_names[*it] == name ? *it : npos;
+}
+
+std::vector<uint32_t> NetIndex::match(std::string_view pattern) const {
+    std::vector<uint32_t> result;
+    const size_t wildcard = pattern.find_first_of("*?");
+    if (wildcard == std::string_view::npos) {
+        uint32_t id = find(pattern);
+        if (id != npos) result.push_back(id);
+        return result;
+    }
+
+    // Only names with the literal prefix of the pattern can match
+    const std::string_view prefix = pattern.substr(0, wildcard);
+    auto it = std::lower_bound(m_sorted.begin(), m_sorted.end(), prefix,
+                               [this](uint32_t id, std::string_view key) { return m_names[id] < key; });
+    for (; it != m_sorted.end() && std::string_view(m_names[*it]).starts_with(prefix); ++it) {
+        if (glob_match(pattern.substr(wildcard), std::string_view(m_names[*it]).substr(prefix.size()))) {
+            result.push_back(*it);
+        }
+    }
+    return result;
+}
+
+// ============================================================================
+// NetTable implementation
+// ============================================================================
+
+NetTable::NetTable(const Schematic& sch) {
+    XSCHEM_TRACE_SCOPE("net_table", sch.filename);
+    const size_t count = sch.instances.size();
+    m_symbols.resize(count, nullptr);
+    m_elements.resize(count, false);
+    m_copies.resize(count, 1);
+    m_pin_first.reserve(count + 1);
+    m_pin_first.push_back(0);
+    m_net_first.push_back(0);
+
+    std::unordered_map<std::string, uint32_t> ids;
+    std::string bit_name;
+    auto intern = [&](const std::string& name) {
+        auto [it, inserted] = ids.try_emplace(name, static_cast<uint32_t>(m_nets.size()));
+        if (inserted) m_nets.push_back(name);
+        return it->second;
+    };
+    stat_add(&Stats::hash_lookups, count);
+
+    for (size_t i = 0; i < count; i++) {
+        const Instance& inst = sch.instances[i];
+        auto sym_it = sch.symbols.find(inst.symbol_name);
+        const Symbol* sym = sym_it == sch.symbols.end() ? nullptr : &sym_it->second;
+        m_symbols[i] = sym;
+
+        const SymbolKindTraits& traits = symbol_kind_traits(sym ? sym->kind : SymbolKind::Drawing);
+        if (char dir = traits.port_dir) {
+            std::string lab = get_tok_value(inst.props, "lab");
+            BusName bits(lab);
+            for (size_t b = 0; !lab.empty() && b < bits.width(); b++) {
+                std::string name = bits.bit(b);
+                uint32_t net = intern(name);
+                m_ports.push_back({std::move(name), dir, net});
+            }
+        }
 
-            // Check if this point has an assigned net name
-            auto net_it = point_net_names.find(pt);
-            if (net_it != point_net_names.end()) {
-                inst.connected_nets[p] = net_it->second;
-            } else {
-                // Check if there's a label at this point
-                std::string label = get_label_at(pt);
-                if (!label.empty()) {
-                    inst.connected_nets[p] = label;
-                } else {
-                    // Unconnected pin - create unique net
-                    inst.connected_nets[p] = "NC_" + inst.inst_name + "_" + pin.name;
-                }
+        m_elements[i] = traits.element;
+        m_copies[i] = static_cast<uint32_t>(BusName(inst.inst_name).width());
+
+        // Only elements have pins: nets seen only on labels and pins are
+        // not part of any netlist
+        for (size_t p = 0; m_elements[i] && p < inst.connected_nets.size(); p++) {
+            size_t width = sym && p < sym->pins.size() ? BusName(sym->pins[p].name).width() : 1;
+            m_pin_width.push_back(static_cast<uint32_t>(width));
+            BusName net(inst.connected_nets[p]);
+            for (size_t b = 0; b < net.width(); b++) {
+                bit_name.clear();
+                net.append_bit(bit_name, b);
+                m_pin_nets.push_back(intern(bit_name));
             }
+            m_net_first.push_back(static_cast<uint32_t>(m_pin_nets.size()));
         }
+        m_pin_first.push_back(static_cast<uint32_t>(m_pin_width.size()));
     }
-}
-
-void NetResolver::resolve() {
-    collect_connection_points();
-    assign_net_names();
+    stat_add(&Stats::hash_lookups, m_pin_nets.size() + m_ports.size());
 }
 
 // ============================================================================
 // SpiceNetlister implementation
 // ============================================================================
 
-bool SpiceNetlister::is_pin_symbol(const std::string& type) const {
-    return type == "ipin" || type == "opin" || type == "iopin";
-}
-
-bool SpiceNetlister::is_label_symbol(const std::string& type) const {
-    return type == "label" || type == "netlabel" || type == "net_name";
+void SpiceNetlister::prepare() {
+    if (!m_sch.resolved) {
+        NetResolver resolver(m_sch);
+        resolver.resolve();
+    }
+    if (!m_nets) {
+        m_own_nets = std::make_unique<NetTable>(m_sch);
+        m_nets = m_own_nets.get();
+    }
 }
 
-std::string SpiceNetlister::translate_prop(const Instance& inst, const std::string& prop_name) {
+std::string SpiceNetlister::translate_prop(const Instance& inst, const std::string& prop_name,
+                                           const PropOverrides* overrides) const {
     // Handle @prop syntax
     if (prop_name.empty()) return "";
 
+    // Sweep overrides take precedence over the instance's own properties
+    if (overrides) {
+        auto ov = overrides->find(prop_name);
+        if (ov != overrides->end()) return ov->second;
+    }
+
     auto it = inst.prop_map.find(prop_name);
     if (it != inst.prop_map.end()) {
         return it->second;
@@ -772,67 +1739,49 @@ std::string SpiceNetlister::translate_prop(const Instance& inst, const std::stri
     return "";
 }
 
-std::string SpiceNetlister::expand_format(const Instance& inst, const Symbol& sym) {
-    std::string format = sym.format;
-    if (format.empty()) {
-        // Default format for different types
-        if (sym.type == "subcircuit") {
-            format = "@name @pinlist @symname";
-        } else if (sym.type == "nmos" || sym.type == "pmos") {
-            format = "@spiceprefix@name @pinlist @model w=@w l=@l m=@m";
-        } else if (sym.type == "resistor") {
-            format = "@name @pinlist @value m=@m";
-        } else if (sym.type == "capacitor") {
-            format = "@name @pinlist @value m=@m";
-        } else {
-            format = "@name @pinlist @value";
-        }
-    }
+std::string SpiceNetlister::expand_format(size_t index, const Symbol& sym, size_t bit,
+                                          const PropOverrides* overrides, bool mark_pins) const {
+    const Instance& inst = m_sch.instances[index];
 
     std::string result;
-    size_t pos = 0;
-
-    while (pos < format.size()) {
-        if (format[pos] == '@') {
-            // Property substitution
-            pos++;
-            size_t start = pos;
-            while (pos < format.size() &&
-                   (std::isalnum(format[pos]) || format[pos] == '_' || format[pos] == '#' || format[pos] == ':')) {
-                pos++;
-            }
-            std::string prop_name = format.substr(start, pos - start);
-
-            if (prop_name == "name") {
-                result += inst.inst_name;
-            } else if (prop_name == "pinlist") {
-                // Output connected nets in pin order
-                for (size_t i = 0; i < inst.connected_nets.size(); i++) {
-                    if (i > 0) result += " ";
-                    result += inst.connected_nets[i];
+    for (const FormatToken& token : sym.format_tokens) {
+        switch (token.kind) {
+            case FormatToken::Kind::Text:
+            case FormatToken::Kind::Symname:
+                result += token.text;
+                break;
+            case FormatToken::Kind::Name:
+                BusName(inst.inst_name).append_bit(result, bit);
+                break;
+            case FormatToken::Kind::Pinlist:
+                if (mark_pins) {
+                    result += pin_marker;
+                    break;
                 }
-            } else if (prop_name == "symname") {
-                // Extract symbol name without path and extension
-                std::string sym_name = std::filesystem::path(sym.name).stem().string();
-                result += sym_name;
-            } else if (prop_name == "spiceprefix") {
-                // Spice prefix - usually empty for most elements
-                std::string val = translate_prop(inst, "spiceprefix");
-                result += val;  // May be empty, that's OK
-            } else if (prop_name == "extra") {
-                // Extra parameters - skip if empty
-                std::string val = translate_prop(inst, "extra");
-                if (!val.empty()) {
-                    result += val;
+                // Output connected nets in pin order, one per pin bit
+                for (size_t i = 0; i < m_nets->pin_count(index); i++) {
+                    size_t pin_width = m_nets->pin_width(index, i);
+                    for (size_t b = 0; b < pin_width; b++) {
+                        if (i > 0 || b > 0) result += " ";
+                        result += m_nets->net(m_nets->pin_net(index, i, bit, b));
+                    }
                 }
-            } else {
-                std::string val = translate_prop(inst, prop_name);
-                if (!val.empty()) {
+                break;
+            case FormatToken::Kind::RawProperty:
+                // Spice prefix and extra parameters - may be empty
+                result += translate_prop(inst, token.text, overrides);
+                break;
+            case FormatToken::Kind::Property: {
+                std::string val = translate_prop(inst, token.text, overrides);
+                double number;
+                if (m_evaluate && !val.empty() && !parse_spice_number(val, number) &&
+                    evaluate_expression(val, inst, overrides, nullptr, 0, number)) {
+                    result += format_spice_number(number);
+                } else {
                     result += val;
                 }
+                break;
             }
-        } else {
-            result += format[pos++];
         }
     }
 
@@ -851,14 +1800,89 @@ std::string SpiceNetlister::expand_format(const Instance& inst, const Symbol& sy
         }
     }
 
+    if (m_evaluate && cleaned.find('\'') != std::string::npos) {
+        return evaluate_line(cleaned, inst, overrides);
+    }
     return cleaned;
 }
 
-bool SpiceNetlister::generate(std::ostream& out) {
-    // Resolve nets if not already done
-    NetResolver resolver(m_sch);
-    resolver.resolve();
+// Property references nest this deep at most (W='2*L', L='lmin', ...)
+static constexpr int max_expression_depth = 8;
+
+bool SpiceNetlister::evaluate_expression(std::string_view text, const Instance& inst,
+                                         const PropOverrides* overrides, const LineParams* line,
+                                         int depth, double& value) const {
+    if (text.size() >= 2 && text.front() == '\'' && text.back() == '\'') {
+        text = text.substr(1, text.size() - 2);
+    }
+    const Expression* expr = m_expressions.get(text);
+    if (!expr || (depth == 0 && !line && !expr->has_operations())) return false;
+
+    // Variables are the instance's properties (then the symbol template),
+    // then parameters assigned earlier on the same netlist line
+    const auto& names = expr->variables();
+    double small[8];
+    std::vector<double> large;
+    double* values = small;
+    if (names.size() > std::size(small)) {
+        large.resize(names.size());
+        values = large.data();
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        std::string val = translate_prop(inst, names[i], overrides);
+        if (val.empty() && line) {
+            for (const auto& [key, v] : *line) {
+                if (key == names[i]) val = v;
+            }
+        }
+        if (val.empty()) return false;
+        if (!parse_spice_number(val, values[i]) &&
+            (depth + 1 >= max_expression_depth ||
+             !evaluate_expression(val, inst, overrides, line, depth + 1, values[i]))) {
+            return false;
+        }
+    }
+    return expr->evaluate(values, value);
+}
+
+std::string SpiceNetlister::evaluate_line(const std::string& line, const Instance& inst,
+                                          const PropOverrides* overrides) const {
+    // Unquoted key=value parameters on the line
+    LineParams params;
+    std::string_view view(line);
+    for (size_t eq = view.find('='); eq != std::string_view::npos; eq = view.find('=', eq + 1)) {
+        size_t key_start = eq;
+        while (key_start > 0 && !std::isspace(static_cast<unsigned char>(view[key_start - 1]))) key_start--;
+        size_t val_end = eq + 1;
+        while (val_end < view.size() && !std::isspace(static_cast<unsigned char>(view[val_end]))) val_end++;
+        std::string_view val = view.substr(eq + 1, val_end - eq - 1);
+        if (key_start < eq && !val.empty() && val.front() != '\'') {
+            params.emplace_back(view.substr(key_start, eq - key_start), val);
+        }
+    }
+
+    // Each '...' that evaluates is replaced by its value
+    std::string result;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        size_t open = line.find('\'', pos);
+        size_t close = open == std::string::npos ? open : line.find('\'', open + 1);
+        if (close == std::string::npos) break;
+        result.append(line, pos, open - pos);
+        double number;
+        std::string_view expr = view.substr(open + 1, close - open - 1);
+        if (evaluate_expression(expr, inst, overrides, &params, 0, number)) {
+            result += format_spice_number(number);
+        } else {
+            result.append(line, open, close + 1 - open);
+        }
+        pos = close + 1;
+    }
+    result.append(line, pos, std::string::npos);
+    return result;
+}
 
+void SpiceNetlister::write_header(std::ostream& out) const {
     // Get cell name
     std::string cell_name = m_top_cell_name;
     if (cell_name.empty()) {
@@ -868,87 +1892,157 @@ bool SpiceNetlister::generate(std::ostream& out) {
     // Header
     out << "** sch_path: " << m_sch.filename << "\n";
 
-    // Collect pins for subcircuit header
-    std::vector<std::string> io_pins;
-    for (const auto& inst : m_sch.instances) {
-        auto sym_it = m_sch.symbols.find(inst.symbol_name);
-        if (sym_it == m_sch.symbols.end()) continue;
-
-        if (is_pin_symbol(sym_it->second.type)) {
-            std::string lab = get_tok_value(inst.props, "lab");
-            if (!lab.empty()) {
-                io_pins.push_back(lab);
-            }
-        }
-    }
-
     // Subcircuit header
+    const auto& ports = m_nets->ports();
     if (m_subcircuit_mode) {
         out << ".subckt " << cell_name;
-        for (const auto& pin : io_pins) {
-            out << " " << pin;
+        for (const auto& port : ports) {
+            out << " " << port.name;
         }
         out << "\n";
 
         // Pin info comment
-        if (!io_pins.empty()) {
+        if (!ports.empty()) {
             out << "*.PININFO";
-            for (const auto& inst : m_sch.instances) {
-                auto sym_it = m_sch.symbols.find(inst.symbol_name);
-                if (sym_it == m_sch.symbols.end()) continue;
-
-                const auto& sym = sym_it->second;
-                if (is_pin_symbol(sym.type)) {
-                    std::string lab = get_tok_value(inst.props, "lab");
-                    char dir = 'B';
-                    if (sym.type == "ipin") dir = 'I';
-                    else if (sym.type == "opin") dir = 'O';
-                    out << " " << lab << ":" << dir;
-                }
+            for (const auto& port : ports) {
+                out << " " << port.name << ":" << port.dir;
             }
             out << "\n";
         }
     } else {
         out << "** " << cell_name << "\n";
     }
+}
 
-    // Output instances
-    for (const auto& inst : m_sch.instances) {
-        auto sym_it = m_sch.symbols.find(inst.symbol_name);
-        if (sym_it == m_sch.symbols.end()) continue;
-
-        const auto& sym = sym_it->second;
-
-        // Skip pin and label symbols
-        if (is_pin_symbol(sym.type) || is_label_symbol(sym.type)) {
-            continue;
-        }
+void SpiceNetlister::write_footer(std::ostream& out) const {
+    // Close subcircuit
+    if (m_subcircuit_mode) {
+        out << ".ends\n";
+    }
 
-        // Skip graphical/annotation symbols
-        if (sym.type == "title" || sym.type == "logo" || sym.type == "graphic" ||
-            inst.symbol_name.find("title") != std::string::npos ||
-            inst.symbol_name.find("ammeter") != std::string::npos) {
-            continue;
-        }
+    out << ".end\n";
+}
 
-        // Generate SPICE line
-        std::string spice_line = expand_format(inst, sym);
+void SpiceNetlister::format_instance(size_t index, std::string& out,
+                                     const PropOverrides* overrides) const {
+    out.clear();
+    // Pins, labels and graphical/annotation symbols are not netlisted
+    if (!m_nets->is_element(index)) return;
+    const Symbol& sym = *m_nets->symbol(index);
+
+    // Generate SPICE line, one per instance of an array ("X[15:0]")
+    const size_t copies = m_nets->copies(index);
+    for (size_t bit = 0; bit < copies; bit++) {
+        std::string spice_line = expand_format(index, sym, bit, overrides);
         spice_line = trim(spice_line);
         if (!spice_line.empty()) {
-            out << spice_line << "\n";
+            out += spice_line;
+            out += '\n';
         }
     }
+}
 
-    // Close subcircuit
-    if (m_subcircuit_mode) {
-        out << ".ends\n";
+bool SpiceNetlister::split_element(size_t index, size_t copy, std::string& before, std::string& after) {
+    prepare();
+    before.clear();
+    after.clear();
+    if (!m_nets->is_element(index)) return false;
+    std::string line = trim(expand_format(index, *m_nets->symbol(index), copy, nullptr, true));
+    size_t mark = line.find(pin_marker);
+    before = line.substr(0, mark);
+    if (mark != std::string::npos) after = line.substr(mark + 1);
+    return true;
+}
+
+// Instances emitted per trace span
+static constexpr size_t emit_chunk_size = 4096;
+
+bool SpiceNetlister::generate(std::ostream& out) {
+    // Resolve nets if not already done
+    prepare();
+
+    StageTimer timer(Stage::Emission);
+    XSCHEM_TRACE_SCOPE("emit_netlist", m_sch.filename);
+
+    write_header(out);
+
+    // Output instances, in chunks so that traces show emission progress
+    const size_t instance_count = m_sch.instances.size();
+    std::string text;
+    for (size_t chunk = 0; chunk < instance_count; chunk += emit_chunk_size) {
+        XSCHEM_TRACE_SCOPE("emit_instances");
+        const size_t chunk_end = std::min(instance_count, chunk + emit_chunk_size);
+        for (size_t i = chunk; i < chunk_end; i++) {
+            format_instance(i, text);
+            out << text;
+        }
     }
 
-    out << ".end\n";
+    write_footer(out);
+    return true;
+}
+
+bool SpiceNetlister::prepare_sweep() {
+    prepare();
+
+    StageTimer timer(Stage::Emission);
+    XSCHEM_TRACE_SCOPE("sweep_base_netlist", m_sch.filename);
 
+    std::ostringstream header;
+    write_header(header);
+    m_base_header = header.str();
+
+    m_base_lines.resize(m_sch.instances.size());
+    m_instance_index.clear();
+    for (size_t i = 0; i < m_sch.instances.size(); i++) {
+        format_instance(i, m_base_lines[i]);
+        m_instance_index[m_sch.instances[i].inst_name].push_back(i);
+    }
+    m_sweep_ready = true;
     return true;
 }
 
+bool SpiceNetlister::generate_variant(const SweepVariant& variant, std::ostream& out) const {
+    if (!m_sweep_ready) {
+        std::cerr << "Error: prepare_sweep() must be called before generate_variant()" << std::endl;
+        return false;
+    }
+    XSCHEM_TRACE_SCOPE("emit_variant", variant.name);
+
+    // Overrides per instance; "*" applies to every emitted instance
+    std::map<size_t, PropOverrides> changed;
+    for (const auto& ov : variant.overrides) {
+        if (ov.instance == "*") {
+            for (size_t i = 0; i < m_base_lines.size(); i++) {
+                if (!m_base_lines[i].empty()) changed[i][ov.prop] = ov.value;
+            }
+            continue;
+        }
+        auto it = m_instance_index.find(ov.instance);
+        if (it == m_instance_index.end()) {
+            std::cerr << "Warning: " << variant.name << ": no instance named " << ov.instance << std::endl;
+            continue;
+        }
+        for (size_t i : it->second) changed[i][ov.prop] = ov.value;
+    }
+
+    // Unchanged instances reuse the base lines
+    out << m_base_header;
+    auto next = changed.begin();
+    std::string text;
+    for (size_t i = 0; i < m_base_lines.size(); i++) {
+        if (next != changed.end() && next->first == i) {
+            format_instance(i, text, &next->second);
+            out << text;
+            ++next;
+        } else {
+            out << m_base_lines[i];
+        }
+    }
+    write_footer(out);
+    return out.good();
+}
+
 bool SpiceNetlister::generate(const std::string& output_file) {
     std::ofstream out(output_file);
     if (!out.is_open()) {
@@ -963,8 +2057,10 @@ bool SpiceNetlister::generate(const std::string& output_file) {
 // ============================================================================
 
 bool load_schematic(const std::string& filename, Schematic& sch,
-                    const std::vector<std::string>& symbol_paths) {
+                    const std::vector<std::string>& symbol_paths,
+                    const LoadOptions& options) {
     SchematicParser parser;
+    parser.set_load_options(options);
     for (const auto& path : symbol_paths) {
         parser.add_symbol_path(path);
     }
@@ -976,71 +2072,288 @@ bool load_schematic(const std::string& filename, Schematic& sch,
 }
 
 bool generate_spice_netlist(Schematic& sch, const std::string& output_file,
-                            bool subcircuit_mode) {
+                            bool subcircuit_mode, bool evaluate) {
     SpiceNetlister netlister(sch);
     netlister.set_subcircuit_mode(subcircuit_mode);
+    netlister.set_evaluate_expressions(evaluate);
     return netlister.generate(output_file);
 }
 
-bool generate_spice_netlist(Schematic& sch, std::ostream& out, bool subcircuit_mode) {
+bool generate_spice_netlist(Schematic& sch, std::ostream& out, bool subcircuit_mode,
+                            bool evaluate) {
     SpiceNetlister netlister(sch);
     netlister.set_subcircuit_mode(subcircuit_mode);
+    netlister.set_evaluate_expressions(evaluate);
     return netlister.generate(out);
 }
 
+// Escape a path for use in a make rule
+static std::string make_escape(const std::string& path) {
+    std::string result;
+    for (char c : path) {
+        if (c == ' ' || c == '#') result += '\\';
+        else if (c == '$') result += '$';
+        result += c;
+    }
+    return result;
+}
+
+bool write_depfile(const std::string& depfile, const std::string& target,
+                   const std::vector<std::string>& deps, bool phony_targets) {
+    std::ofstream out(depfile);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot open dependency file: " << depfile << std::endl;
+        return false;
+    }
+
+    // Drop duplicates, keep first-use order
+    std::vector<std::string> unique_deps;
+    std::unordered_set<std::string> seen;
+    for (const auto& dep : deps) {
+        if (!dep.empty() && seen.insert(dep).second) {
+            unique_deps.push_back(dep);
+        }
+    }
+
+    out << make_escape(target) << ":";
+    for (const auto& dep : unique_deps) {
+        out << " \\\n  " << make_escape(dep);
+    }
+    out << "\n";
+
+    // The primary input keeps its real rule: a phony one would let make
+    // carry on silently after the schematic itself was deleted
+    if (phony_targets) {
+        for (size_t i = 1; i < unique_deps.size(); i++) {
+            out << "\n" << make_escape(unique_deps[i]) << ":\n";
+        }
+    }
+    return out.good();
+}
+
 // ============================================================================
 // xschemrc parser
 // ============================================================================
 
-// Helper to expand environment variables in a string
-static std::string expand_env_vars(const std::string& input) {
-    std::string result = input;
+namespace {
+
+// Evaluator for the small Tcl subset found in xschemrc files:
+//   set name ?value?, append name value..., $var, ${var}, $env(VAR),
+//   $arr(idx), [info script], [file dirname|tail|join|normalize ...]
+// The file is evaluated one line at a time. Other commands (if, proc,
+// puts, ...) are ignored, and the lines of their braced bodies are
+// evaluated unconditionally.
+class TclSubsetEval {
+public:
+    explicit TclSubsetEval(std::string script_path)
+        : m_script(std::move(script_path)) {}
+
+    std::unordered_map<std::string, std::string>& vars() { return m_vars; }
+
+    // Environment variables read while evaluating, with the values seen
+    const std::map<std::string, std::string>& env_used() const { return m_env_used; }
+
+    void eval_line(std::string_view line) {
+        size_t pos = 0;
+        while (pos < line.size()) {
+            std::vector<std::string> words;
+            if (!parse_command(line, pos, words)) break;
+            if (!words.empty()) eval_command(words);
+        }
+    }
+
+private:
+    std::string m_script;
+    std::unordered_map<std::string, std::string> m_vars;
+    mutable std::map<std::string, std::string> m_env_used;
+
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+    static bool is_name_char(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+    std::string lookup(const std::string& name) const {
+        std::string_view key(name);
+        if (key.starts_with("::")) key.remove_prefix(2);
+        auto it = m_vars.find(std::string(key));
+        if (it != m_vars.end()) return it->second;
 
-    // Expand $env(VAR) syntax (Tcl style)
-    std::regex env_tcl_regex(R"(\$env\(([^)]+)\))");
-    std::smatch match;
-    while (std::regex_search(result, match, env_tcl_regex)) {
-        std::string var_name = match[1].str();
-        const char* env_val = std::getenv(var_name.c_str());
-        std::string replacement = env_val ? env_val : "";
-        result = match.prefix().str() + replacement + match.suffix().str();
+        // Fall back to the environment ($env(VAR) and undefined $VAR alike)
+        std::string env_name(key);
+        if (key.starts_with("env(") && key.ends_with(")")) {
+            env_name = std::string(key.substr(4, key.size() - 5));
+        }
+        const char* env_val = std::getenv(env_name.c_str());
+        return m_env_used[env_name] = env_val ? env_val : "";
     }
 
-    // Expand ${VAR} syntax
-    std::regex env_brace_regex(R"(\$\{([^}]+)\})");
-    while (std::regex_search(result, match, env_brace_regex)) {
-        std::string var_name = match[1].str();
-        const char* env_val = std::getenv(var_name.c_str());
-        std::string replacement = env_val ? env_val : "";
-        result = match.prefix().str() + replacement + match.suffix().str();
+    // Parse one command (up to ';' or end of line) into substituted words.
+    // Returns false if only whitespace or a comment remained.
+    bool parse_command(std::string_view s, size_t& pos, std::vector<std::string>& words) {
+        while (pos < s.size() && is_space(s[pos])) pos++;
+        if (pos >= s.size() || s[pos] == '#') return false;
+
+        while (pos < s.size()) {
+            while (pos < s.size() && is_space(s[pos])) pos++;
+            if (pos >= s.size()) break;
+            if (s[pos] == ';') { pos++; break; }
+
+            std::string word;
+            if (s[pos] == '{') {
+                // Braced word: literal, no substitution. An unterminated brace
+                // (a multi-line body) takes the rest of the line.
+                int depth = 1;
+                size_t start = ++pos;
+                while (pos < s.size() && depth > 0) {
+                    if (s[pos] == '\\' && pos + 1 < s.size()) pos++;
+                    else if (s[pos] == '{') depth++;
+                    else if (s[pos] == '}') depth--;
+                    pos++;
+                }
+                word = std::string(s.substr(start, pos - start - (depth == 0 ? 1 : 0)));
+            } else if (s[pos] == '"') {
+                pos++;
+                substitute(s, pos, '"', word);
+                if (pos < s.size()) pos++; // closing quote
+            } else {
+                substitute(s, pos, ' ', word);
+            }
+            words.push_back(std::move(word));
+        }
+        return true;
     }
 
-    // Expand $VAR syntax (simple)
-    std::regex env_simple_regex(R"(\$([A-Za-z_][A-Za-z0-9_]*))");
-    while (std::regex_search(result, match, env_simple_regex)) {
-        std::string var_name = match[1].str();
-        const char* env_val = std::getenv(var_name.c_str());
-        std::string replacement = env_val ? env_val : "";
-        result = match.prefix().str() + replacement + match.suffix().str();
+    // Append the substituted text of s[pos...] to out, stopping at the
+    // terminator (' ' means a bare word: whitespace or ';').
+    void substitute(std::string_view s, size_t& pos, char terminator, std::string& out) {
+        while (pos < s.size()) {
+            char c = s[pos];
+            if (terminator == ' ' ? (is_space(c) || c == ';') : c == terminator) return;
+
+            if (c == '\\' && pos + 1 < s.size()) {
+                char e = s[pos + 1];
+                out += (e == 'n') ? '\n' : (e == 't') ? '\t' : e;
+                pos += 2;
+            } else if (c == '$') {
+                substitute_variable(s, pos, out);
+            } else if (c == '[') {
+                int depth = 1;
+                size_t start = ++pos;
+                while (pos < s.size() && depth > 0) {
+                    if (s[pos] == '[') depth++;
+                    else if (s[pos] == ']') depth--;
+                    pos++;
+                }
+                std::string_view inner = s.substr(start, pos - start - (depth == 0 ? 1 : 0));
+                size_t inner_pos = 0;
+                std::vector<std::string> words;
+                if (parse_command(inner, inner_pos, words) && !words.empty()) {
+                    out += eval_command(words);
+                }
+            } else {
+                out += c;
+                pos++;
+            }
+        }
     }
 
-    return result;
+    void substitute_variable(std::string_view s, size_t& pos, std::string& out) {
+        pos++; // skip '$'
+        std::string name;
+        if (pos < s.size() && s[pos] == '{') {
+            size_t end = s.find('}', pos);
+            if (end == std::string_view::npos) end = s.size();
+            name = std::string(s.substr(pos + 1, end - pos - 1));
+            pos = std::min(end + 1, s.size());
+        } else {
+            size_t start = pos;
+            while (pos < s.size() && (is_name_char(s[pos]) ||
+                   (s[pos] == ':' && pos + 1 < s.size() && s[pos + 1] == ':'))) {
+                pos += (s[pos] == ':') ? 2 : 1;
+            }
+            name = std::string(s.substr(start, pos - start));
+            if (name.empty()) {
+                out += '$';
+                return;
+            }
+            if (pos < s.size() && s[pos] == '(') {
+                // Array element, the index is substituted too
+                pos++;
+                std::string index;
+                substitute(s, pos, ')', index);
+                if (pos < s.size()) pos++;
+                name += "(" + index + ")";
+            }
+        }
+        out += lookup(name);
+    }
+
+    std::string eval_command(const std::vector<std::string>& words) {
+        const std::string& cmd = words[0];
+        if (cmd == "set" && words.size() >= 2) {
+            if (words.size() == 2) return lookup(words[1]);
+            return m_vars[words[1]] = words[2];
+        }
+        if (cmd == "append" && words.size() >= 2) {
+            std::string& value = m_vars[words[1]];
+            for (size_t i = 2; i < words.size(); i++) value += words[i];
+            return value;
+        }
+        if (cmd == "info" && words.size() == 2 && words[1] == "script") {
+            return m_script;
+        }
+        if (cmd == "file" && words.size() >= 3) {
+            namespace fs = std::filesystem;
+            const std::string& sub = words[1];
+            if (sub == "dirname") {
+                std::string dir = fs::path(words[2]).parent_path().string();
+                return dir.empty() ? "." : dir;
+            }
+            if (sub == "tail") return fs::path(words[2]).filename().string();
+            if (sub == "normalize") return fs::absolute(words[2]).lexically_normal().string();
+            if (sub == "join") {
+                fs::path joined;
+                for (size_t i = 2; i < words.size(); i++) joined /= words[i];
+                return joined.string();
+            }
+        }
+        return "";
+    }
+};
+
+} // namespace
+
+// Environment variables that parse_xschemrc reads directly
+static const char* const rc_env_vars[] = {"PDK_ROOT", "PDK", "HOME", "XSCHEM_SHAREDIR"};
+
+static std::string getenv_str(const std::string& name) {
+    const char* val = std::getenv(name.c_str());
+    return val ? val : "";
 }
 
-std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path) {
-    std::vector<std::string> paths;
+// What is at a path: 'd' directory, 'f' other file, '-' nothing
+static char probe_path(const std::filesystem::path& path) {
+    stat_add(&Stats::exists_probes);
+    std::error_code ec;
+    auto status = std::filesystem::status(path, ec);
+    if (!std::filesystem::exists(status)) return '-';
+    return std::filesystem::is_directory(status) ? 'd' : 'f';
+}
 
+// Evaluate the xschemrc and resolve its XSCHEM_LIBRARY_PATH
+static bool evaluate_xschemrc(const std::string& xschemrc_path, XschemrcConfig& config) {
     std::ifstream file(xschemrc_path);
     if (!file.is_open()) {
         std::cerr << "Warning: Cannot open xschemrc: " << xschemrc_path << std::endl;
-        return paths;
+        return false;
     }
+    stat_add(&Stats::files_opened);
 
     // Get directory containing xschemrc for relative path resolution
     std::filesystem::path rc_dir = std::filesystem::path(xschemrc_path).parent_path();
 
-    // Variables we track (simplified Tcl variable handling)
-    std::unordered_map<std::string, std::string> tcl_vars;
+    // [info script] is absolute so that [file dirname [info script]] is not
+    // resolved against rc_dir a second time
+    TclSubsetEval interp(std::filesystem::absolute(xschemrc_path).string());
+    auto& tcl_vars = interp.vars();
 
     // Initialize with common defaults
     const char* home = std::getenv("HOME");
@@ -1067,7 +2380,8 @@ std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path) {
             home ? std::string(home) + "/share/xschem" : ""
         };
         for (const auto& candidate : share_candidates) {
-            if (!candidate.empty() && std::filesystem::exists(candidate)) {
+            if (candidate.empty()) continue;
+            if (probe_path(candidate) != '-') {
                 tcl_vars["XSCHEM_SHAREDIR"] = candidate;
                 break;
             }
@@ -1075,98 +2389,12 @@ std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path) {
     }
 
     std::string line;
-    std::string xschem_library_path;
-
     while (std::getline(file, line)) {
-        // Skip comments and empty lines
-        std::string trimmed = trim(line);
-        if (trimmed.empty() || trimmed[0] == '#') continue;
-
-        // Look for: set XSCHEM_LIBRARY_PATH ...
-        // and: append XSCHEM_LIBRARY_PATH :...
-
-        std::regex set_regex(R"(^\s*set\s+XSCHEM_LIBRARY_PATH\s+\{\s*\}\s*$)");
-        std::regex append_regex(R"(^\s*append\s+XSCHEM_LIBRARY_PATH\s+:(.+)$)");
-        std::regex set_var_regex(R"(^\s*set\s+(\w+)\s+(.+)$)");
-
-        std::smatch match;
-
-        if (std::regex_match(trimmed, set_regex)) {
-            // Reset path
-            xschem_library_path.clear();
-        } else if (std::regex_search(trimmed, match, append_regex)) {
-            // Append to path
-            std::string path_part = match[1].str();
-
-            // Handle [file dirname [info script]] - means directory of xschemrc
-            if (path_part.find("[file dirname [info script]]") != std::string::npos) {
-                path_part = rc_dir.string();
-            }
-
-            // Substitute Tcl variables
-            for (const auto& [var, val] : tcl_vars) {
-                std::string var_pattern = "${" + var + "}";
-                size_t pos;
-                while ((pos = path_part.find(var_pattern)) != std::string::npos) {
-                    path_part.replace(pos, var_pattern.length(), val);
-                }
-                // Also try $VAR format
-                var_pattern = "$" + var;
-                while ((pos = path_part.find(var_pattern)) != std::string::npos) {
-                    // Make sure it's not part of a longer variable name
-                    size_t end_pos = pos + var_pattern.length();
-                    if (end_pos >= path_part.length() ||
-                        (!std::isalnum(path_part[end_pos]) && path_part[end_pos] != '_')) {
-                        path_part.replace(pos, var_pattern.length(), val);
-                    } else {
-                        break;
-                    }
-                }
-            }
-
-            // Expand any remaining environment variables
-            path_part = expand_env_vars(path_part);
-
-            if (!xschem_library_path.empty()) {
-                xschem_library_path += ":";
-            }
-            xschem_library_path += path_part;
-        } else if (std::regex_search(trimmed, match, set_var_regex)) {
-            // Track variable assignments
-            std::string var_name = match[1].str();
-            std::string var_value = match[2].str();
-
-            // Remove braces if present
-            if (!var_value.empty() && var_value.front() == '{' && var_value.back() == '}') {
-                var_value = var_value.substr(1, var_value.length() - 2);
-            }
-
-            // Substitute existing variables
-            for (const auto& [var, val] : tcl_vars) {
-                std::string var_pattern = "${" + var + "}";
-                size_t pos;
-                while ((pos = var_value.find(var_pattern)) != std::string::npos) {
-                    var_value.replace(pos, var_pattern.length(), val);
-                }
-                var_pattern = "$" + var;
-                while ((pos = var_value.find(var_pattern)) != std::string::npos) {
-                    size_t end_pos = pos + var_pattern.length();
-                    if (end_pos >= var_value.length() ||
-                        (!std::isalnum(var_value[end_pos]) && var_value[end_pos] != '_')) {
-                        var_value.replace(pos, var_pattern.length(), val);
-                    } else {
-                        break;
-                    }
-                }
-            }
-
-            var_value = expand_env_vars(var_value);
-            tcl_vars[var_name] = var_value;
-        }
+        interp.eval_line(line);
     }
 
     // Split the path by colons and add valid directories
-    std::stringstream ss(xschem_library_path);
+    std::stringstream ss(tcl_vars["XSCHEM_LIBRARY_PATH"]);
     std::string path_entry;
     while (std::getline(ss, path_entry, ':')) {
         path_entry = trim(path_entry);
@@ -1180,16 +2408,202 @@ std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path) {
             }
 
             // Check if directory exists
-            if (std::filesystem::exists(abs_path) && std::filesystem::is_directory(abs_path)) {
-                paths.push_back(std::filesystem::canonical(abs_path).string());
-            } else if (std::filesystem::exists(abs_path)) {
-                paths.push_back(abs_path.string());
+            char state = probe_path(abs_path);
+            if (state == 'd') {
+                config.library_paths.push_back(std::filesystem::canonical(abs_path).string());
+            } else if (state == 'f') {
+                config.library_paths.push_back(abs_path.string());
             }
             // Silently skip non-existent paths
         }
     }
 
-    return paths;
+    config.variables.insert(tcl_vars.begin(), tcl_vars.end());
+    config.environment = interp.env_used();
+    for (const char* name : rc_env_vars) {
+        config.environment[name] = getenv_str(name);
+    }
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Resolved-configuration snapshot
+//
+// Text file, one record per line, fields escaped with escape_field():
+//   xschem_lite-rc-snapshot <version>
+//   rc <absolute xschemrc path>
+//   stamp <mtime> <size>
+//   env <name> <value>
+//   var <name> <value>
+//   path <library path>
+// ----------------------------------------------------------------------------
+
+static const int rc_snapshot_version = 1;
+
+static std::string escape_field(const std::string& s) {
+    std::string result;
+    for (char c : s) {
+        if (c == '\\') result += "\\\\";
+        else if (c == '\n') result += "\\n";
+        else if (c == ' ') result += "\\s";
+        else if (c == '\t') result += "\\t";
+        else result += c;
+    }
+    return result.empty() ? "\\0" : result;
+}
+
+static std::string unescape_field(const std::string& s) {
+    std::string result;
+    for (size_t i = 0; i < s.size(); i++) {
+        if (s[i] == '\\' && i + 1 < s.size()) {
+            char e = s[++i];
+            if (e == 'n') result += '\n';
+            else if (e == 's') result += ' ';
+            else if (e == 't') result += '\t';
+            else if (e != '0') result += e;
+        } else {
+            result += s[i];
+        }
+    }
+    return result;
+}
+
+static std::string rc_stamp(const std::filesystem::path& rc) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(rc, ec);
+    if (ec) return "";
+    auto size = std::filesystem::file_size(rc, ec);
+    if (ec) return "";
+    return std::to_string(mtime.time_since_epoch().count()) + " " + std::to_string(size);
+}
+
+static std::filesystem::path rc_snapshot_file(const std::string& cache_dir,
+                                              const std::string& rc_abs) {
+    std::ostringstream name;
+    name << "rc-" << std::hex << std::hash<std::string>()(rc_abs) << ".snapshot";
+    return std::filesystem::path(cache_dir) / name.str();
+}
+
+static bool read_rc_snapshot(const std::filesystem::path& snapshot,
+                             const std::string& rc_abs, const std::string& stamp,
+                             XschemrcConfig& config) {
+    std::ifstream in(snapshot);
+    if (!in.is_open()) return false;
+    stat_add(&Stats::files_opened);
+
+    std::string line;
+    if (!std::getline(in, line) ||
+        line != "xschem_lite-rc-snapshot " + std::to_string(rc_snapshot_version)) {
+        return false;
+    }
+
+    XschemrcConfig cached;
+    bool rc_ok = false, stamp_ok = false;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string tag, a, b;
+        fields >> tag >> a >> b;
+        if (tag == "rc") {
+            rc_ok = (unescape_field(a) == rc_abs);
+        } else if (tag == "stamp") {
+            stamp_ok = (a + " " + b == stamp);
+        } else if (tag == "env") {
+            cached.environment[unescape_field(a)] = unescape_field(b);
+        } else if (tag == "var") {
+            cached.variables[unescape_field(a)] = unescape_field(b);
+        } else if (tag == "path") {
+            cached.library_paths.push_back(unescape_field(a));
+        }
+    }
+    if (!rc_ok || !stamp_ok) return false;
+
+    for (const auto& [name, value] : cached.environment) {
+        if (getenv_str(name) != value) return false;
+    }
+
+    config = std::move(cached);
+    return true;
+}
+
+static void write_rc_snapshot(const std::filesystem::path& snapshot,
+                              const std::string& rc_abs, const std::string& stamp,
+                              const XschemrcConfig& config) {
+    std::error_code ec;
+    std::filesystem::create_directories(snapshot.parent_path(), ec);
+
+    // Write to a temporary file and rename, so that concurrent runs never
+    // see a partial snapshot. The name is unique per call: threads of one
+    // process (C API hosts) may write the same snapshot at once.
+    static std::atomic<unsigned> tmp_count{0};
+    std::filesystem::path tmp = snapshot;
+    tmp += ".tmp" + std::to_string(getpid()) + "-" + std::to_string(tmp_count++);
+    {
+        std::ofstream out(tmp);
+        if (!out.is_open()) return;
+        out << "xschem_lite-rc-snapshot " << rc_snapshot_version << "\n";
+        out << "rc " << escape_field(rc_abs) << "\n";
+        out << "stamp " << stamp << "\n";
+        for (const auto& [name, value] : config.environment) {
+            out << "env " << escape_field(name) << " " << escape_field(value) << "\n";
+        }
+        for (const auto& [name, value] : config.variables) {
+            out << "var " << escape_field(name) << " " << escape_field(value) << "\n";
+        }
+        for (const auto& path : config.library_paths) {
+            out << "path " << escape_field(path) << "\n";
+        }
+        if (!out.good()) {
+            out.close();
+            std::filesystem::remove(tmp, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp, snapshot, ec);
+    if (ec) std::filesystem::remove(tmp, ec);
+}
+
+std::string default_xschemrc_cache_dir() {
+    if (const char* dir = std::getenv("XSCHEM_LITE_CACHE_DIR")) return dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return (std::filesystem::path(xdg) / "xschem_lite").string();
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return (std::filesystem::path(home) / ".cache" / "xschem_lite").string();
+    }
+    return "";
+}
+
+bool load_xschemrc(const std::string& xschemrc_path, XschemrcConfig& config,
+                   const std::string& cache_dir) {
+    StageTimer timer(Stage::XschemrcParse);
+    XSCHEM_TRACE_SCOPE("load_xschemrc", xschemrc_path);
+    config = XschemrcConfig();
+    if (cache_dir.empty()) {
+        return evaluate_xschemrc(xschemrc_path, config);
+    }
+
+    std::string rc_abs = std::filesystem::absolute(xschemrc_path).lexically_normal().string();
+    std::string stamp = rc_stamp(rc_abs);
+    if (stamp.empty()) {
+        return evaluate_xschemrc(xschemrc_path, config);
+    }
+
+    std::filesystem::path snapshot = rc_snapshot_file(cache_dir, rc_abs);
+    if (read_rc_snapshot(snapshot, rc_abs, stamp, config)) {
+        return true;
+    }
+
+    if (!evaluate_xschemrc(xschemrc_path, config)) {
+        return false;
+    }
+    write_rc_snapshot(snapshot, rc_abs, stamp, config);
+    return true;
+}
+
+std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path, bool use_cache) {
+    XschemrcConfig config;
+    load_xschemrc(xschemrc_path, config, use_cache ? default_xschemrc_cache_dir() : "");
+    return config.library_paths;
 }
 
 } // namespace xschem
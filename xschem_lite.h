@@ -6,7 +6,9 @@
 #define XSCHEM_LITE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <fstream>
@@ -14,6 +16,14 @@
 #include <cmath>
 #include <algorithm>
 #include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <cstdint>
+#include <span>
+#include "xschem_expr.h"
 
 namespace xschem {
 
@@ -48,6 +58,66 @@ struct Pin {
     std::string name;
     std::string direction;  // "in", "out", "inout"
     double x, y;
+    bool output = false;    // direction == "out", set by classify_symbol
+};
+
+// What a symbol is to the resolver and the netlisters. Interned from its
+// type (for drawings also its file name) by classify_symbol when the
+// symbol is loaded, so code running per instance never compares strings.
+enum class SymbolKind : uint8_t {
+    Subcircuit,
+    Mos,            // nmos, pmos
+    Resistor,
+    Capacitor,
+    Primitive,      // Any other type, written through its format
+    Code,           // netlist_commands: simulator commands, not a device
+    InputPin,       // ipin
+    OutputPin,      // opin
+    InoutPin,       // iopin
+    Label,          // label, netlabel, net_name
+    Drawing,        // title, logo, graphic; title block and ammeter symbols
+};
+
+struct SymbolKindTraits {
+    bool element;               // Written to netlists
+    bool device;                // A circuit element: instantiated in Verilog and JSON
+    char port_dir;              // 'I', 'O' or 'B' for pins, 0 otherwise
+    const char* default_format; // SPICE format when the symbol has none
+};
+
+const SymbolKindTraits& symbol_kind_traits(SymbolKind kind);
+
+// Properties of an instance in the order they are written. An instance
+// has a handful, so a flat vector searched in order is cheaper than a hash
+// map and lists them the same way on every run.
+class PropMap {
+public:
+    using value_type = std::pair<std::string, std::string>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    const_iterator begin() const { return m_items.begin(); }
+    const_iterator end() const { return m_items.end(); }
+    size_t size() const { return m_items.size(); }
+    bool empty() const { return m_items.empty(); }
+
+    const_iterator find(std::string_view key) const {
+        return std::find_if(m_items.begin(), m_items.end(),
+                            [key](const value_type& item) { return item.first == key; });
+    }
+
+    // A key given again keeps its place and takes the new value
+    void set(std::string key, std::string value) {
+        for (auto& item : m_items) {
+            if (item.first == key) {
+                item.second = std::move(value);
+                return;
+            }
+        }
+        m_items.emplace_back(std::move(key), std::move(value));
+    }
+
+private:
+    std::vector<value_type> m_items;
 };
 
 // A component instance
@@ -61,10 +131,24 @@ struct Instance {
     std::vector<std::string> connected_nets;  // Nets connected to each pin
 
     // Parsed properties cache
-    std::unordered_map<std::string, std::string> prop_map;
+    PropMap prop_map;
 };
 
 // Symbol definition (loaded from .sym files)
+// A piece of a symbol's SPICE format: literal text or an @ field
+struct FormatToken {
+    enum class Kind : uint8_t {
+        Text,           // Copied as is
+        Name,           // @name, one bit of an instance array
+        Pinlist,        // @pinlist
+        Symname,        // @symname; text is the symbol file stem
+        RawProperty,    // @spiceprefix, @extra: never evaluated
+        Property,       // Any other @prop; text is the property name
+    };
+    Kind kind;
+    std::string text;
+};
+
 struct Symbol {
     std::string name;
     std::string type;            // "subcircuit", "primitive", etc.
@@ -73,7 +157,13 @@ struct Symbol {
     std::string template_str;    // Default property template
     std::string props;
 
-    // Bounding box
+    SymbolKind kind = SymbolKind::Primitive;
+    bool names_net = false;      // lab= of an instance names the net at its
+                                 // pin (type=label: lab_pin, vdd, gnd...)
+    std::vector<FormatToken> format_tokens;  // format, or the kind's default
+
+    // Bounding box of the pins and graphics (B, L, A, P records; texts
+    // are not measured), in symbol coordinates
     double minx = 0, miny = 0, maxx = 0, maxy = 0;
 };
 
@@ -95,6 +185,76 @@ struct PointHash {
     }
 };
 
+// Connectivity of a resolved schematic in compressed sparse row form:
+// net -> instance pins, net -> wires and instance -> nets. Built by
+// NetResolver::resolve() (and load_snapshot) so that checkers can query it
+// instead of scanning Instance::connected_nets and Wire::node. Nets are
+// the resolved names as the schematic holds them (a bus stays one net,
+// "DATA[7:0]"), numbered in first-use order: wires, then instance pins.
+class NetIndex {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    struct PinRef {
+        uint32_t inst;
+        uint32_t pin;       // Index into the symbol's pins
+    };
+
+    void build(const Schematic& sch);
+    void clear();
+
+    size_t net_count() const { return m_names.size(); }
+    const std::string& net_name(uint32_t net) const { return m_names[net]; }
+    // npos if no net has this name
+    uint32_t find(std::string_view name) const;
+
+    std::span<const PinRef> pins(uint32_t net) const {
+        return {m_pins.data() + m_pin_first[net], m_pins.data() + m_pin_first[net + 1]};
+    }
+    std::span<const uint32_t> wires(uint32_t net) const {
+        return {m_wires.data() + m_wire_first[net], m_wires.data() + m_wire_first[net + 1]};
+    }
+    // Net of every pin of an instance, in symbol pin order (empty if the
+    // symbol was not loaded)
+    std::span<const uint32_t> nets_of(size_t inst) const {
+        return {m_inst_nets.data() + m_inst_first[inst], m_inst_nets.data() + m_inst_first[inst + 1]};
+    }
+    // Pins on the net that are not outputs (the loads of its driver)
+    size_t fanout(uint32_t net) const { return m_fanout[net]; }
+
+    // Nets whose name matches a glob pattern ('*', '?'), in name order
+    std::vector<uint32_t> match(std::string_view pattern) const;
+
+private:
+    std::vector<std::string> m_names;
+    std::vector<uint32_t> m_sorted;         // Net ids in name order
+    std::vector<uint32_t> m_pin_first;
+    std::vector<PinRef> m_pins;
+    std::vector<uint32_t> m_wire_first;
+    std::vector<uint32_t> m_wires;
+    std::vector<uint32_t> m_inst_first;
+    std::vector<uint32_t> m_inst_nets;
+    std::vector<uint32_t> m_fanout;
+};
+
+// An electrical rule violation, found by NetResolver::resolve() while it
+// groups and names nets
+struct ErcViolation {
+    enum class Kind : uint8_t {
+        FloatingPin,        // Touches no wire, pin or label (netlisted as NC_...)
+        ShortedLabels,      // Different labels on one group of wires and pins
+        DanglingWire,       // Wire end touching nothing
+        DuplicateName,      // Instance name used before
+        OutputConflict,     // Second output pin on a net
+    };
+
+    Kind kind;
+    Point at;
+    std::string message;    // "M1 pin G", "A, B", ...
+};
+
+const char* erc_kind_name(ErcViolation::Kind kind);
+
 // Main schematic container
 struct Schematic {
     std::string filename;
@@ -117,17 +277,203 @@ struct Schematic {
     // Net names
     std::unordered_map<std::string, int> net_names;
     int unnamed_net_count = 0;
+    bool resolved = false;  // NetResolver::resolve() has assigned all nets
+    NetIndex net_index;     // Valid when resolved
+    std::vector<ErcViolation> erc;  // From resolve(), by kind and position;
+                                    // not kept in snapshots
+    size_t merged_wires = 0;        // Segments removed by normalize_wires()
+
+    // Files the loaded design was resolved from (symbol files found through
+    // find_symbol_file), in first-use order. Used for make dependency output.
+    std::vector<std::string> dependencies;
 };
 
+// Set kind, names_net, format_tokens and Pin::output from type, format and
+// pin directions. Every loader calls this once per symbol.
+void classify_symbol(Symbol& sym);
+
 // Utility functions
 std::string get_tok_value(const std::string& props, const std::string& key);
 std::string trim(const std::string& s);
-std::unordered_map<std::string, std::string> parse_props(const std::string& props);
+PropMap parse_props(const std::string& props);
+
+// The point at offset (dx, dy) from an anchor, turned by rot quarter turns
+// and flipped the way xschem places symbols and texts
+Point transform_point(int rot, int flip, double x0, double y0, double dx, double dy);
+
+// A point of an instance's symbol (symbol coordinates) in schematic coordinates
+inline Point instance_point(const Instance& inst, double x, double y) {
+    return transform_point(inst.rot, inst.flip, inst.x, inst.y, x, y);
+}
+
+// Merge horizontal and vertical wires that overlap or touch end to end on
+// one line into a single segment. The result is split again at every
+// original wire end that another wire or an instance pin meets, so nets do
+// not change, except that overlapping collinear wires become connected as
+// in xschem. Wires with different properties (labels, bus=) are not merged.
+// Call before resolving; returns the number of segments removed.
+size_t normalize_wires(Schematic& sch);
+
+// A net, pin or instance name with its bit ranges kept compressed:
+// "DATA[31:0]", "X[15:0]", "D[7:0:2]" (step 2), "D[3,1]" and comma lists
+// such as "A,B[1:0]". Connectivity works on the whole name; bits are only
+// spelled out when a netlist line is written. Bit 0 is the leftmost one
+// ("DATA[31]"), as in xschem. Keeps views into `name`, which must outlive it.
+class BusName {
+public:
+    explicit BusName(std::string_view name);
+
+    size_t width() const { return m_width; }
+
+    // Append bit `i` (modulo the width, so narrower nets repeat) to `out`
+    void append_bit(std::string& out, size_t i) const;
+    std::string bit(size_t i) const;
+
+private:
+    struct Segment {
+        std::string_view base;   // Whole text for a plain segment
+        long first = 0;
+        long step = 0;
+        size_t width = 1;
+        bool indexed = false;    // base[first + k * step]
+    };
+    std::string_view m_name;
+    std::vector<Segment> m_segments;  // Empty for a plain name
+    size_t m_width = 1;
+};
+
+// File access used by the parser for schematic and symbol files.
+// Replace it to add caching or remote storage. Must be thread-safe,
+// symbol files are looked up and read from worker threads.
+class FileProvider {
+public:
+    virtual ~FileProvider() = default;
+    virtual bool exists(const std::string& path) const;
+    virtual bool read(const std::string& path, std::string& content) const;
+};
+
+// Fixed-size pool of worker threads. Threads are started on first submit.
+class WorkerPool {
+public:
+    // Tasks of one submitter, so that several can share a pool and each
+    // wait for its own tasks only
+    struct Group {
+        size_t pending = 0;
+    };
+
+    explicit WorkerPool(unsigned threads) : m_max_threads(threads ? threads : 1) {}
+    ~WorkerPool();
+
+    void submit(std::function<void()> task, Group* group = nullptr);
+    void wait();              // Block until all submitted tasks have finished
+    void wait(Group& group);  // Block until the tasks of `group` have finished
+
+private:
+    struct Task {
+        std::function<void()> run;
+        Group* group;
+    };
+
+    unsigned m_max_threads;
+    std::vector<std::thread> m_threads;
+    std::deque<Task> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_task_cv;
+    std::condition_variable m_done_cv;
+    size_t m_pending = 0;
+    bool m_stop = false;
+
+    void worker();
+};
+
+// Records of a .sch/.sym file as streamed by parse_schematic_records. The
+// string_views point into the input buffer (braces stripped) and are only
+// valid during the callback.
+struct WireRecord {
+    double x1, y1, x2, y2;
+    std::string_view props;
+};
+
+struct InstanceRecord {
+    std::string_view symbol_name;
+    double x, y;
+    int rot, flip;
+    std::string_view props;
+};
+
+struct TextRecord {
+    std::string_view text;
+    double x, y;
+    int rot, flip;
+    double xscale, yscale;
+    std::string_view props;
+};
+
+struct BoxRecord {
+    int layer;
+    double x1, y1, x2, y2;
+    std::string_view props;
+};
+
+// L, A and P records (line, arc, polygon), reduced to their bounding box
+struct ShapeRecord {
+    char tag;               // 'L', 'A' or 'P'
+    int layer;
+    double x1, y1, x2, y2;
+    std::string_view props;
+};
+
+// Callbacks for parse_schematic_records. Override what you need; records a
+// visitor does not want are skipped without converting their fields.
+class SchematicVisitor {
+public:
+    virtual ~SchematicVisitor() = default;
+
+    virtual void on_header(char /*tag*/, std::string_view /*props*/) {}  // v, K, G, V, S, E
+    virtual void on_wire(const WireRecord& /*wire*/) {}
+    virtual void on_instance(const InstanceRecord& /*inst*/) {}
+    virtual void on_text(const TextRecord& /*text*/) {}
+    virtual void on_box(const BoxRecord& /*box*/) {}
+    virtual void on_shape(const ShapeRecord& /*shape*/) {}
+    // [ ... ] after a C record: the body of that instance's symbol, in
+    // .sym syntax (xschem writes it for the first instance with embed=true)
+    virtual void on_embedded_symbol(std::string_view /*content*/) {}
+
+    virtual bool wants_texts() const { return true; }
+    virtual bool wants_boxes() const { return false; }
+    virtual bool wants_shapes() const { return false; }
+};
+
+// Stream the records of .sch/.sym content to a visitor, without building
+// any container. Returns false on a malformed record (reported with its
+// line, `filename` is only used for the message); the records before it
+// have been delivered.
+bool parse_schematic_records(std::string_view input, SchematicVisitor& visitor,
+                             const std::string& filename = "");
+
+// Read a file (through `files`, or the default FileProvider) and stream its records
+bool scan_schematic(const std::string& filename, SchematicVisitor& visitor,
+                    const FileProvider* files = nullptr);
+
+// Which records SchematicParser::load keeps. Records that are not kept are
+// skipped without being copied out of the input.
+struct LoadOptions {
+    bool texts = true;          // T records in Schematic::texts
+    bool header_blocks = true;  // G/V/S/E property blocks (K is always kept)
+    bool merge_wires = false;   // normalize_wires() once symbols are loaded
+
+    // Everything, for snapshots and round trips
+    static LoadOptions full() { return LoadOptions(); }
+    // What --info reports: no G/V/S/E blocks
+    static LoadOptions info() { LoadOptions o; o.header_blocks = false; return o; }
+    // Wires, instances and symbols only
+    static LoadOptions netlist_only() { LoadOptions o; o.texts = false; o.header_blocks = false; return o; }
+};
 
 // Main parser class
 class SchematicParser {
 public:
-    SchematicParser() = default;
+    SchematicParser();
 
     // Load a schematic file
     bool load(const std::string& filename);
@@ -145,16 +491,50 @@ public:
     // Get the symbol file path
     std::string find_symbol_file(const std::string& symbol_name) const;
 
+    // Number of threads looking up and reading symbols while the schematic
+    // is parsed (0: load symbols one by one after parsing). The pool is
+    // started by the first load and kept for later ones.
+    void set_prefetch_threads(unsigned n) { m_prefetch_threads = n; m_pool.reset(); }
+
+    // Read symbols on `pool`, which may be shared with other parsers,
+    // instead of a pool of the parser's own (null, or a later
+    // set_prefetch_threads: back to its own)
+    void set_worker_pool(std::shared_ptr<WorkerPool> pool) { m_pool = std::move(pool); }
+
+    void set_file_provider(std::shared_ptr<const FileProvider> files) { m_files = std::move(files); }
+
+    void set_load_options(const LoadOptions& options) { m_options = options; }
+
 private:
     Schematic m_sch;
     std::vector<std::string> m_symbol_paths;
-
-    // Parse helpers
-    std::string read_braced_string(std::istream& in);
-    void parse_wire(std::istream& in);
-    void parse_instance(std::istream& in);
-    void parse_text(std::istream& in);
-    void parse_symbol_pin(std::istream& in, Symbol& sym);
+    std::shared_ptr<const FileProvider> m_files;
+    LoadOptions m_options;
+    unsigned m_prefetch_threads = 8;
+
+    // Symbols being fetched by worker threads during load(), in first-seen order
+    struct PrefetchSlot {
+        std::string name;
+        Symbol sym;
+        std::string path;
+    };
+    std::shared_ptr<WorkerPool> m_pool;
+    WorkerPool::Group m_prefetch_tasks;
+    bool m_prefetching = false;     // During load(), when symbols go to m_pool
+    std::deque<PrefetchSlot> m_prefetch;
+    std::unordered_set<std::string> m_prefetch_names;
+
+    // Builds m_sch from the streamed records
+    class LoadVisitor;
+
+    // Register the symbol embedded after the last instance read
+    void add_embedded_symbol(std::string_view content);
+
+    // Find, read and parse a symbol (thread-safe, does not touch m_sch.symbols)
+    bool fetch_symbol(const std::string& symbol_name, Symbol& sym, std::string& sym_path) const;
+    static Symbol placeholder_symbol(const std::string& symbol_name);
+    static void parse_symbol(std::string_view content, Symbol& sym, const std::string& path);
+    void prefetch_symbol(const std::string& symbol_name);
 };
 
 // Net connectivity resolver
@@ -162,13 +542,29 @@ class NetResolver {
 public:
     explicit NetResolver(Schematic& sch) : m_sch(sch) {}
 
-    // Resolve all net connections
+    // Resolve all net connections and fill Schematic::erc
     void resolve();
 
 private:
+    // A point where wire ends and instance pins meet. Points are numbered
+    // as first met, wire ends in wire order and then pins in instance order,
+    // and every pass walks them by number so unnamed nets are numbered the
+    // same whatever the hash order.
+    struct ConnectionPoint {
+        Point at;
+        std::vector<int> wires;
+        std::vector<std::pair<int, int>> pins;  // (instance, pin)
+    };
+
     Schematic& m_sch;
-    std::unordered_map<Point, std::vector<int>, PointHash> m_wire_endpoints;
-    std::unordered_map<Point, std::vector<std::pair<int, int>>, PointHash> m_inst_pins;
+    std::unordered_map<Point, uint32_t, PointHash> m_point_ids;
+    std::vector<ConnectionPoint> m_points;
+    std::vector<uint32_t> m_wire_points;    // Per wire: points of both ends
+    std::vector<uint32_t> m_pin_points;     // Per pin of each instance...
+    std::vector<uint32_t> m_pin_first;      // ...from m_pin_first[instance]
+    std::vector<const Symbol*> m_symbols;   // Per instance, nullptr if not loaded
+    std::vector<std::string> m_labels;      // Per instance: lab of labels and pins
+    uint64_t m_hash_lookups = 0;  // Reported to xschem_stats after resolve()
 
     // Union-Find for net grouping
     std::vector<int> m_parent;
@@ -176,8 +572,80 @@ private:
     void unite(int x, int y);
 
     void collect_connection_points();
+    void unite_wires();
     void assign_net_names();
-    std::string get_label_at(const Point& p);
+    uint32_t point_id(const Point& p);
+    std::string get_label_at(uint32_t point);
+    void report(ErcViolation::Kind kind, const Point& at, std::string message);
+};
+
+// Net names of a resolved schematic, expanded to single bits and interned
+// once so that every netlist format writes the same names without
+// re-deriving them. Also classifies instances: ports, and elements (the
+// instances a netlist writes; labels, pins and title blocks are not).
+// Only elements have pins in the table.
+class NetTable {
+public:
+    struct Port {
+        std::string name;   // One bit ("D[3]")
+        char dir;           // 'I', 'O' or 'B'
+        uint32_t net;
+    };
+
+    explicit NetTable(const Schematic& sch);
+
+    const std::string& net(uint32_t id) const { return m_nets[id]; }
+    size_t net_count() const { return m_nets.size(); }
+    const std::vector<Port>& ports() const { return m_ports; }
+
+    // nullptr if the instance's symbol was not loaded
+    const Symbol* symbol(size_t inst) const { return m_symbols[inst]; }
+    bool is_element(size_t inst) const { return m_elements[inst]; }
+    // Elements other than simulator commands
+    bool is_device(size_t inst) const {
+        return m_elements[inst] && symbol_kind_traits(m_symbols[inst]->kind).device;
+    }
+    size_t copies(size_t inst) const { return m_copies[inst]; }
+
+    size_t pin_count(size_t inst) const {
+        return m_pin_first[inst + 1] - m_pin_first[inst];
+    }
+    size_t pin_width(size_t inst, size_t pin) const {
+        return m_pin_width[m_pin_first[inst] + pin];
+    }
+    // Net of bit `b` of a pin on copy `copy` of an instance array. A pin
+    // of width w on copy c takes net bits c*w .. c*w+w-1, wrapping so that
+    // a narrower net is shared by all copies.
+    uint32_t pin_net(size_t inst, size_t pin, size_t copy, size_t b) const {
+        size_t p = m_pin_first[inst] + pin;
+        size_t first = m_net_first[p];
+        size_t width = m_net_first[p + 1] - first;
+        return m_pin_nets[first + (copy * m_pin_width[p] + b) % width];
+    }
+
+private:
+    std::vector<std::string> m_nets;
+    std::vector<Port> m_ports;
+    std::vector<const Symbol*> m_symbols;
+    std::vector<bool> m_elements;
+    std::vector<uint32_t> m_copies;
+    // Per instance pin ranges, then per pin net bit ranges (CSR)
+    std::vector<uint32_t> m_pin_first;
+    std::vector<uint32_t> m_pin_width;
+    std::vector<uint32_t> m_net_first;
+    std::vector<uint32_t> m_pin_nets;
+};
+
+// Property overrides for one netlist variant of a sweep
+struct PropOverride {
+    std::string instance;   // Instance name, "*" for all instances
+    std::string prop;
+    std::string value;
+};
+
+struct SweepVariant {
+    std::string name;
+    std::vector<PropOverride> overrides;
 };
 
 // SPICE netlist generator
@@ -189,34 +657,113 @@ public:
     bool generate(const std::string& output_file);
     bool generate(std::ostream& out);
 
+    // Sweeps: prepare_sweep() resolves and formats the base netlist once;
+    // generate_variant() then re-formats only the instances the variant
+    // overrides. generate_variant() is const and may run on several
+    // threads at once.
+    bool prepare_sweep();
+    bool generate_variant(const SweepVariant& variant, std::ostream& out) const;
+
     // Options
     void set_subcircuit_mode(bool v) { m_subcircuit_mode = v; }
     void set_top_cell_name(const std::string& name) { m_top_cell_name = name; }
+    // Replace expression values ('W/nf * 0.29', or a property holding one)
+    // by their numeric value for each instance
+    void set_evaluate_expressions(bool v) { m_evaluate = v; }
+    // Use a net table shared with other emitters; it must outlive the
+    // netlister. Without one, the netlister builds its own.
+    void set_net_table(const NetTable* nets) { m_nets = nets; }
+
+    // Line of one copy of an element with its pin nets left out, for
+    // writers that name the nets themselves (FlatDesign): the nets go
+    // between `before` and `after`. False if the instance is not netlisted.
+    bool split_element(size_t index, size_t copy, std::string& before, std::string& after);
 
 private:
+    using PropOverrides = std::unordered_map<std::string, std::string>;
+    using LineParams = std::vector<std::pair<std::string_view, std::string_view>>;
+
     Schematic& m_sch;
     bool m_subcircuit_mode = true;
     std::string m_top_cell_name;
-
-    std::string expand_format(const Instance& inst, const Symbol& sym);
-    std::string translate_prop(const Instance& inst, const std::string& prop_name);
-    bool is_pin_symbol(const std::string& type) const;
-    bool is_label_symbol(const std::string& type) const;
+    bool m_evaluate = false;
+    mutable ExpressionCache m_expressions;
+    const NetTable* m_nets = nullptr;
+    std::unique_ptr<NetTable> m_own_nets;
+
+    // Base netlist for sweeps
+    bool m_sweep_ready = false;
+    std::string m_base_header;
+    std::vector<std::string> m_base_lines;  // Per instance, "" if not emitted
+    std::unordered_map<std::string, std::vector<size_t>> m_instance_index;
+
+    void write_header(std::ostream& out) const;
+    void write_footer(std::ostream& out) const;
+    void format_instance(size_t index, std::string& out,
+                         const PropOverrides* overrides = nullptr) const;
+    void prepare();  // Resolve and build the net table if needed
+
+    // `bit` selects one instance of an instance array ("X[15:0]").
+    // With mark_pins, @pinlist is written as a single pin_marker.
+    static constexpr char pin_marker = '\x01';
+    std::string expand_format(size_t index, const Symbol& sym, size_t bit = 0,
+                              const PropOverrides* overrides = nullptr,
+                              bool mark_pins = false) const;
+    std::string translate_prop(const Instance& inst, const std::string& prop_name,
+                               const PropOverrides* overrides = nullptr) const;
+    bool evaluate_expression(std::string_view text, const Instance& inst,
+                             const PropOverrides* overrides, const LineParams* line,
+                             int depth, double& value) const;
+    std::string evaluate_line(const std::string& line, const Instance& inst,
+                              const PropOverrides* overrides) const;
 };
 
 // Main API - convenience functions
 bool load_schematic(const std::string& filename, Schematic& sch,
-                    const std::vector<std::string>& symbol_paths = {});
+                    const std::vector<std::string>& symbol_paths = {},
+                    const LoadOptions& options = LoadOptions::full());
 
 bool generate_spice_netlist(Schematic& sch, const std::string& output_file,
-                            bool subcircuit_mode = true);
+                            bool subcircuit_mode = true, bool evaluate = false);
 
 bool generate_spice_netlist(Schematic& sch, std::ostream& out,
-                            bool subcircuit_mode = true);
+                            bool subcircuit_mode = true, bool evaluate = false);
+
+// Write a make-compatible dependency file ("target: dep1 dep2 ...").
+// deps[0] is the primary input. With phony_targets, an empty rule is added
+// for every other dependency so that deleting a symbol does not break the
+// build (like gcc -MP, which also leaves out the main source).
+bool write_depfile(const std::string& depfile, const std::string& target,
+                   const std::vector<std::string>& deps,
+                   bool phony_targets = false);
+
+// Resolved xschemrc configuration
+struct XschemrcConfig {
+    std::vector<std::string> library_paths;           // Resolved XSCHEM_LIBRARY_PATH entries
+    std::map<std::string, std::string> variables;     // Tcl variables after evaluation
+    std::map<std::string, std::string> environment;   // Environment values the result depends on
+                                                      // (PDK_ROOT, PDK, HOME, XSCHEM_SHAREDIR, ...)
+};
+
+// Evaluate an xschemrc file. If cache_dir is not empty, the result is kept in
+// a snapshot file there and reused, without reading the xschemrc or probing
+// any directory, while the xschemrc mtime/size and the environment values in
+// XschemrcConfig::environment are unchanged. Library directories are not
+// re-checked: one created or removed since the snapshot was written is not
+// noticed until the xschemrc changes (or without cache_dir). Nothing is
+// written unless cache_dir is given.
+bool load_xschemrc(const std::string& xschemrc_path, XschemrcConfig& config,
+                   const std::string& cache_dir = "");
+
+// Default snapshot directory: $XSCHEM_LITE_CACHE_DIR, else
+// $XDG_CACHE_HOME/xschem_lite, else $HOME/.cache/xschem_lite ("" if none)
+std::string default_xschemrc_cache_dir();
 
 // Parse xschemrc file and extract XSCHEM_LIBRARY_PATH entries
-// Returns a vector of resolved symbol search paths
-std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path);
+// Returns a vector of resolved symbol search paths. With use_cache, the
+// snapshot in default_xschemrc_cache_dir() is used and written.
+std::vector<std::string> parse_xschemrc(const std::string& xschemrc_path,
+                                        bool use_cache = false);
 
 } // namespace xschem
 
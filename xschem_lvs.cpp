@@ -0,0 +1,715 @@
+// xschem_lvs.cpp - SPICE netlist reader and structural comparison (LVS-lite)
+// Implementation file
+
+#include "xschem_lvs.h"
+#include "xschem_expr.h"
+#include "xschem_trace.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+namespace xschem {
+
+namespace {
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+std::string lower(std::string_view s) {
+    std::string out(s);
+    for (char& c : out) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return out;
+}
+
+// Quoted values ('...', "...", {...}) stay one token; '=' is a token of
+// its own so that "w = 1" and "w=1" read the same
+std::vector<std::string> tokenize(std::string_view stmt) {
+    std::vector<std::string> tokens;
+    size_t pos = 0;
+    while (pos < stmt.size()) {
+        char c = stmt[pos];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pos++;
+            continue;
+        }
+        size_t start = pos;
+        if (c == '=') {
+            pos++;
+        } else if (c == '\'' || c == '"' || c == '{') {
+            char close = c == '{' ? '}' : c;
+            size_t end = stmt.find(close, pos + 1);
+            pos = end == std::string_view::npos ? stmt.size() : end + 1;
+        } else {
+            while (pos < stmt.size() && !std::isspace(static_cast<unsigned char>(stmt[pos])) &&
+                   stmt[pos] != '=') {
+                pos++;
+            }
+        }
+        tokens.push_back(lower(stmt.substr(start, pos - start)));
+    }
+    return tokens;
+}
+
+bool looks_like_value(const std::string& token) {
+    double v;
+    return parse_spice_number(token, v) || token[0] == '\'' || token[0] == '{' || token[0] == '"';
+}
+
+void parse_element(const std::vector<std::string>& tokens, int line, SpiceCircuit& circuit) {
+    SpiceDevice dev;
+    dev.name = tokens[0];
+    dev.line = line;
+
+    // Positional fields, then key=value parameters ("ad= as=": empty ad)
+    std::vector<std::string> positional;
+    for (size_t i = 1; i < tokens.size();) {
+        if (tokens[i] == "=" || tokens[i] == "params:") {
+            i++;
+        } else if (i + 1 < tokens.size() && tokens[i + 1] == "=") {
+            bool has_value = i + 2 < tokens.size() && tokens[i + 2] != "=" &&
+                             !(i + 3 < tokens.size() && tokens[i + 3] == "=");
+            dev.params.emplace_back(tokens[i], has_value ? tokens[i + 2] : "");
+            i += has_value ? 3 : 2;
+        } else {
+            positional.push_back(tokens[i++]);
+        }
+    }
+
+    const char kind = dev.name[0];
+    if (kind == 'x' || kind == 'm' || kind == 'd' || kind == 'q' || kind == 'j') {
+        // Nodes, then the model or subcircuit name
+        if (!positional.empty()) {
+            dev.type = positional.back();
+            positional.pop_back();
+        }
+        dev.nets = std::move(positional);
+    } else {
+        // Two nodes (four for controlled sources), then the value
+        size_t nodes = (kind == 'e' || kind == 'g') ? 4 : 2;
+        nodes = std::min(nodes, positional.size());
+        dev.nets.assign(positional.begin(), positional.begin() + nodes);
+        size_t next = nodes;
+        dev.type = std::string(1, kind);
+        if ((kind == 'r' || kind == 'c' || kind == 'l') && next < positional.size() &&
+            !looks_like_value(positional[next])) {
+            dev.type = positional[next++];   // Model resistor/capacitor
+        }
+        std::string value;
+        for (size_t i = next; i < positional.size(); i++) {
+            if (!value.empty()) value += ' ';
+            value += positional[i];
+        }
+        if (!value.empty()) dev.params.emplace_back("value", value);
+    }
+
+    std::stable_sort(dev.params.begin(), dev.params.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    circuit.devices.push_back(std::move(dev));
+}
+
+// ============================================================================
+// Matching
+// ============================================================================
+
+uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t hash_string(std::string_view s) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : s) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ULL;
+    }
+    return mix64(h);
+}
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+// Pins with the same role are interchangeable: MOS drain/source, the two
+// terminals of R/C/L
+uint32_t pin_role(const SpiceDevice& dev, size_t pin) {
+    const char kind = dev.name[0];
+    if (kind == 'm' && pin == 2) return 0;
+    if ((kind == 'r' || kind == 'c' || kind == 'l') && pin < 2) return 0;
+    return static_cast<uint32_t>(pin);
+}
+
+// Both circuits as one graph: devices of side 0, devices of side 1, nets
+// of side 0, nets of side 1. Edges join a device to the net on each pin.
+struct Graph {
+    const SpiceCircuit* circuit[2];
+    uint32_t dev_first[3];      // Vertex ranges
+    uint32_t net_first[3];
+    std::vector<std::string> net_names;        // By vertex - net_first[0]
+    std::vector<bool> net_is_port;
+    std::vector<uint32_t> adj_first;
+    std::vector<uint32_t> adj_vertex;
+    std::vector<uint32_t> adj_role;
+
+    uint32_t vertex_count() const { return net_first[2]; }
+    bool is_device(uint32_t v) const { return v < dev_first[2]; }
+    int side(uint32_t v) const {
+        return is_device(v) ? (v >= dev_first[1] ? 1 : 0) : (v >= net_first[1] ? 1 : 0);
+    }
+    const SpiceDevice& device(uint32_t v) const {
+        int s = side(v);
+        return circuit[s]->devices[v - dev_first[s]];
+    }
+    const std::string& net_name(uint32_t v) const { return net_names[v - net_first[0]]; }
+};
+
+void build_graph(const SpiceCircuit& a, const SpiceCircuit& b, Graph& g) {
+    g.circuit[0] = &a;
+    g.circuit[1] = &b;
+    g.dev_first[0] = 0;
+    g.dev_first[1] = static_cast<uint32_t>(a.devices.size());
+    g.dev_first[2] = g.dev_first[1] + static_cast<uint32_t>(b.devices.size());
+
+    // Net vertices per side: ports first, then in order of appearance
+    std::vector<std::pair<uint32_t, uint32_t>> edges;   // device vertex, net vertex
+    std::vector<uint32_t> roles;
+    g.net_first[0] = g.dev_first[2];
+    for (int s = 0; s < 2; s++) {
+        const SpiceCircuit& c = *g.circuit[s];
+        std::unordered_map<std::string, uint32_t> ids;
+        ids.reserve(c.ports.size() + c.devices.size());
+        auto net_id = [&](const std::string& name, bool port) {
+            auto [it, inserted] = ids.try_emplace(name, g.net_first[s] + static_cast<uint32_t>(ids.size()));
+            if (inserted) {
+                g.net_names.push_back(name);
+                g.net_is_port.push_back(port);
+            }
+            return it->second;
+        };
+        for (const auto& port : c.ports) net_id(port, true);
+        for (size_t d = 0; d < c.devices.size(); d++) {
+            const SpiceDevice& dev = c.devices[d];
+            for (size_t p = 0; p < dev.nets.size(); p++) {
+                edges.emplace_back(g.dev_first[s] + static_cast<uint32_t>(d), net_id(dev.nets[p], false));
+                roles.push_back(pin_role(dev, p));
+            }
+        }
+        g.net_first[s + 1] = g.net_first[s] + static_cast<uint32_t>(ids.size());
+    }
+
+    // Undirected CSR adjacency
+    const uint32_t n = g.vertex_count();
+    g.adj_first.assign(n + 1, 0);
+    for (const auto& [d, net] : edges) {
+        g.adj_first[d + 1]++;
+        g.adj_first[net + 1]++;
+    }
+    for (uint32_t v = 0; v < n; v++) g.adj_first[v + 1] += g.adj_first[v];
+    g.adj_vertex.resize(g.adj_first[n]);
+    g.adj_role.resize(g.adj_first[n]);
+    std::vector<uint32_t> fill(g.adj_first.begin(), g.adj_first.end() - 1);
+    for (size_t e = 0; e < edges.size(); e++) {
+        auto [d, net] = edges[e];
+        g.adj_vertex[fill[d]] = net;
+        g.adj_role[fill[d]++] = roles[e];
+        g.adj_vertex[fill[net]] = d;
+        g.adj_role[fill[net]++] = roles[e];
+    }
+}
+
+std::string strip_quotes(const std::string& v) {
+    if (v.size() >= 2 && ((v.front() == '\'' && v.back() == '\'') || (v.front() == '"' && v.back() == '"') ||
+                          (v.front() == '{' && v.back() == '}'))) {
+        return v.substr(1, v.size() - 2);
+    }
+    return v;
+}
+
+// Parameter value as compared: 1e6, 1meg and '1000000' are the same
+std::string normalize_value(const std::string& value) {
+    std::string v = strip_quotes(value);
+    double number;
+    if (parse_spice_number(v, number)) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%.9g", number);
+        return buf;
+    }
+    v.erase(std::remove_if(v.begin(), v.end(), [](unsigned char c) { return std::isspace(c); }), v.end());
+    return v;
+}
+
+// Partition refinement over the joint graph. A vertex's signature is the
+// sum of hash(role, class of neighbour) over its edges, kept up to date
+// incrementally, so a class change costs the degree of the vertex that
+// moved. Each round splits classes by signature; only vertices whose
+// signature changed are looked at. A class holding one vertex of each side
+// is a match and is frozen: it no longer splits, so a difference between
+// the netlists stays next to where it is instead of spreading through the
+// refinement.
+class Matcher {
+public:
+    // Devices flagged in `anchored` start in a class of their own name
+    Matcher(const Graph& g, const LvsOptions& options, const std::vector<bool>& anchored = {}) : m_g(g) {
+        const uint32_t n = g.vertex_count();
+        m_class.assign(n, 0);
+        m_pos.assign(n, 0);
+        m_sig.assign(n, 0);
+        m_stamp.assign(n, 0);
+
+        // Initial classes: device type, pin count and (normalized)
+        // parameters; ports and named nets by name, other nets all alike
+        std::vector<std::pair<uint64_t, uint32_t>> keys(n);
+        for (uint32_t v = 0; v < n; v++) {
+            uint64_t key;
+            if (g.is_device(v) && v < anchored.size() && anchored[v]) {
+                key = hash_string("dev:" + g.device(v).name);
+            } else if (g.is_device(v)) {
+                const SpiceDevice& dev = g.device(v);
+                key = mix64(hash_string(dev.type) ^ dev.nets.size());
+                if (options.compare_params) {
+                    for (const auto& [name, value] : dev.params) {
+                        key = mix64(key ^ hash_string(name) ^ mix64(hash_string(normalize_value(value))));
+                    }
+                }
+            } else {
+                const std::string& name = g.net_name(v);
+                bool named = g.net_is_port[v - g.net_first[0]] ||
+                             (options.match_net_names && !is_generated_net_name(name));
+                key = named ? hash_string("net:" + name) : hash_string("net");
+            }
+            keys[v] = {key, v};
+        }
+        std::sort(keys.begin(), keys.end());
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (i == 0 || keys[i].first != keys[i - 1].first) new_class(false, 0);
+            add_member(static_cast<uint32_t>(m_classes.size() - 1), keys[i].second);
+        }
+        for (uint32_t c = 0; c < m_classes.size(); c++) queue_ambiguous(c);
+
+        for (uint32_t v = 0; v < n; v++) {
+            for (uint32_t e = g.adj_first[v]; e < g.adj_first[v + 1]; e++) {
+                m_sig[v] += edge_hash(g.adj_role[e], m_class[g.adj_vertex[e]]);
+            }
+            m_dirty.push_back(v);
+        }
+    }
+
+    void run() {
+        refine();
+        break_ties();
+    }
+
+    // The matched vertex of the other side, or kNone
+    uint32_t partner(uint32_t v) const {
+        const Class& cls = m_classes[m_class[v]];
+        if (!matched(cls)) return kNone;
+        return cls.members[0] == v ? cls.members[1] : cls.members[0];
+    }
+
+private:
+    // Classes still holding vertices of both sides are symmetric (or hold
+    // extra vertices of one side): pair one member of each side and refine
+    // again. Device classes go first: a device carries more than a net
+    // (type, parameters).
+    void break_ties() {
+        size_t next[2] = {0, 0};
+        for (;;) {
+            int kind = next[0] < m_ambiguous[0].size() ? 0 : next[1] < m_ambiguous[1].size() ? 1 : -1;
+            if (kind < 0) break;
+            uint32_t c = m_ambiguous[kind][next[kind]];
+            if (!ambiguous(c)) {
+                next[kind]++;
+                continue;
+            }
+            uint32_t pick[2] = {kNone, kNone};
+            for (uint32_t v : m_classes[c].members) {
+                if (pick[m_g.side(v)] == kNone) pick[m_g.side(v)] = v;
+                if (pick[0] != kNone && pick[1] != kNone) break;
+            }
+            uint32_t pair = new_class(true, m_classes[c].sig);
+            for (uint32_t v : pick) move(v, pair);
+            refine();
+        }
+    }
+
+    struct Class {
+        std::vector<uint32_t> members;
+        uint32_t count[2] = {0, 0};
+        uint64_t sig = 0;
+        bool has_sig = false;     // All members share `sig`
+    };
+
+    const Graph& m_g;
+    std::vector<Class> m_classes;
+    std::vector<uint32_t> m_class;
+    std::vector<uint32_t> m_pos;        // Index in the class member list
+    std::vector<uint64_t> m_sig;
+    std::vector<uint32_t> m_dirty;      // Signature changed
+    std::vector<uint32_t> m_stamp;
+    uint32_t m_round = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> m_moved;   // Vertex, old class
+    std::vector<uint32_t> m_ambiguous[2];    // Device classes, net classes
+    static uint64_t edge_hash(uint32_t role, uint32_t cls) {
+        return mix64((static_cast<uint64_t>(role) << 32) ^ cls);
+    }
+
+    static bool matched(const Class& cls) { return cls.count[0] == 1 && cls.count[1] == 1; }
+
+    bool ambiguous(uint32_t c) const {
+        const Class& cls = m_classes[c];
+        return cls.count[0] && cls.count[1] && cls.members.size() > 2;
+    }
+
+    void queue_ambiguous(uint32_t c) {
+        if (ambiguous(c)) m_ambiguous[m_g.is_device(m_classes[c].members[0]) ? 0 : 1].push_back(c);
+    }
+
+    uint32_t new_class(bool has_sig, uint64_t sig) {
+        m_classes.emplace_back();
+        m_classes.back().has_sig = has_sig;
+        m_classes.back().sig = sig;
+        return static_cast<uint32_t>(m_classes.size() - 1);
+    }
+
+    void add_member(uint32_t c, uint32_t v) {
+        m_class[v] = c;
+        m_pos[v] = static_cast<uint32_t>(m_classes[c].members.size());
+        m_classes[c].members.push_back(v);
+        m_classes[c].count[m_g.side(v)]++;
+    }
+
+    void move(uint32_t v, uint32_t c) {
+        Class& from = m_classes[m_class[v]];
+        uint32_t last = from.members.back();
+        from.members[m_pos[v]] = last;
+        m_pos[last] = m_pos[v];
+        from.members.pop_back();
+        from.count[m_g.side(v)]--;
+        m_moved.emplace_back(v, m_class[v]);
+        add_member(c, v);
+    }
+
+    // Propagate class changes to neighbour signatures
+    void flush_moves() {
+        m_round++;
+        for (auto [v, old_class] : m_moved) {
+            for (uint32_t e = m_g.adj_first[v]; e < m_g.adj_first[v + 1]; e++) {
+                uint32_t u = m_g.adj_vertex[e];
+                m_sig[u] += edge_hash(m_g.adj_role[e], m_class[v]) - edge_hash(m_g.adj_role[e], old_class);
+                if (m_stamp[u] != m_round) {
+                    m_stamp[u] = m_round;
+                    m_dirty.push_back(u);
+                }
+            }
+        }
+        m_moved.clear();
+    }
+
+    void refine() {
+        flush_moves();
+        std::vector<uint32_t> dirty;
+        while (!m_dirty.empty()) {
+            dirty.swap(m_dirty);
+            m_dirty.clear();
+            std::sort(dirty.begin(), dirty.end(), [&](uint32_t a, uint32_t b) {
+                return m_class[a] != m_class[b] ? m_class[a] < m_class[b] : m_sig[a] < m_sig[b];
+            });
+            for (size_t i = 0; i < dirty.size();) {
+                uint32_t c = m_class[dirty[i]];
+                size_t end = i;
+                while (end < dirty.size() && m_class[dirty[end]] == c) end++;
+                if (!matched(m_classes[c])) split(c, dirty, i, end);
+                i = end;
+            }
+            flush_moves();
+        }
+    }
+
+    // Split class c by the signatures of its dirty members dirty[begin, end)
+    // (sorted by signature). Members that are not dirty keep the class's
+    // signature and its id.
+    void split(uint32_t c, const std::vector<uint32_t>& dirty, size_t begin, size_t end) {
+        struct Group { size_t begin, end; };
+        std::vector<Group> groups;
+        size_t changed = 0;
+        for (size_t i = begin; i < end;) {
+            size_t j = i;
+            while (j < end && m_sig[dirty[j]] == m_sig[dirty[i]]) j++;
+            if (!m_classes[c].has_sig || m_sig[dirty[i]] != m_classes[c].sig) {
+                groups.push_back({i, j});
+                changed += j - i;
+            }
+            i = j;
+        }
+        if (groups.empty()) return;
+
+        // Largest group keeps the id if every member changed
+        size_t keep = groups.size();
+        if (changed == m_classes[c].members.size()) {
+            keep = 0;
+            for (size_t k = 1; k < groups.size(); k++) {
+                if (groups[k].end - groups[k].begin > groups[keep].end - groups[keep].begin) keep = k;
+            }
+            m_classes[c].sig = m_sig[dirty[groups[keep].begin]];
+            m_classes[c].has_sig = true;
+            if (groups.size() == 1) return;   // Signature changed, no split
+        }
+
+        for (size_t k = 0; k < groups.size(); k++) {
+            if (k == keep) continue;
+            uint32_t n = new_class(true, m_sig[dirty[groups[k].begin]]);
+            for (size_t i = groups[k].begin; i < groups[k].end; i++) move(dirty[i], n);
+            queue_ambiguous(n);
+        }
+    }
+};
+
+bool same_value(const std::string& a, const std::string& b, double tolerance) {
+    if (a == b) return true;
+    double u, v;
+    if (parse_spice_number(strip_quotes(a), u) && parse_spice_number(strip_quotes(b), v)) {
+        return std::fabs(u - v) <= tolerance * std::max(std::fabs(u), std::fabs(v));
+    }
+    return normalize_value(a) == normalize_value(b);
+}
+
+std::string describe_device(const SpiceDevice& dev) {
+    std::string s = dev.name + " " + dev.type + " (";
+    for (size_t i = 0; i < dev.nets.size(); i++) s += (i ? " " : "") + dev.nets[i];
+    return s + ")";
+}
+
+const char* side_name(int side) { return side == 0 ? "reference" : "generated"; }
+
+void compare_circuit(const SpiceCircuit& ref, const SpiceCircuit& gen, const LvsOptions& options,
+                     LvsReport& report) {
+    XSCHEM_TRACE_SCOPE("lvs_circuit", ref.name);
+    const std::string where = ref.name.empty() ? "top level" : ".subckt " + ref.name;
+    auto add = [&](const std::string& msg) { report.mismatches.push_back(where + ": " + msg); };
+
+    if (ref.ports != gen.ports) {
+        std::string a, b;
+        for (const auto& p : ref.ports) a += " " + p;
+        for (const auto& p : gen.ports) b += " " + p;
+        add("ports differ: reference" + a + " / generated" + b);
+    }
+
+    Graph g;
+    build_graph(ref, gen, g);
+    auto matcher = std::make_unique<Matcher>(g, options);
+    matcher->run();
+
+    // A device with a changed parameter or connection is left unmatched,
+    // and so are the nets around it. Match again with such devices paired
+    // by name (same name and type on both sides) to keep the report local.
+    std::vector<bool> anchored(g.dev_first[2], false);
+    std::unordered_map<std::string_view, uint32_t> unmatched;
+    for (uint32_t v = g.dev_first[1]; v < g.dev_first[2]; v++) {
+        if (matcher->partner(v) == kNone) unmatched.emplace(g.device(v).name, v);
+    }
+    bool rematch = false;
+    for (uint32_t v = g.dev_first[0]; v < g.dev_first[1]; v++) {
+        if (matcher->partner(v) != kNone) continue;
+        auto it = unmatched.find(g.device(v).name);
+        if (it != unmatched.end() && g.device(it->second).type == g.device(v).type) {
+            anchored[v] = anchored[it->second] = true;
+            rematch = true;
+        }
+    }
+    if (rematch) {
+        matcher = std::make_unique<Matcher>(g, options, anchored);
+        matcher->run();
+    }
+
+    // Unpaired vertices, in file order
+    for (uint32_t v = 0; v < g.vertex_count(); v++) {
+        if (matcher->partner(v) != kNone) continue;
+        int s = g.side(v);
+        if (g.is_device(v)) {
+            const SpiceDevice& dev = g.device(v);
+            add(std::string("device only in ") + side_name(s) + ":" + std::to_string(dev.line) +
+                ": " + describe_device(dev));
+        } else {
+            uint32_t degree = g.adj_first[v + 1] - g.adj_first[v];
+            add(std::string("net only in ") + side_name(s) + ": " + g.net_name(v) + " (" +
+                std::to_string(degree) + (degree == 1 ? " pin)" : " pins)"));
+        }
+    }
+
+    // Paired devices: connections (pairing of symmetric parts is a guess
+    // that is checked here) and parameters
+    std::vector<std::pair<uint32_t, uint32_t>> pins_a, pins_b;   // Role, paired net
+    for (uint32_t v = g.dev_first[0]; v < g.dev_first[1]; v++) {
+        uint32_t w = matcher->partner(v);
+        if (w == kNone) continue;
+        report.devices++;
+        const SpiceDevice& a = g.device(v);
+        const SpiceDevice& b = g.device(w);
+
+        pins_a.clear();
+        pins_b.clear();
+        for (uint32_t e = g.adj_first[v]; e < g.adj_first[v + 1]; e++) {
+            pins_a.emplace_back(g.adj_role[e], matcher->partner(g.adj_vertex[e]));
+        }
+        for (uint32_t e = g.adj_first[w]; e < g.adj_first[w + 1]; e++) {
+            pins_b.emplace_back(g.adj_role[e], g.adj_vertex[e]);
+        }
+        std::sort(pins_a.begin(), pins_a.end());
+        std::sort(pins_b.begin(), pins_b.end());
+        if (pins_a != pins_b) {
+            add("connections differ: reference:" + std::to_string(a.line) + ": " + describe_device(a) +
+                " / generated:" + std::to_string(b.line) + ": " + describe_device(b));
+        }
+
+        if (!options.compare_params) continue;
+        size_t i = 0, j = 0;
+        while (i < a.params.size() || j < b.params.size()) {
+            if (j == b.params.size() || (i < a.params.size() && a.params[i].first < b.params[j].first)) {
+                add(a.name + ": " + a.params[i].first + "=" + a.params[i].second + " only in reference");
+                i++;
+            } else if (i == a.params.size() || b.params[j].first < a.params[i].first) {
+                add(b.name + ": " + b.params[j].first + "=" + b.params[j].second + " only in generated");
+                j++;
+            } else {
+                if (!same_value(a.params[i].second, b.params[j].second, options.tolerance)) {
+                    add(a.name + ": " + a.params[i].first + "=" + a.params[i].second +
+                        " (reference) / " + b.params[j].second + " (generated)");
+                }
+                i++;
+                j++;
+            }
+        }
+    }
+    for (uint32_t v = g.net_first[0]; v < g.net_first[1]; v++) {
+        if (matcher->partner(v) != kNone) report.nets++;
+    }
+}
+
+} // namespace
+
+bool is_generated_net_name(std::string_view name) {
+    if (!name.empty() && name[0] == '#') name.remove_prefix(1);
+    if (name.size() >= 3 && (name.substr(0, 3) == "NC_" || name.substr(0, 3) == "nc_")) return true;
+    if (name.size() <= 3 || lower(name.substr(0, 3)) != "net") return false;
+    return std::all_of(name.begin() + 3, name.end(),
+                       [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+}
+
+bool parse_spice_netlist(std::string_view input, SpiceNetlist& netlist, const std::string& filename) {
+    netlist.circuits.clear();
+    netlist.circuits.emplace_back();
+    size_t current = 0;
+
+    // Logical statements: continuation lines joined, comments dropped
+    std::vector<std::pair<std::string, int>> statements;
+    size_t pos = 0;
+    int line_no = 0;
+    while (pos < input.size()) {
+        size_t eol = input.find('\n', pos);
+        if (eol == std::string_view::npos) eol = input.size();
+        std::string_view line = input.substr(pos, eol - pos);
+        pos = eol + 1;
+        line_no++;
+
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos || line[start] == '*') continue;
+        line.remove_prefix(start);
+        for (const char* marker : {";", " $ ", "\t$ "}) {
+            size_t cut = line.find(marker);
+            if (cut != std::string_view::npos) line = line.substr(0, cut);
+        }
+        if (line[0] == '+') {
+            if (statements.empty()) {
+                std::cerr << "Error: " << filename << ":" << line_no << ": Continuation line without a statement"
+                          << std::endl;
+                return false;
+            }
+            statements.back().first += ' ';
+            statements.back().first.append(line.substr(1));
+        } else {
+            statements.emplace_back(std::string(line), line_no);
+        }
+    }
+
+    for (const auto& [text, line] : statements) {
+        std::vector<std::string> tokens = tokenize(text);
+        if (tokens.empty()) continue;
+        if (tokens[0] == ".subckt") {
+            if (tokens.size() < 2) {
+                std::cerr << "Error: " << filename << ":" << line << ": .subckt without a name" << std::endl;
+                return false;
+            }
+            SpiceCircuit& c = netlist.circuits.emplace_back();
+            c.name = tokens[1];
+            c.line = line;
+            for (size_t i = 2; i < tokens.size(); i++) {
+                if (tokens[i] == "params:" || tokens[i] == "=" ||
+                    (i + 1 < tokens.size() && tokens[i + 1] == "=")) {
+                    break;
+                }
+                c.ports.push_back(tokens[i]);
+            }
+            current = netlist.circuits.size() - 1;
+        } else if (tokens[0] == ".ends") {
+            current = 0;
+        } else if (tokens[0][0] != '.') {
+            parse_element(tokens, line, netlist.circuits[current]);
+        }
+    }
+    return true;
+}
+
+bool read_spice_netlist(const std::string& path, SpiceNetlist& netlist) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open netlist: " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return parse_spice_netlist(buffer.str(), netlist, path);
+}
+
+LvsReport compare_spice_netlists(const SpiceNetlist& reference, const SpiceNetlist& generated,
+                                 const LvsOptions& options) {
+    XSCHEM_TRACE_SCOPE("lvs_compare");
+    LvsReport report;
+    static const SpiceCircuit empty;
+
+    auto find = [](const SpiceNetlist& n, const std::string& name) -> const SpiceCircuit* {
+        for (const auto& c : n.circuits) {
+            if (c.name == name) return &c;
+        }
+        return nullptr;
+    };
+
+    const SpiceCircuit& ref_top = reference.circuits.empty() ? empty : reference.circuits[0];
+    const SpiceCircuit& gen_top = generated.circuits.empty() ? empty : generated.circuits[0];
+    if (!ref_top.devices.empty() || !gen_top.devices.empty()) {
+        compare_circuit(ref_top, gen_top, options, report);
+    }
+
+    for (size_t i = 1; i < reference.circuits.size(); i++) {
+        const SpiceCircuit& ref = reference.circuits[i];
+        if (const SpiceCircuit* gen = find(generated, ref.name)) {
+            compare_circuit(ref, *gen, options, report);
+        } else {
+            report.mismatches.push_back(".subckt " + ref.name + ": only in reference");
+        }
+    }
+    for (size_t i = 1; i < generated.circuits.size(); i++) {
+        if (!find(reference, generated.circuits[i].name)) {
+            report.mismatches.push_back(".subckt " + generated.circuits[i].name + ": only in generated");
+        }
+    }
+    return report;
+}
+
+} // namespace xschem
@@ -0,0 +1,75 @@
+// xschem_lvs.h - SPICE netlist reader and structural comparison (LVS-lite)
+// Two netlists are compared as graphs of devices and nets rather than as
+// text: element order and automatically generated net names (net12,
+// #net3, NC_...) do not matter. Devices and nets of both netlists are
+// classified by iterative partition refinement: a vertex is hashed with the
+// classes of its neighbours (by pin role) and classes split until the
+// partition is stable. Only vertices whose neighbourhood changed are
+// rehashed, so a match costs about linear time. A class of one device or
+// net from each side is a match. Classes that stay ambiguous (symmetric
+// parts of the circuit) are split by pairing members, and every pairing is
+// checked pin by pin afterwards. Ports and named nets anchor the match by
+// name; device type and parameters are part of a device's initial class.
+
+#ifndef XSCHEM_LVS_H
+#define XSCHEM_LVS_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace xschem {
+
+// One element line. Names are lower case (SPICE is case insensitive).
+struct SpiceDevice {
+    std::string name;       // "xm1"
+    std::string type;       // Model or subcircuit name; the element letter
+                            // for value elements ("r", "c", "v", ...)
+    std::vector<std::string> nets;
+    std::vector<std::pair<std::string, std::string>> params;  // Sorted by key;
+                            // positional values of R/C/L/V/... are "value"
+    int line = 0;
+};
+
+struct SpiceCircuit {
+    std::string name;       // "" for the top level
+    std::vector<std::string> ports;
+    std::vector<SpiceDevice> devices;
+    int line = 0;
+};
+
+struct SpiceNetlist {
+    std::vector<SpiceCircuit> circuits;   // circuits[0] is the top level
+};
+
+// Continuation lines, comments (*, ; and $) and "key = value" spacing are
+// handled; control lines other than .subckt/.ends are ignored
+bool parse_spice_netlist(std::string_view input, SpiceNetlist& netlist,
+                         const std::string& filename = "");
+bool read_spice_netlist(const std::string& path, SpiceNetlist& netlist);
+
+struct LvsOptions {
+    bool compare_params = true;     // Parameter values of matched devices
+    bool match_net_names = true;    // Nets with user-given names must match by name
+    double tolerance = 1e-9;        // Relative, for numeric parameter values
+};
+
+struct LvsReport {
+    size_t devices = 0;             // Matched device pairs
+    size_t nets = 0;                // Matched net pairs
+    std::vector<std::string> mismatches;
+
+    bool equivalent() const { return mismatches.empty(); }
+};
+
+// Compare circuits of the same name (the top level included)
+LvsReport compare_spice_netlists(const SpiceNetlist& reference, const SpiceNetlist& generated,
+                                 const LvsOptions& options = LvsOptions());
+
+// True for names a netlister generates: net12, #net3, NC_M1_S
+bool is_generated_net_name(std::string_view name);
+
+} // namespace xschem
+
+#endif // XSCHEM_LVS_H
@@ -0,0 +1,410 @@
+// xschem_snapshot.cpp - Binary snapshot of a loaded and resolved schematic
+// Implementation file
+
+#include "xschem_snapshot.h"
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace xschem {
+
+using namespace snapshot;
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+namespace {
+
+class SnapshotWriter {
+public:
+    StrRef intern(const std::string& s) {
+        auto it = m_string_index.find(s);
+        if (it != m_string_index.end()) return it->second;
+        StrRef ref{static_cast<uint32_t>(m_strings.size()), static_cast<uint32_t>(s.size())};
+        m_strings.insert(m_strings.end(), s.begin(), s.end());
+        m_strings.push_back('\0');
+        m_string_index.emplace(s, ref);
+        return ref;
+    }
+
+    template <typename T>
+    void add(Section s, const T& rec) {
+        auto& buf = m_sections[s];
+        const char* p = reinterpret_cast<const char*>(&rec);
+        buf.insert(buf.end(), p, p + sizeof(T));
+        m_counts[s]++;
+    }
+
+    bool write(const std::string& path) {
+        m_sections[kStrings] = std::move(m_strings);
+        m_counts[kStrings] = m_sections[kStrings].size();
+
+        Header header{};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.byte_order = kByteOrderMark;
+
+        uint64_t offset = align(sizeof(Header));
+        for (uint32_t s = 0; s < kSectionCount; s++) {
+            header.sections[s].offset = offset;
+            header.sections[s].count = m_counts[s];
+            offset = align(offset + m_sections[s].size());
+        }
+        header.file_size = offset;
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Error: Cannot open snapshot file: " << path << std::endl;
+            return false;
+        }
+        write_padded(out, reinterpret_cast<const char*>(&header), sizeof(header));
+        for (uint32_t s = 0; s < kSectionCount; s++) {
+            write_padded(out, m_sections[s].data(), m_sections[s].size());
+        }
+        return out.good();
+    }
+
+private:
+    std::vector<char> m_strings;
+    std::unordered_map<std::string, StrRef> m_string_index;
+    std::vector<char> m_sections[kSectionCount];
+    uint64_t m_counts[kSectionCount] = {};
+
+    static uint64_t align(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+    static void write_padded(std::ofstream& out, const char* data, size_t size) {
+        static const char zeros[8] = {};
+        out.write(data, size);
+        out.write(zeros, align(size) - size);
+    }
+};
+
+} // namespace
+
+bool save_snapshot(const Schematic& sch, const std::string& path) {
+    SnapshotWriter w;
+
+    SchematicRec sch_rec{};
+    sch_rec.filename = w.intern(sch.filename);
+    sch_rec.version = w.intern(sch.version);
+    sch_rec.K_props = w.intern(sch.K_props);
+    sch_rec.G_props = w.intern(sch.G_props);
+    sch_rec.V_props = w.intern(sch.V_props);
+    sch_rec.S_props = w.intern(sch.S_props);
+    sch_rec.E_props = w.intern(sch.E_props);
+    sch_rec.unnamed_net_count = sch.unnamed_net_count;
+    sch_rec.resolved = sch.resolved ? 1 : 0;
+    w.add(kSchematic, sch_rec);
+
+    for (const auto& wire : sch.wires) {
+        WireRec rec{};
+        rec.x1 = wire.x1; rec.y1 = wire.y1;
+        rec.x2 = wire.x2; rec.y2 = wire.y2;
+        rec.node = w.intern(wire.node);
+        rec.props = w.intern(wire.props);
+        rec.is_bus = wire.is_bus ? 1 : 0;
+        w.add(kWires, rec);
+    }
+
+    uint32_t net_count = 0, prop_count = 0;
+    for (const auto& inst : sch.instances) {
+        InstanceRec rec{};
+        rec.x = inst.x; rec.y = inst.y;
+        rec.symbol_name = w.intern(inst.symbol_name);
+        rec.inst_name = w.intern(inst.inst_name);
+        rec.props = w.intern(inst.props);
+        rec.rot = inst.rot; rec.flip = inst.flip;
+        rec.first_net = net_count;
+        rec.net_count = static_cast<uint32_t>(inst.connected_nets.size());
+        rec.first_prop = prop_count;
+        rec.prop_count = static_cast<uint32_t>(inst.prop_map.size());
+        w.add(kInstances, rec);
+
+        for (const auto& net : inst.connected_nets) {
+            w.add(kNets, w.intern(net));
+        }
+        for (const auto& [key, value] : inst.prop_map) {
+            w.add(kProps, PropRec{w.intern(key), w.intern(value)});
+        }
+        net_count += rec.net_count;
+        prop_count += rec.prop_count;
+    }
+
+    for (const auto& text : sch.texts) {
+        TextRec rec{};
+        rec.x = text.x; rec.y = text.y;
+        rec.xscale = text.xscale; rec.yscale = text.yscale;
+        rec.text = w.intern(text.text);
+        rec.props = w.intern(text.props);
+        rec.rot = text.rot; rec.flip = text.flip;
+        w.add(kTexts, rec);
+    }
+
+    // Symbols sorted by name, for binary search and stable output
+    std::vector<const Symbol*> symbols;
+    for (const auto& [name, sym] : sch.symbols) symbols.push_back(&sym);
+    std::sort(symbols.begin(), symbols.end(),
+              [](const Symbol* a, const Symbol* b) { return a->name < b->name; });
+
+    uint32_t pin_count = 0;
+    for (const Symbol* sym : symbols) {
+        SymbolRec rec{};
+        rec.minx = sym->minx; rec.miny = sym->miny;
+        rec.maxx = sym->maxx; rec.maxy = sym->maxy;
+        rec.name = w.intern(sym->name);
+        rec.type = w.intern(sym->type);
+        rec.format = w.intern(sym->format);
+        rec.template_str = w.intern(sym->template_str);
+        rec.props = w.intern(sym->props);
+        rec.first_pin = pin_count;
+        rec.pin_count = static_cast<uint32_t>(sym->pins.size());
+        w.add(kSymbols, rec);
+
+        for (const auto& pin : sym->pins) {
+            w.add(kPins, PinRec{pin.x, pin.y, w.intern(pin.name), w.intern(pin.direction)});
+        }
+        pin_count += rec.pin_count;
+    }
+
+    std::vector<std::pair<std::string, int>> net_names(sch.net_names.begin(), sch.net_names.end());
+    std::sort(net_names.begin(), net_names.end());
+    for (const auto& [name, value] : net_names) {
+        w.add(kNetNames, NetNameRec{w.intern(name), value, 0});
+    }
+
+    for (const auto& dep : sch.dependencies) {
+        w.add(kDependencies, w.intern(dep));
+    }
+
+    return w.write(path);
+}
+
+bool is_snapshot_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+// ============================================================================
+// SnapshotView
+// ============================================================================
+
+SnapshotView::~SnapshotView() {
+    close();
+}
+
+void SnapshotView::close() {
+    if (m_data) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_header = nullptr;
+    m_strings = nullptr;
+    m_schematic = nullptr;
+}
+
+bool SnapshotView::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Cannot open snapshot: " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        std::cerr << "Error: Not a snapshot file: " << path << std::endl;
+        return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Error: Cannot map snapshot: " << path << std::endl;
+        return false;
+    }
+
+    m_data = static_cast<const char*>(data);
+    m_size = static_cast<size_t>(st.st_size);
+    m_header = reinterpret_cast<const Header*>(m_data);
+
+    if (!validate()) {
+        std::cerr << "Error: Invalid or incompatible snapshot: " << path << std::endl;
+        close();
+        return false;
+    }
+    m_strings = m_data + m_header->sections[kStrings].offset;
+    m_schematic = reinterpret_cast<const SchematicRec*>(m_data + m_header->sections[kSchematic].offset);
+    return true;
+}
+
+bool SnapshotView::validate() const {
+    const Header& h = *m_header;
+    if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0 || h.version != kVersion ||
+        h.byte_order != kByteOrderMark || h.file_size != m_size) {
+        return false;
+    }
+
+    static const size_t record_size[kSectionCount] = {
+        1, sizeof(SchematicRec), sizeof(WireRec), sizeof(InstanceRec), sizeof(TextRec),
+        sizeof(SymbolRec), sizeof(PinRec), sizeof(PropRec), sizeof(StrRef),
+        sizeof(NetNameRec), sizeof(StrRef)
+    };
+    for (uint32_t s = 0; s < kSectionCount; s++) {
+        const auto& rec = h.sections[s];
+        if (rec.offset % 8 != 0 || rec.offset > m_size ||
+            rec.count > (m_size - rec.offset) / record_size[s]) {
+            return false;
+        }
+    }
+    if (h.sections[kSchematic].count != 1) return false;
+
+    // Every string and record range must stay inside its section
+    const uint64_t pool_size = h.sections[kStrings].count;
+    const char* pool = m_data + h.sections[kStrings].offset;
+    auto str_ok = [&](StrRef r) {
+        return uint64_t(r.offset) + r.size < pool_size && pool[r.offset + r.size] == '\0';
+    };
+    auto range_ok = [&](uint32_t first, uint32_t count, Section s) {
+        return uint64_t(first) + count <= h.sections[s].count;
+    };
+
+    const auto& sr = *reinterpret_cast<const SchematicRec*>(m_data + h.sections[kSchematic].offset);
+    for (StrRef r : {sr.filename, sr.version, sr.K_props, sr.G_props, sr.V_props, sr.S_props, sr.E_props}) {
+        if (!str_ok(r)) return false;
+    }
+    for (const auto& w : section<WireRec>(kWires)) {
+        if (!str_ok(w.node) || !str_ok(w.props)) return false;
+    }
+    for (const auto& i : section<InstanceRec>(kInstances)) {
+        if (!str_ok(i.symbol_name) || !str_ok(i.inst_name) || !str_ok(i.props) ||
+            !range_ok(i.first_net, i.net_count, kNets) ||
+            !range_ok(i.first_prop, i.prop_count, kProps)) {
+            return false;
+        }
+    }
+    for (const auto& t : section<TextRec>(kTexts)) {
+        if (!str_ok(t.text) || !str_ok(t.props)) return false;
+    }
+    for (const auto& s : section<SymbolRec>(kSymbols)) {
+        if (!str_ok(s.name) || !str_ok(s.type) || !str_ok(s.format) ||
+            !str_ok(s.template_str) || !str_ok(s.props) ||
+            !range_ok(s.first_pin, s.pin_count, kPins)) {
+            return false;
+        }
+    }
+    for (const auto& p : section<PinRec>(kPins)) {
+        if (!str_ok(p.name) || !str_ok(p.direction)) return false;
+    }
+    for (const auto& p : section<PropRec>(kProps)) {
+        if (!str_ok(p.key) || !str_ok(p.value)) return false;
+    }
+    for (StrRef r : section<StrRef>(kNets)) {
+        if (!str_ok(r)) return false;
+    }
+    for (const auto& n : section<NetNameRec>(kNetNames)) {
+        if (!str_ok(n.name)) return false;
+    }
+    for (StrRef r : section<StrRef>(kDependencies)) {
+        if (!str_ok(r)) return false;
+    }
+    return true;
+}
+
+const SymbolRec* SnapshotView::find_symbol(std::string_view name) const {
+    auto syms = symbols();
+    auto it = std::lower_bound(syms.begin(), syms.end(), name,
+                               [this](const SymbolRec& s, std::string_view n) { return str(s.name) < n; });
+    if (it != syms.end() && str(it->name) == name) return it;
+    return nullptr;
+}
+
+void SnapshotView::to_schematic(Schematic& sch) const {
+    auto s = [this](StrRef r) { return std::string(str(r)); };
+
+    sch = Schematic();
+    const auto& sr = schematic();
+    sch.filename = s(sr.filename);
+    sch.version = s(sr.version);
+    sch.K_props = s(sr.K_props);
+    sch.G_props = s(sr.G_props);
+    sch.V_props = s(sr.V_props);
+    sch.S_props = s(sr.S_props);
+    sch.E_props = s(sr.E_props);
+    sch.unnamed_net_count = sr.unnamed_net_count;
+    sch.resolved = sr.resolved != 0;
+
+    sch.wires.reserve(wires().size());
+    for (const auto& rec : wires()) {
+        Wire w;
+        w.x1 = rec.x1; w.y1 = rec.y1;
+        w.x2 = rec.x2; w.y2 = rec.y2;
+        w.node = s(rec.node);
+        w.props = s(rec.props);
+        w.is_bus = rec.is_bus != 0;
+        sch.wires.push_back(std::move(w));
+    }
+
+    sch.instances.reserve(instances().size());
+    for (const auto& rec : instances()) {
+        Instance inst;
+        inst.symbol_name = s(rec.symbol_name);
+        inst.inst_name = s(rec.inst_name);
+        inst.x = rec.x; inst.y = rec.y;
+        inst.rot = rec.rot; inst.flip = rec.flip;
+        inst.props = s(rec.props);
+        inst.connected_nets.reserve(rec.net_count);
+        for (StrRef net : nets(rec)) inst.connected_nets.push_back(s(net));
+        for (const auto& prop : props(rec)) inst.prop_map.set(s(prop.key), s(prop.value));
+        sch.instances.push_back(std::move(inst));
+    }
+
+    sch.texts.reserve(texts().size());
+    for (const auto& rec : texts()) {
+        Text t;
+        t.text = s(rec.text);
+        t.x = rec.x; t.y = rec.y;
+        t.rot = rec.rot; t.flip = rec.flip;
+        t.xscale = rec.xscale; t.yscale = rec.yscale;
+        t.props = s(rec.props);
+        sch.texts.push_back(std::move(t));
+    }
+
+    for (const auto& rec : symbols()) {
+        Symbol sym;
+        sym.name = s(rec.name);
+        sym.type = s(rec.type);
+        sym.format = s(rec.format);
+        sym.template_str = s(rec.template_str);
+        sym.props = s(rec.props);
+        sym.minx = rec.minx; sym.miny = rec.miny;
+        sym.maxx = rec.maxx; sym.maxy = rec.maxy;
+        for (const auto& pin : pins(rec)) {
+            sym.pins.push_back({s(pin.name), s(pin.direction), pin.x, pin.y});
+        }
+        classify_symbol(sym);
+        sch.symbols.emplace(sym.name, std::move(sym));
+    }
+
+    for (const auto& rec : net_names()) {
+        sch.net_names.emplace(s(rec.name), rec.value);
+    }
+    for (StrRef dep : dependencies()) {
+        sch.dependencies.push_back(s(dep));
+    }
+    if (sch.resolved) sch.net_index.build(sch);
+}
+
+bool load_snapshot(const std::string& path, Schematic& sch) {
+    SnapshotView view;
+    if (!view.open(path)) return false;
+    view.to_schematic(sch);
+    return true;
+}
+
+} // namespace xschem
@@ -0,0 +1,186 @@
+// xschem_snapshot.h - Binary snapshot of a loaded and resolved schematic
+// A snapshot holds instances, wires, texts, symbols, connected nets and net
+// names in a versioned layout of fixed-size records plus one string pool.
+// It can be memory-mapped and read in place (SnapshotView), without
+// re-parsing the .sch or re-running NetResolver. Netlisting still needs a
+// Schematic, which load_snapshot() builds by copying the records.
+
+#ifndef XSCHEM_SNAPSHOT_H
+#define XSCHEM_SNAPSHOT_H
+
+#include "xschem_lite.h"
+#include <cstdint>
+#include <string_view>
+
+namespace xschem {
+
+namespace snapshot {
+
+constexpr char kMagic[8] = {'X', 'S', 'L', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+// Reference to a NUL-terminated string in the string pool
+struct StrRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+enum Section : uint32_t {
+    kStrings,       // char, string pool
+    kSchematic,     // SchematicRec (exactly one)
+    kWires,         // WireRec
+    kInstances,     // InstanceRec
+    kTexts,         // TextRec
+    kSymbols,       // SymbolRec, sorted by name
+    kPins,          // PinRec, referenced by SymbolRec
+    kProps,         // PropRec, referenced by InstanceRec
+    kNets,          // StrRef, connected nets referenced by InstanceRec
+    kNetNames,      // NetNameRec
+    kDependencies,  // StrRef
+    kSectionCount
+};
+
+struct SectionRec {
+    uint64_t offset;  // From start of file, 8-byte aligned
+    uint64_t count;   // Number of records (bytes for kStrings)
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t file_size;
+    SectionRec sections[kSectionCount];
+};
+
+struct SchematicRec {
+    StrRef filename, version;
+    StrRef K_props, G_props, V_props, S_props, E_props;
+    int32_t unnamed_net_count;
+    uint32_t resolved;
+};
+
+struct WireRec {
+    double x1, y1, x2, y2;
+    StrRef node, props;
+    uint32_t is_bus;
+    uint32_t reserved;
+};
+
+struct InstanceRec {
+    double x, y;
+    StrRef symbol_name, inst_name, props;
+    int32_t rot, flip;
+    uint32_t first_net, net_count;    // Range in kNets
+    uint32_t first_prop, prop_count;  // Range in kProps
+};
+
+struct TextRec {
+    double x, y, xscale, yscale;
+    StrRef text, props;
+    int32_t rot, flip;
+};
+
+struct SymbolRec {
+    double minx, miny, maxx, maxy;
+    StrRef name, type, format, template_str, props;
+    uint32_t first_pin, pin_count;  // Range in kPins
+};
+
+struct PinRec {
+    double x, y;
+    StrRef name, direction;
+};
+
+struct PropRec {
+    StrRef key, value;
+};
+
+struct NetNameRec {
+    StrRef name;
+    int32_t value;
+    uint32_t reserved;
+};
+
+} // namespace snapshot
+
+// Write a snapshot of the schematic (resolve it first to include nets)
+bool save_snapshot(const Schematic& sch, const std::string& path);
+
+// True if the file starts with the snapshot magic
+bool is_snapshot_file(const std::string& path);
+
+// Read-only view of a memory-mapped snapshot file
+class SnapshotView {
+public:
+    SnapshotView() = default;
+    ~SnapshotView();
+    SnapshotView(const SnapshotView&) = delete;
+    SnapshotView& operator=(const SnapshotView&) = delete;
+
+    // Map and validate a snapshot file
+    bool open(const std::string& path);
+    void close();
+
+    std::string_view str(snapshot::StrRef ref) const {
+        return std::string_view(m_strings + ref.offset, ref.size);
+    }
+
+    const snapshot::SchematicRec& schematic() const { return *m_schematic; }
+
+    template <typename T>
+    struct Range {
+        const T* first;
+        size_t count;
+        const T* begin() const { return first; }
+        const T* end() const { return first + count; }
+        size_t size() const { return count; }
+        const T& operator[](size_t i) const { return first[i]; }
+    };
+
+    Range<snapshot::WireRec> wires() const { return section<snapshot::WireRec>(snapshot::kWires); }
+    Range<snapshot::InstanceRec> instances() const { return section<snapshot::InstanceRec>(snapshot::kInstances); }
+    Range<snapshot::TextRec> texts() const { return section<snapshot::TextRec>(snapshot::kTexts); }
+    Range<snapshot::SymbolRec> symbols() const { return section<snapshot::SymbolRec>(snapshot::kSymbols); }
+    Range<snapshot::NetNameRec> net_names() const { return section<snapshot::NetNameRec>(snapshot::kNetNames); }
+    Range<snapshot::StrRef> dependencies() const { return section<snapshot::StrRef>(snapshot::kDependencies); }
+
+    Range<snapshot::StrRef> nets(const snapshot::InstanceRec& inst) const {
+        return {section<snapshot::StrRef>(snapshot::kNets).first + inst.first_net, inst.net_count};
+    }
+    Range<snapshot::PropRec> props(const snapshot::InstanceRec& inst) const {
+        return {section<snapshot::PropRec>(snapshot::kProps).first + inst.first_prop, inst.prop_count};
+    }
+    Range<snapshot::PinRec> pins(const snapshot::SymbolRec& sym) const {
+        return {section<snapshot::PinRec>(snapshot::kPins).first + sym.first_pin, sym.pin_count};
+    }
+
+    // Binary search in the name-sorted symbol table (nullptr if missing)
+    const snapshot::SymbolRec* find_symbol(std::string_view name) const;
+
+    // Copy the snapshot into a Schematic (marked resolved if it was saved so)
+    void to_schematic(Schematic& sch) const;
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    const snapshot::Header* m_header = nullptr;
+    const char* m_strings = nullptr;
+    const snapshot::SchematicRec* m_schematic = nullptr;
+
+    template <typename T>
+    Range<T> section(snapshot::Section s) const {
+        const auto& rec = m_header->sections[s];
+        return {reinterpret_cast<const T*>(m_data + rec.offset), static_cast<size_t>(rec.count)};
+    }
+    bool validate() const;
+};
+
+// Load a snapshot file into a Schematic (a full copy of its records; a
+// snapshot saved after resolving is not resolved again by the netlisters)
+bool load_snapshot(const std::string& path, Schematic& sch);
+
+} // namespace xschem
+
+#endif // XSCHEM_SNAPSHOT_H
@@ -0,0 +1,231 @@
+// xschem_spatial.cpp - Rectangle and nearest-neighbour queries over a schematic
+// Implementation file
+
+#include "xschem_spatial.h"
+#include "xschem_stats.h"
+#include "xschem_trace.h"
+#include <queue>
+
+namespace xschem {
+
+namespace {
+
+// Position of (x, y) on a Hilbert curve filling a 65536 x 65536 grid
+uint64_t hilbert_index(uint32_t x, uint32_t y) {
+    const uint32_t n = 1u << 16;
+    uint64_t d = 0;
+    for (uint32_t s = n / 2; s > 0; s /= 2) {
+        uint32_t rx = (x & s) ? 1 : 0;
+        uint32_t ry = (y & s) ? 1 : 0;
+        d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = n - 1 - x;
+                y = n - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
+Rect bounding(const Rect& a, const Rect& b) {
+    return {std::min(a.x1, b.x1), std::min(a.y1, b.y1), std::max(a.x2, b.x2), std::max(a.y2, b.y2)};
+}
+
+// Text extent per character, in units of the text's x/y scale
+constexpr double text_char_width = 24;
+constexpr double text_line_height = 40;
+
+} // namespace
+
+// ============================================================================
+// PackedRTree
+// ============================================================================
+
+void PackedRTree::build(const std::vector<Rect>& boxes) {
+    m_count = boxes.size();
+    m_boxes.clear();
+    m_indices.clear();
+    m_level_end.clear();
+    if (boxes.empty()) return;
+
+    // Hilbert order of the box centres over the total extent
+    Rect extent = boxes[0];
+    for (const auto& b : boxes) extent = bounding(extent, b);
+    const double sx = extent.x2 > extent.x1 ? 65535.0 / (extent.x2 - extent.x1) : 0;
+    const double sy = extent.y2 > extent.y1 ? 65535.0 / (extent.y2 - extent.y1) : 0;
+    std::vector<std::pair<uint64_t, uint32_t>> order(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++) {
+        const Rect& b = boxes[i];
+        auto hx = static_cast<uint32_t>(((b.x1 + b.x2) / 2 - extent.x1) * sx);
+        auto hy = static_cast<uint32_t>(((b.y1 + b.y2) / 2 - extent.y1) * sy);
+        order[i] = {hilbert_index(hx, hy), static_cast<uint32_t>(i)};
+    }
+    std::sort(order.begin(), order.end());
+
+    const size_t total = m_count + m_count / (node_size - 1) + 2;
+    m_boxes.reserve(total);
+    m_indices.reserve(total);
+    for (const auto& [key, i] : order) {
+        m_boxes.push_back(boxes[i]);
+        m_indices.push_back(i);
+    }
+    m_level_end.push_back(m_boxes.size());
+
+    // Each level holds the bounds of node_size consecutive entries below
+    size_t begin = 0, end = m_boxes.size();
+    while (end - begin > 1) {
+        for (size_t i = begin; i < end; i += node_size) {
+            Rect r = m_boxes[i];
+            for (size_t j = i + 1; j < std::min(i + node_size, end); j++) r = bounding(r, m_boxes[j]);
+            m_boxes.push_back(r);
+            m_indices.push_back(static_cast<uint32_t>(i));
+        }
+        begin = end;
+        end = m_boxes.size();
+        m_level_end.push_back(end);
+    }
+}
+
+size_t PackedRTree::level_end(size_t node) const {
+    return *std::upper_bound(m_level_end.begin(), m_level_end.end(), node);
+}
+
+void PackedRTree::search(const Rect& area, std::vector<uint32_t>& out) const {
+    if (m_count == 0) return;
+    std::vector<size_t> stack;
+    size_t node = m_boxes.size() - 1;   // Root
+    for (;;) {
+        const size_t end = std::min(node + node_size, level_end(node));
+        for (size_t pos = node; pos < end; pos++) {
+            if (!area.intersects(m_boxes[pos])) continue;
+            if (node < m_count) {
+                out.push_back(m_indices[pos]);
+            } else {
+                stack.push_back(m_indices[pos]);
+            }
+        }
+        if (stack.empty()) break;
+        node = stack.back();
+        stack.pop_back();
+    }
+}
+
+uint32_t PackedRTree::nearest(double x, double y, double max_distance) const {
+    if (m_count == 0) return npos;
+    const double max2 = max_distance * max_distance;
+
+    // Best first: nodes and leaf boxes by distance; the first leaf box
+    // taken off the queue is the nearest. Low bit set = leaf position.
+    using Entry = std::pair<double, size_t>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+    size_t node = m_boxes.size() - 1;
+    for (;;) {
+        const size_t end = std::min(node + node_size, level_end(node));
+        for (size_t pos = node; pos < end; pos++) {
+            double d = m_boxes[pos].distance2(x, y);
+            if (d > max2) continue;
+            queue.emplace(d, node < m_count ? pos << 1 | 1 : static_cast<size_t>(m_indices[pos]) << 1);
+        }
+        if (queue.empty()) return npos;
+        size_t top = queue.top().second;
+        if (top & 1) return m_indices[top >> 1];
+        queue.pop();
+        node = top >> 1;
+    }
+}
+
+// ============================================================================
+// SpatialIndex
+// ============================================================================
+
+Rect instance_bounds(const Schematic& sch, const Instance& inst) {
+    auto sym_it = sch.symbols.find(inst.symbol_name);
+    if (sym_it == sch.symbols.end()) return {inst.x, inst.y, inst.x, inst.y};
+    const Symbol& sym = sym_it->second;
+    Point a = instance_point(inst, sym.minx, sym.miny);
+    Point b = instance_point(inst, sym.maxx, sym.maxy);
+    return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)};
+}
+
+Rect text_bounds(const Text& text) {
+    size_t columns = 0, lines = 1, column = 0;
+    for (char c : text.text) {
+        if (c == '\n') {
+            lines++;
+            column = 0;
+        } else {
+            columns = std::max(columns, ++column);
+        }
+    }
+    Point a = transform_point(text.rot, text.flip, text.x, text.y, 0, 0);
+    Point b = transform_point(text.rot, text.flip, text.x, text.y,
+                              columns * text_char_width * text.xscale,
+                              lines * text_line_height * text.yscale);
+    return {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x), std::max(a.y, b.y)};
+}
+
+SpatialIndex::SpatialIndex(const Schematic& sch) {
+    XSCHEM_TRACE_SCOPE("spatial_index", sch.filename);
+    m_bounds.reserve(sch.wires.size() + sch.instances.size() + sch.texts.size());
+    for (const auto& w : sch.wires) {
+        m_bounds.push_back({std::min(w.x1, w.x2), std::min(w.y1, w.y2), std::max(w.x1, w.x2), std::max(w.y1, w.y2)});
+    }
+
+    m_first_instance = static_cast<uint32_t>(m_bounds.size());
+    std::vector<Rect> pin_boxes;
+    for (size_t i = 0; i < sch.instances.size(); i++) {
+        const Instance& inst = sch.instances[i];
+        m_bounds.push_back(instance_bounds(sch, inst));
+        auto sym_it = sch.symbols.find(inst.symbol_name);
+        if (sym_it == sch.symbols.end()) continue;
+        const auto& pins = sym_it->second.pins;
+        for (size_t p = 0; p < pins.size(); p++) {
+            Point at = instance_point(inst, pins[p].x, pins[p].y);
+            m_pin_refs.emplace_back(static_cast<uint32_t>(i), static_cast<uint32_t>(p));
+            m_pin_points.push_back(at);
+            pin_boxes.push_back({at.x, at.y, at.x, at.y});
+        }
+    }
+    stat_add(&Stats::hash_lookups, 2 * sch.instances.size());
+
+    m_first_text = static_cast<uint32_t>(m_bounds.size());
+    for (const auto& t : sch.texts) m_bounds.push_back(text_bounds(t));
+
+    m_objects.build(m_bounds);
+    m_pins.build(pin_boxes);
+}
+
+SpatialIndex::Object SpatialIndex::object(uint32_t item) const {
+    if (item < m_first_instance) return {Kind::Wire, item};
+    if (item < m_first_text) return {Kind::Instance, item - m_first_instance};
+    return {Kind::Text, item - m_first_text};
+}
+
+std::vector<SpatialIndex::Object> SpatialIndex::query(const Rect& area) const {
+    std::vector<uint32_t> items;
+    m_objects.search(area, items);
+    std::sort(items.begin(), items.end());
+    std::vector<Object> result;
+    result.reserve(items.size());
+    for (uint32_t item : items) result.push_back(object(item));
+    return result;
+}
+
+bool SpatialIndex::nearest(double x, double y, Object& hit, double max_distance) const {
+    uint32_t item = m_objects.nearest(x, y, max_distance);
+    if (item == PackedRTree::npos) return false;
+    hit = object(item);
+    return true;
+}
+
+bool SpatialIndex::nearest_pin(double x, double y, PinHit& hit, double max_distance) const {
+    uint32_t item = m_pins.nearest(x, y, max_distance);
+    if (item == PackedRTree::npos) return false;
+    const Point& at = m_pin_points[item];
+    hit = {m_pin_refs[item].first, m_pin_refs[item].second, at, std::hypot(at.x - x, at.y - y)};
+    return true;
+}
+
+} // namespace xschem
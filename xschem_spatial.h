@@ -0,0 +1,113 @@
+// xschem_spatial.h - Rectangle and nearest-neighbour queries over a schematic
+// Objects are held in a packed Hilbert R-tree, bulk loaded once: boxes are
+// sorted along a Hilbert curve through their centres and grouped 16 to a
+// node, level by level, in one flat array. A query visits O(log n) nodes
+// plus the ones holding its results; there are no per-node allocations.
+//
+// Instances are indexed by their symbol's bounding box (pins and graphics,
+// see Symbol) placed with the instance's rot/flip, wires by their segment
+// and texts by an estimate of their extent from length and scale.
+
+#ifndef XSCHEM_SPATIAL_H
+#define XSCHEM_SPATIAL_H
+
+#include "xschem_lite.h"
+#include <limits>
+
+namespace xschem {
+
+struct Rect {
+    double x1, y1, x2, y2;  // x1 <= x2, y1 <= y2
+
+    bool intersects(const Rect& o) const {
+        return x1 <= o.x2 && o.x1 <= x2 && y1 <= o.y2 && o.y1 <= y2;
+    }
+    // Squared distance from a point (0 inside)
+    double distance2(double x, double y) const {
+        double dx = x < x1 ? x1 - x : x > x2 ? x - x2 : 0;
+        double dy = y < y1 ? y1 - y : y > y2 ? y - y2 : 0;
+        return dx * dx + dy * dy;
+    }
+};
+
+// Static R-tree over boxes numbered 0..n-1
+class PackedRTree {
+public:
+    static constexpr size_t node_size = 16;
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    void build(const std::vector<Rect>& boxes);
+
+    size_t size() const { return m_count; }
+    // Appends the boxes intersecting `area` (edges included)
+    void search(const Rect& area, std::vector<uint32_t>& out) const;
+    // Box nearest to (x, y) within max_distance, npos if none
+    uint32_t nearest(double x, double y,
+                     double max_distance = std::numeric_limits<double>::infinity()) const;
+
+private:
+    size_t m_count = 0;
+    std::vector<Rect> m_boxes;          // Leaves in Hilbert order, then each level up
+    std::vector<uint32_t> m_indices;    // Leaf: box number; node: first child
+    std::vector<size_t> m_level_end;
+
+    size_t level_end(size_t node) const;
+};
+
+class SpatialIndex {
+public:
+    enum class Kind : uint8_t { Wire, Instance, Text };
+
+    struct Object {
+        Kind kind;
+        uint32_t index;     // Into Schematic::wires, instances or texts
+
+        bool operator==(const Object&) const = default;
+    };
+
+    struct PinHit {
+        uint32_t inst;
+        uint32_t pin;       // Index into the symbol's pins
+        Point at;
+        double distance;
+    };
+
+    explicit SpatialIndex(const Schematic& sch);
+
+    // Objects whose bounds intersect `area`, wires first, then instances
+    // and texts, each in index order
+    std::vector<Object> query(const Rect& area) const;
+    // Object whose bounds are nearest to (x, y); false if none within max_distance
+    bool nearest(double x, double y, Object& hit,
+                 double max_distance = std::numeric_limits<double>::infinity()) const;
+    bool nearest_pin(double x, double y, PinHit& hit,
+                     double max_distance = std::numeric_limits<double>::infinity()) const;
+
+    // The world-space bounds an object is indexed by
+    const Rect& bounds(const Object& object) const { return m_bounds[item(object)]; }
+    size_t size() const { return m_bounds.size(); }
+
+private:
+    PackedRTree m_objects;
+    PackedRTree m_pins;
+    std::vector<Rect> m_bounds;         // Wires, then instances, then texts
+    std::vector<std::pair<uint32_t, uint32_t>> m_pin_refs;   // Instance, pin
+    std::vector<Point> m_pin_points;
+    uint32_t m_first_instance = 0;
+    uint32_t m_first_text = 0;
+
+    uint32_t item(const Object& object) const {
+        return object.index + (object.kind == Kind::Wire ? 0 :
+                               object.kind == Kind::Instance ? m_first_instance : m_first_text);
+    }
+    Object object(uint32_t item) const;
+};
+
+// World-space bounds of one instance (its position alone if the symbol
+// was not loaded) and an estimate for a text
+Rect instance_bounds(const Schematic& sch, const Instance& inst);
+Rect text_bounds(const Text& text);
+
+} // namespace xschem
+
+#endif // XSCHEM_SPATIAL_H
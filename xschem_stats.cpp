@@ -0,0 +1,95 @@
+// xschem_stats.cpp - Per-stage metrics for xschem_lite runs
+// Implementation file
+
+#include "xschem_stats.h"
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+
+namespace xschem {
+
+thread_local Stats* t_current_stats = nullptr;
+
+const char* stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::XschemrcParse: return "xschemrc_parse";
+        case Stage::SchParse:      return "sch_parse";
+        case Stage::SymbolLookup:  return "symbol_lookup";
+        case Stage::SymbolParse:   return "symbol_parse";
+        case Stage::WireMerge:     return "wire_merge";
+        case Stage::Connectivity:  return "connectivity";
+        case Stage::UnionFind:     return "union_find";
+        case Stage::Naming:        return "naming";
+        case Stage::NetIndex:      return "net_index";
+        case Stage::Emission:      return "emission";
+        case Stage::Count:         break;
+    }
+    return "unknown";
+}
+
+void Stats::reset() {
+    for (auto& v : stage_ns) v = 0;
+    for (auto& v : stage_calls) v = 0;
+    files_opened = 0;
+    exists_probes = 0;
+    hash_lookups = 0;
+    allocations = 0;
+    allocated_bytes = 0;
+}
+
+StatsReport Stats::report() const {
+    StatsReport r;
+    for (size_t i = 0; i < kStageCount; i++) {
+        r.stage_ms[i] = static_cast<double>(stage_ns[i].load()) / 1e6;
+        r.stage_calls[i] = stage_calls[i].load();
+    }
+    r.files_opened = files_opened.load();
+    r.exists_probes = exists_probes.load();
+    r.hash_lookups = hash_lookups.load();
+    r.allocations = allocations.load();
+    r.allocated_bytes = allocated_bytes.load();
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        r.peak_rss_kb = usage.ru_maxrss;
+    }
+    return r;
+}
+
+void print_stats(std::ostream& out, const StatsReport& report) {
+    std::ios_base::fmtflags flags = out.flags();
+    out << "=== Stats ===\n";
+    out << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < kStageCount; i++) {
+        out << "  " << std::setw(16) << std::left << stage_name(static_cast<Stage>(i))
+            << std::setw(12) << std::right << report.stage_ms[i] << " ms"
+            << std::setw(10) << report.stage_calls[i] << " calls\n";
+    }
+    out << "  " << std::setw(16) << std::left << "files_opened" << report.files_opened << "\n";
+    out << "  " << std::setw(16) << std::left << "exists_probes" << report.exists_probes << "\n";
+    out << "  " << std::setw(16) << std::left << "hash_lookups" << report.hash_lookups << "\n";
+    out << "  " << std::setw(16) << std::left << "allocations" << report.allocations << "\n";
+    out << "  " << std::setw(16) << std::left << "allocated_bytes" << report.allocated_bytes << "\n";
+    out << "  " << std::setw(16) << std::left << "peak_rss_kb" << report.peak_rss_kb << "\n";
+    out.flags(flags);
+}
+
+std::string stats_to_json(const StatsReport& report) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"stages\": {";
+    for (size_t i = 0; i < kStageCount; i++) {
+        out << (i ? "," : "") << "\n    \"" << stage_name(static_cast<Stage>(i)) << "\": {\"ms\": "
+            << report.stage_ms[i] << ", \"calls\": " << report.stage_calls[i] << "}";
+    }
+    out << "\n  },\n";
+    out << "  \"files_opened\": " << report.files_opened << ",\n";
+    out << "  \"exists_probes\": " << report.exists_probes << ",\n";
+    out << "  \"hash_lookups\": " << report.hash_lookups << ",\n";
+    out << "  \"allocations\": " << report.allocations << ",\n";
+    out << "  \"allocated_bytes\": " << report.allocated_bytes << ",\n";
+    out << "  \"peak_rss_kb\": " << report.peak_rss_kb << "\n}\n";
+    return out.str();
+}
+
+} // namespace xschem
@@ -0,0 +1,115 @@
+// xschem_stats.h - Per-stage metrics for xschem_lite runs
+// Wall time per stage plus I/O, hash lookup and allocation counters.
+// Collection is per thread: bind a Stats object with StatsScope and every
+// library call made on that thread (and the worker threads it starts)
+// records into it. With nothing bound, recording is a thread-local load
+// and a branch.
+
+#ifndef XSCHEM_STATS_H
+#define XSCHEM_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace xschem {
+
+enum class Stage {
+    XschemrcParse,  // load_xschemrc / parse_xschemrc
+    SchParse,       // .sch tokenizing in SchematicParser::load
+    SymbolLookup,   // find_symbol_file
+    SymbolParse,    // Reading and parsing .sym files
+    WireMerge,      // normalize_wires
+    Connectivity,   // NetResolver: collecting wire ends and pin points
+    UnionFind,      // NetResolver: grouping wires
+    Naming,         // NetResolver: assigning net names to wires and pins
+    NetIndex,       // NetIndex::build: per-net pin and wire lists
+    Emission,       // Netlist writing
+    Count
+};
+
+constexpr size_t kStageCount = static_cast<size_t>(Stage::Count);
+
+const char* stage_name(Stage stage);
+
+// Plain copy of the counters, with peak RSS filled in
+struct StatsReport {
+    std::array<double, kStageCount> stage_ms{};
+    std::array<uint64_t, kStageCount> stage_calls{};
+    uint64_t files_opened = 0;
+    uint64_t exists_probes = 0;
+    uint64_t hash_lookups = 0;
+    uint64_t allocations = 0;      // Only counted when xschem_alloc_stats.o is linked
+    uint64_t allocated_bytes = 0;
+    long peak_rss_kb = 0;          // Whole process
+};
+
+// Counters for one job. Updated atomically: stages running on several
+// threads (symbol prefetch) add up their thread time.
+struct Stats {
+    std::array<std::atomic<uint64_t>, kStageCount> stage_ns{};
+    std::array<std::atomic<uint64_t>, kStageCount> stage_calls{};
+    std::atomic<uint64_t> files_opened{0};
+    std::atomic<uint64_t> exists_probes{0};
+    std::atomic<uint64_t> hash_lookups{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> allocated_bytes{0};
+
+    void reset();
+    StatsReport report() const;
+};
+
+// Stats bound to the calling thread (nullptr if none)
+extern thread_local Stats* t_current_stats;
+
+inline Stats* current_stats() { return t_current_stats; }
+
+// Bind stats to the current thread for the lifetime of the scope
+class StatsScope {
+public:
+    explicit StatsScope(Stats* stats) : m_previous(t_current_stats) { t_current_stats = stats; }
+    ~StatsScope() { t_current_stats = m_previous; }
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+
+private:
+    Stats* m_previous;
+};
+
+inline void stat_add(std::atomic<uint64_t> Stats::*counter, uint64_t n = 1) {
+    if (Stats* s = t_current_stats) (s->*counter).fetch_add(n, std::memory_order_relaxed);
+}
+
+// Adds the scope's wall time to a stage
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : m_stats(t_current_stats), m_stage(stage) {
+        if (m_stats) m_start = std::chrono::steady_clock::now();
+    }
+    ~StageTimer() {
+        if (!m_stats) return;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start).count();
+        size_t i = static_cast<size_t>(m_stage);
+        m_stats->stage_ns[i].fetch_add(static_cast<uint64_t>(ns), std::memory_order_relaxed);
+        m_stats->stage_calls[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    Stats* m_stats;
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Human-readable table and JSON object
+void print_stats(std::ostream& out, const StatsReport& report);
+std::string stats_to_json(const StatsReport& report);
+
+} // namespace xschem
+
+#endif // XSCHEM_STATS_H
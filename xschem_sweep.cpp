@@ -0,0 +1,364 @@
+// xschem_sweep.cpp - Parameter sweeps over one loaded schematic
+// Implementation file
+
+#include "xschem_sweep.h"
+#include "xschem_stats.h"
+#include "xschem_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+namespace xschem {
+
+namespace {
+
+// "<inst>.<prop>"; the property is after the last dot so that hierarchical
+// instance names keep theirs
+bool split_column(const std::string& column, PropOverride& ov) {
+    size_t dot = column.rfind('.');
+    if (dot == std::string::npos || dot == 0 || dot + 1 == column.size()) return false;
+    ov.instance = column.substr(0, dot);
+    ov.prop = column.substr(dot + 1);
+    return true;
+}
+
+// Variant names become part of file names
+std::string file_safe(const std::string& name) {
+    std::string result = name;
+    for (char& c : result) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') {
+            c = '_';
+        }
+    }
+    return result;
+}
+
+// One CSV record; quoted fields may contain commas, "" and newlines.
+// Returns false at end of input.
+bool next_csv_row(std::string_view input, size_t& pos, std::vector<std::string>& fields,
+                  bool& bad_quote) {
+    fields.clear();
+    if (pos >= input.size()) return false;
+
+    std::string field;
+    bool quoted = false;
+    while (pos < input.size()) {
+        char c = input[pos++];
+        if (quoted) {
+            if (c == '"') {
+                if (pos < input.size() && input[pos] == '"') {
+                    field += '"';
+                    pos++;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == '"' && field.empty()) {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(trim(field));
+            field.clear();
+        } else if (c == '\n') {
+            break;
+        } else if (c != '\r') {
+            field += c;
+        }
+    }
+    bad_quote = quoted;
+    fields.push_back(trim(field));
+    return true;
+}
+
+// Minimal JSON reader for sweep tables: an array of flat objects with
+// string, number or boolean values
+class JsonTableReader {
+public:
+    JsonTableReader(std::string_view input, const std::string& filename)
+        : m_in(input), m_filename(filename) {}
+
+    bool read(std::vector<SweepVariant>& variants) {
+        if (!expect('[')) return false;
+        skip_ws();
+        if (peek() == ']') {
+            m_pos++;
+            return finish();
+        }
+        while (true) {
+            SweepVariant variant;
+            if (!read_object(variant)) return false;
+            if (variant.name.empty()) variant.name = std::to_string(variants.size());
+            variants.push_back(std::move(variant));
+            skip_ws();
+            if (peek() == ',') {
+                m_pos++;
+                continue;
+            }
+            if (!expect(']')) return false;
+            return finish();
+        }
+    }
+
+private:
+    std::string_view m_in;
+    const std::string& m_filename;
+    size_t m_pos = 0;
+
+    char peek() const { return m_pos < m_in.size() ? m_in[m_pos] : '\0'; }
+
+    void skip_ws() {
+        while (m_pos < m_in.size() && std::isspace(static_cast<unsigned char>(m_in[m_pos]))) m_pos++;
+    }
+
+    bool error(const char* what) {
+        size_t line = 1 + std::count(m_in.begin(), m_in.begin() + std::min(m_pos, m_in.size()), '\n');
+        std::cerr << "Error: " << m_filename << ":" << line << ": " << what << std::endl;
+        return false;
+    }
+
+    bool expect(char c) {
+        skip_ws();
+        if (peek() != c) {
+            std::string msg = std::string("Expected '") + c + "'";
+            return error(msg.c_str());
+        }
+        m_pos++;
+        return true;
+    }
+
+    bool finish() {
+        skip_ws();
+        return m_pos == m_in.size() || error("Trailing data after sweep table");
+    }
+
+    bool read_string(std::string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (m_pos < m_in.size()) {
+            char c = m_in[m_pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_in.size()) break;
+            char e = m_in[m_pos++];
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (m_pos + 4 > m_in.size()) return error("Bad \\u escape");
+                    unsigned cp = 0;
+                    for (int i = 0; i < 4; i++) {
+                        char h = m_in[m_pos++];
+                        cp <<= 4;
+                        if (h >= '0' && h <= '9') cp |= h - '0';
+                        else if (h >= 'a' && h <= 'f') cp |= h - 'a' + 10;
+                        else if (h >= 'A' && h <= 'F') cp |= h - 'A' + 10;
+                        else return error("Bad \\u escape");
+                    }
+                    // Basic multilingual plane only; sweep values are ASCII in practice
+                    if (cp < 0x80) {
+                        out += static_cast<char>(cp);
+                    } else if (cp < 0x800) {
+                        out += static_cast<char>(0xC0 | (cp >> 6));
+                        out += static_cast<char>(0x80 | (cp & 0x3F));
+                    } else {
+                        out += static_cast<char>(0xE0 | (cp >> 12));
+                        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                        out += static_cast<char>(0x80 | (cp & 0x3F));
+                    }
+                    break;
+                }
+                default: out += e; break;  // \" \\ \/
+            }
+        }
+        return error("Unterminated string");
+    }
+
+    // Numbers and booleans are kept as written
+    bool read_value(std::string& out) {
+        skip_ws();
+        if (peek() == '"') return read_string(out);
+        size_t start = m_pos;
+        while (m_pos < m_in.size() && m_in[m_pos] != ',' && m_in[m_pos] != '}' &&
+               !std::isspace(static_cast<unsigned char>(m_in[m_pos]))) {
+            m_pos++;
+        }
+        out = std::string(m_in.substr(start, m_pos - start));
+        if (out.empty() || out == "null" || out[0] == '{' || out[0] == '[') {
+            return error("Expected a string, number or boolean value");
+        }
+        return true;
+    }
+
+    bool read_object(SweepVariant& variant) {
+        if (!expect('{')) return false;
+        skip_ws();
+        if (peek() == '}') {
+            m_pos++;
+            return true;
+        }
+        std::string key, value;
+        while (true) {
+            if (!read_string(key) || !expect(':') || !read_value(value)) return false;
+            if (key == "name" || key == "variant") {
+                variant.name = value;
+            } else {
+                PropOverride ov;
+                if (!split_column(key, ov)) return error("Keys must be <instance>.<property>");
+                ov.value = value;
+                variant.overrides.push_back(std::move(ov));
+            }
+            skip_ws();
+            if (peek() == ',') {
+                m_pos++;
+                continue;
+            }
+            return expect('}');
+        }
+    }
+};
+
+} // namespace
+
+bool parse_sweep_csv(std::string_view input, std::vector<SweepVariant>& variants,
+                     const std::string& filename) {
+    size_t pos = 0;
+    size_t line = 1;
+    bool bad_quote = false;
+    std::vector<std::string> header;
+    if (!next_csv_row(input, pos, header, bad_quote) || header.empty() || header[0].empty()) {
+        std::cerr << "Error: " << filename << ": Missing sweep table header" << std::endl;
+        return false;
+    }
+
+    // First column names the variant, the others are <inst>.<prop>
+    std::vector<PropOverride> columns(header.size());
+    for (size_t c = 1; c < header.size(); c++) {
+        if (!split_column(header[c], columns[c])) {
+            std::cerr << "Error: " << filename << ":1: Column '" << header[c]
+                      << "' is not <instance>.<property>" << std::endl;
+            return false;
+        }
+    }
+
+    std::vector<std::string> fields;
+    while (next_csv_row(input, pos, fields, bad_quote)) {
+        line++;
+        if (bad_quote) {
+            std::cerr << "Error: " << filename << ":" << line << ": Unterminated quote" << std::endl;
+            return false;
+        }
+        if (fields.size() == 1 && fields[0].empty()) continue;  // Blank line
+        if (fields.size() > header.size()) {
+            std::cerr << "Error: " << filename << ":" << line << ": Too many fields" << std::endl;
+            return false;
+        }
+
+        SweepVariant variant;
+        variant.name = fields[0].empty() ? std::to_string(variants.size()) : fields[0];
+        for (size_t c = 1; c < fields.size(); c++) {
+            if (fields[c].empty()) continue;
+            PropOverride ov = columns[c];
+            ov.value = fields[c];
+            variant.overrides.push_back(std::move(ov));
+        }
+        variants.push_back(std::move(variant));
+    }
+    return true;
+}
+
+bool parse_sweep_json(std::string_view input, std::vector<SweepVariant>& variants,
+                      const std::string& filename) {
+    JsonTableReader reader(input, filename);
+    return reader.read(variants);
+}
+
+bool load_sweep_table(const std::string& path, std::vector<SweepVariant>& variants) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open sweep table: " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string content = buffer.str();
+
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (ext == ".json") return parse_sweep_json(content, variants, path);
+    if (ext == ".csv") return parse_sweep_csv(content, variants, path);
+
+    std::cerr << "Error: Sweep table must be .csv or .json: " << path << std::endl;
+    return false;
+}
+
+bool generate_sweep(Schematic& sch, const std::vector<SweepVariant>& variants,
+                    const std::string& out_dir, bool subcircuit_mode, unsigned threads,
+                    bool evaluate) {
+    XSCHEM_TRACE_SCOPE("sweep", sch.filename);
+
+    // Output names must not collide once made file-safe
+    std::vector<std::string> paths;
+    std::set<std::string> seen;
+    std::string stem = std::filesystem::path(sch.filename).stem().string();
+    for (const auto& variant : variants) {
+        std::string name = file_safe(variant.name);
+        if (!seen.insert(name).second) {
+            std::cerr << "Error: Duplicate sweep variant: " << variant.name << std::endl;
+            return false;
+        }
+        paths.push_back((std::filesystem::path(out_dir) / (stem + "_" + name + ".spice")).string());
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    if (ec) {
+        std::cerr << "Error: Cannot create output directory: " << out_dir << std::endl;
+        return false;
+    }
+
+    SpiceNetlister netlister(sch);
+    netlister.set_subcircuit_mode(subcircuit_mode);
+    netlister.set_evaluate_expressions(evaluate);
+    if (!netlister.prepare_sweep()) return false;
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, std::max<size_t>(1, variants.size()));
+
+    std::atomic<bool> ok{true};
+    auto emit = [&](size_t i) {
+        StageTimer timer(Stage::Emission);
+        std::ofstream out(paths[i]);
+        if (!out.is_open() || !netlister.generate_variant(variants[i], out)) {
+            std::cerr << "Error: Cannot write netlist: " << paths[i] << std::endl;
+            ok = false;
+        }
+    };
+
+    if (threads == 1) {
+        for (size_t i = 0; i < variants.size(); i++) emit(i);
+    } else {
+        WorkerPool pool(threads);
+        for (size_t i = 0; i < variants.size(); i++) {
+            pool.submit([&emit, i, stats = current_stats()] {
+                StatsScope scope(stats);
+                emit(i);
+            });
+        }
+        pool.wait();
+    }
+    return ok;
+}
+
+} // namespace xschem
@@ -0,0 +1,35 @@
+// xschem_sweep.h - Parameter sweeps over one loaded schematic
+// A sweep table lists netlist variants, each a set of instance property
+// overrides. The schematic is loaded and resolved once; every variant is
+// written as its own netlist, re-formatting only the instances it changes.
+//
+// CSV tables have a header row "variant,<inst>.<prop>,..." and one row per
+// variant; an empty cell leaves the property unchanged. JSON tables are an
+// array of flat objects whose "name" (or "variant") key names the variant
+// and whose other keys are "<inst>.<prop>". An instance of "*" overrides
+// the property on every instance.
+
+#ifndef XSCHEM_SWEEP_H
+#define XSCHEM_SWEEP_H
+
+#include "xschem_lite.h"
+
+namespace xschem {
+
+// Read a .csv or .json sweep table (chosen by extension)
+bool load_sweep_table(const std::string& path, std::vector<SweepVariant>& variants);
+bool parse_sweep_csv(std::string_view input, std::vector<SweepVariant>& variants,
+                     const std::string& filename = "");
+bool parse_sweep_json(std::string_view input, std::vector<SweepVariant>& variants,
+                      const std::string& filename = "");
+
+// Write <out_dir>/<schematic stem>_<variant>.spice for every variant,
+// using up to `threads` worker threads (0 = hardware concurrency).
+// `evaluate` is SpiceNetlister::set_evaluate_expressions.
+bool generate_sweep(Schematic& sch, const std::vector<SweepVariant>& variants,
+                    const std::string& out_dir, bool subcircuit_mode = true,
+                    unsigned threads = 0, bool evaluate = false);
+
+} // namespace xschem
+
+#endif // XSCHEM_SWEEP_H
@@ -0,0 +1,195 @@
+// xschem_trace.cpp - Chrome trace-event timeline for xschem_lite runs
+// Implementation file
+
+#include "xschem_trace.h"
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace xschem {
+
+std::atomic<bool> g_trace_enabled{false};
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    std::string detail;
+    int64_t start_ns;   // Relative to the trace epoch
+    int64_t dur_ns;
+};
+
+// Events of one thread. Only the owning thread appends; the mutex is
+// uncontended except while the trace is written or cleared.
+struct ThreadBuffer {
+    uint32_t tid;
+    bool main;          // Thread that called trace_enable()
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    bool exited = false;
+};
+
+// A buffer is kept after its thread exits while it holds spans (worker
+// pools exit before the trace is written), and released once they are
+// cleared, so hosts that start threads per call do not grow the registry
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    uint32_t next_tid = 1;
+    std::atomic<int64_t> epoch_ns{0};     // steady_clock time of trace_enable()
+    std::thread::id main_thread;
+
+    // Drop buffers of exited threads with no spans left; mutex held
+    void prune() {
+        std::erase_if(buffers, [](const std::shared_ptr<ThreadBuffer>& buffer) {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            return buffer->exited && buffer->events.empty();
+        });
+    }
+};
+
+TraceRegistry& registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+int64_t steady_ns(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+// Owns the calling thread's buffer and marks it exited with the thread
+struct BufferOwner {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ~BufferOwner() {
+        if (!buffer) return;
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            buffer->exited = true;
+        }
+        reg.prune();
+    }
+};
+
+ThreadBuffer& thread_buffer() {
+    thread_local BufferOwner owner;
+    if (!owner.buffer) {
+        owner.buffer = std::make_shared<ThreadBuffer>();
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        owner.buffer->tid = reg.next_tid++;
+        owner.buffer->main = std::this_thread::get_id() == reg.main_thread;
+        reg.buffers.push_back(owner.buffer);
+    }
+    return *owner.buffer;
+}
+
+void write_json_string(std::ostream& out, std::string_view s) {
+    out << '"';
+    for (char c : s) {
+        switch (c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                        << static_cast<int>(c) << std::dec << std::setfill(' ');
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void trace_enable() {
+    auto& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (auto& buffer : reg.buffers) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            buffer->events.clear();
+        }
+        reg.prune();
+        reg.epoch_ns.store(steady_ns(std::chrono::steady_clock::now()), std::memory_order_relaxed);
+        reg.main_thread = std::this_thread::get_id();
+    }
+    g_trace_enabled.store(true, std::memory_order_relaxed);
+}
+
+void trace_disable() {
+    g_trace_enabled.store(false, std::memory_order_relaxed);
+}
+
+void TraceSpan::begin(const char* name, std::string_view detail) {
+    thread_buffer();  // Number threads in the order their first span starts
+    m_name = name;
+    m_detail = detail;
+    m_start = std::chrono::steady_clock::now();
+}
+
+void TraceSpan::record() {
+    auto end = std::chrono::steady_clock::now();
+    const int64_t epoch_ns = registry().epoch_ns.load(std::memory_order_relaxed);
+    ThreadBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events.push_back({
+        m_name, std::move(m_detail), steady_ns(m_start) - epoch_ns,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count()});
+}
+
+bool write_trace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot write trace file: " << path << std::endl;
+        return false;
+    }
+
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    // Timestamps are microseconds with ns precision
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        if (buffer->events.empty()) continue;
+
+        out << (first ? "" : ",\n")
+            << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->tid
+            << ", \"args\": {\"name\": \"" << (buffer->main ? "main" : "worker")
+            << " " << buffer->tid << "\"}}";
+        first = false;
+
+        for (const auto& ev : buffer->events) {
+            out << ",\n{\"name\": ";
+            write_json_string(out, ev.name);
+            out << ", \"cat\": \"xschem\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+                << ", \"ts\": " << static_cast<double>(ev.start_ns) / 1e3
+                << ", \"dur\": " << static_cast<double>(ev.dur_ns) / 1e3;
+            if (!ev.detail.empty()) {
+                out << ", \"args\": {\"detail\": ";
+                write_json_string(out, ev.detail);
+                out << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    reg.prune();
+    return out.good();
+}
+
+} // namespace xschem
@@ -0,0 +1,65 @@
+// xschem_trace.h - Chrome trace-event timeline for xschem_lite runs
+// Scoped spans recorded per thread and written as a trace-event JSON file
+// (chrome://tracing, Perfetto). Recording is off until trace_enable(); a
+// disabled span is one relaxed atomic load. Building with
+// -DXSCHEM_LITE_NO_TRACE removes the spans entirely.
+
+#ifndef XSCHEM_TRACE_H
+#define XSCHEM_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace xschem {
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool trace_enabled() { return g_trace_enabled.load(std::memory_order_relaxed); }
+
+// Start recording (clears previously recorded spans) / stop recording
+void trace_enable();
+void trace_disable();
+
+// Write all recorded spans as Chrome trace-event JSON
+bool write_trace(const std::string& path);
+
+// Records [construction, destruction) as a complete ("X") event on the
+// calling thread. `name` must be a string literal; `detail` is copied only
+// when tracing is enabled.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, std::string_view detail = {}) {
+        if (trace_enabled()) begin(name, detail);
+    }
+    ~TraceSpan() {
+        if (m_name) record();
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    void begin(const char* name, std::string_view detail);
+    void record();
+
+    const char* m_name = nullptr;
+    std::string m_detail;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace xschem
+
+#define XSCHEM_TRACE_CONCAT_(a, b) a##b
+#define XSCHEM_TRACE_CONCAT(a, b) XSCHEM_TRACE_CONCAT_(a, b)
+
+#ifdef XSCHEM_LITE_NO_TRACE
+#define XSCHEM_TRACE_SCOPE(...) ((void)0)
+#else
+// XSCHEM_TRACE_SCOPE("name") or XSCHEM_TRACE_SCOPE("name", detail)
+#define XSCHEM_TRACE_SCOPE(...) \
+    ::xschem::TraceSpan XSCHEM_TRACE_CONCAT(xschem_trace_span_, __LINE__)(__VA_ARGS__)
+#endif
+
+#endif // XSCHEM_TRACE_H